@@ -38,6 +38,8 @@ public class MazeGenerator : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
+				"ProceduralMeshComponent",
+				"Json",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
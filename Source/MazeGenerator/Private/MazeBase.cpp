@@ -3,20 +3,91 @@
 
 #include "MazeBase.h"
 
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Materials/MaterialInterface.h"
+#include "ProceduralMeshComponent.h"
+#include "MazeLayoutCache.h"
+#include "MazeLayoutFile.h"
+#include "Async/Async.h"
 #include "Kismet/GameplayStatics.h"
+#include "Tasks/Task.h"
 #include "Util/ColorConstants.h"
 
+DECLARE_CYCLE_STAT(TEXT("Regenerate Maze"), STAT_MazeRegenerate, STATGROUP_Maze);
+DECLARE_CYCLE_STAT(TEXT("Solve Layout"), STAT_MazeSolveLayout, STATGROUP_Maze);
+DECLARE_CYCLE_STAT(TEXT("Spawn Floors"), STAT_MazeFloors, STATGROUP_Maze);
+DECLARE_CYCLE_STAT(TEXT("Spawn Corners"), STAT_MazeCorners, STATGROUP_Maze);
+DECLARE_CYCLE_STAT(TEXT("Spawn Walls"), STAT_MazeWalls, STATGROUP_Maze);
+DECLARE_CYCLE_STAT(TEXT("Carve Pieces"), STAT_MazeCarve, STATGROUP_Maze);
+DECLARE_CYCLE_STAT(TEXT("Finish Materialization"), STAT_MazeFinish, STATGROUP_Maze);
+
+namespace MazeBase
+{
+	// piece type of every section of a merged chunk or proxy, in the order of EMazeMergedSection
+	static const EMazePieceType MergedSectionPieceTypes[] = {
+		EMazePieceType::EMPT_Floor,
+		EMazePieceType::EMPT_InnerWall,
+		EMazePieceType::EMPT_OuterWall,
+		EMazePieceType::EMPT_OuterCorner,
+	};
+	static_assert(UE_ARRAY_COUNT(MergedSectionPieceTypes) == static_cast<int32>(EMazeMergedSection::EMMS_MAX), "Every merged section needs a piece type");
+
+	static float& GetStageMs(FMazeGenerationStats& Stats, EMazeMaterializationStage Stage)
+	{
+		switch (Stage)
+		{
+		case EMazeMaterializationStage::EMMS_Floors :
+			return Stats.FloorsMs;
+		case EMazeMaterializationStage::EMMS_Corners :
+			return Stats.CornersMs;
+		case EMazeMaterializationStage::EMMS_Walls :
+			return Stats.WallsMs;
+		case EMazeMaterializationStage::EMMS_Carve :
+			return Stats.CarveMs;
+		default:
+			return Stats.FinishMs;
+		}
+	}
+}
+
 // Sets default values
 AMazeBase::AMazeBase()
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = false;
+	// Tick is only enabled while a frame budgeted materialization is running.
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	MazeWidth = 5;
 	MazeHeight = 5;
 	bUseMeshSizes = true;
 	bGenerateInConstructionScript = false;
 	bRegenerateMazeInConstructionScript = false;
+	bSpawnOnlyRemainingPieces = true;
+	Algorithm = EMazeAlgorithm::EMA_Backtracker;
+	ParallelTileSize = 64;
+	RenderBackend = EMazeRenderBackend::EMRB_ChildActors;
+	ChildActorPieceTypes = 0;
+	MergedChunkSize = 16;
+	bMergedCollision = false;
+	bBuildVisibility = false;
+	VisibilityRadius = 12;
+	bBuildLODProxies = false;
+	LODProxyBlockSize = 16;
+	LODProxyDistance = 10000.f;
+	MaterializationFrameBudgetMs = 0.f;
+	bPoolPieces = true;
+	PiecePoolGrowSize = 1;
+	PiecePoolMaxSize = 16384;
+	bUseLayoutCache = true;
+	bPersistLayoutCache = false;
+	MaxCachedPaths = 256;
+	bBuildFlowFields = false;
+	PieceTables.SetNum(static_cast<int32>(EMazePieceType::EMPT_MAX));
+	EntryOuterEdgeIndex = INDEX_NONE;
+	ExitOuterEdgeIndex = INDEX_NONE;
+	EntryExitRandomSeed = 0;
 
 	CenterSceneComp = CreateDefaultSubobject<USceneComponent>(TEXT("Center Comp"));
 	RootComponent = CenterSceneComp;
@@ -45,6 +116,13 @@ void AMazeBase::BeginPlay()
 	
 }
 
+void AMazeBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	CancelAsyncGeneration();
+	
+	Super::EndPlay(EndPlayReason);
+}
+
 void AMazeBase::OnConstruction(const FTransform& Transform)
 {
 	Super::OnConstruction(Transform);
@@ -56,334 +134,618 @@ void AMazeBase::OnConstruction(const FTransform& Transform)
 		bRegenerateMazeInConstructionScript = false;
 		
 	}
+	else if (PendingEdits != EMazeEditFlags::None)
+	{
+		ApplyPendingEdits();
+	}
 	
-	
+	PendingEdits = EMazeEditFlags::None;
+	PendingEditPieceTypes = 0;
 }
 
-void AMazeBase::ClearMaze()
+#if WITH_EDITOR
+void AMazeBase::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
 {
+	// collected here and applied in OnConstruction, which the editor runs right after this
+	int32 PieceTypes = 0;
+	PendingEdits |= ClassifyPropertyEdit(PropertyChangedEvent.GetMemberPropertyName(), PieceTypes);
+	PendingEditPieceTypes |= PieceTypes;
 
-	MazeData.Empty();
-	FloorContainer.Empty();
-	InnerWallContainer.Empty();
-	OuterWallContainer.Empty();
-	InnerCornerContainer.Empty();
-	OuterCornerContainer.Empty();
-	RoomCenters.Empty();
-	RemovedRoomDoorwayTransforms.Empty();
-	
-	if (!FloorSceneComp->GetAttachChildren().IsEmpty())
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+}
+#endif
+
+EMazeEditFlags AMazeBase::ClassifyPropertyEdit(FName PropertyName, int32& OutPieceTypes)
+{
+	OutPieceTypes = 0;
+
+	// in the order of EMazePieceType
+	const FName ClassProperties[] = {
+		GET_MEMBER_NAME_CHECKED(AMazeBase, FloorActorClass),
+		GET_MEMBER_NAME_CHECKED(AMazeBase, InnerWallActorClass),
+		GET_MEMBER_NAME_CHECKED(AMazeBase, OuterWallActorClass),
+		GET_MEMBER_NAME_CHECKED(AMazeBase, InnerCornerActorClass),
+		GET_MEMBER_NAME_CHECKED(AMazeBase, OuterCornerActorClass),
+	};
+	const FName MeshProperties[] = {
+		GET_MEMBER_NAME_CHECKED(AMazeBase, FloorMeshSize),
+		GET_MEMBER_NAME_CHECKED(AMazeBase, InnerWallMeshSize),
+		GET_MEMBER_NAME_CHECKED(AMazeBase, OuterWallMeshSize),
+		GET_MEMBER_NAME_CHECKED(AMazeBase, InnerCornerMeshSize),
+		GET_MEMBER_NAME_CHECKED(AMazeBase, OuterCornerMeshSize),
+	};
+	for (int32 Type = 0; Type < static_cast<int32>(EMazePieceType::EMPT_MAX); Type++)
 	{
-		for (int32 i = FloorSceneComp->GetAttachChildren().Num(); i > 0; i--)
+		if (PropertyName == ClassProperties[Type])
 		{
-			if (!FloorSceneComp->GetAttachChildren()[i - 1])
-			{
-				continue;
-			}
-			//FloorSceneComp->GetAttachChildren()[i - 1]->UnregisterComponent();
-			FloorSceneComp->GetAttachChildren()[i - 1]->DestroyComponent();
+			OutPieceTypes = 1 << Type;
+			return EMazeEditFlags::Visuals;
+		}
+		if (PropertyName == MeshProperties[Type])
+		{
+			// the mesh is drawn by the instanced backend and gives the size of the piece
+			OutPieceTypes = 1 << Type;
+			return EMazeEditFlags::Visuals | EMazeEditFlags::Sizes;
 		}
 	}
 
-	if (!InnerWallSceneComp->GetAttachChildren().IsEmpty())
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, RenderBackend)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, ChildActorPieceTypes))
 	{
-		for (int32 i = InnerWallSceneComp->GetAttachChildren().Num(); i > 0; i--)
+		OutPieceTypes = (1 << static_cast<int32>(EMazePieceType::EMPT_MAX)) - 1;
+		return EMazeEditFlags::Visuals;
+	}
+
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, MergedChunkSize))
+	{
+		OutPieceTypes = (1 << static_cast<int32>(EMazePieceType::EMPT_MAX)) - 1;
+		return EMazeEditFlags::Visuals | EMazeEditFlags::Collision;
+	}
+
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bMergedCollision))
+	{
+		return EMazeEditFlags::Collision;
+	}
+
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bBuildLODProxies)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, LODProxyBlockSize)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, LODProxyDistance))
+	{
+		return EMazeEditFlags::LOD;
+	}
+
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bUseMeshSizes)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, FloorSize)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, InnerWallSize)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, OuterWallSize)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, InnerCornerSize)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, OuterCornerSize))
+	{
+		return EMazeEditFlags::Sizes;
+	}
+
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bHasEntry)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bCustomEntry)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bRandomEntry)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, EntryWallNumber)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bEntrySide1)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bEntrySide2)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bEntrySide3)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bEntrySide4)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bHasExit)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bCustomExit)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bRandomExit)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, ExitWallNumber)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bExitSide1)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bExitSide2)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bExitSide3)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bExitSide4)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, AdditionalOuterWallOpenings))
+	{
+		return EMazeEditFlags::EntryExit;
+	}
+
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, MazeWidth)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, MazeHeight)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, Seed)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, MazeAlgorithmStartingCell)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, Algorithm)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, ParallelTileSize)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bCreateRooms)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, NumberOfRooms)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, RoomWidth)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, RoomHeight)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, NumberOfRoomDoors)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(AMazeBase, bSpawnOnlyRemainingPieces))
+	{
+		return EMazeEditFlags::Topology;
+	}
+
+	return EMazeEditFlags::None;
+}
+
+void AMazeBase::ApplyPendingEdits()
+{
+	if (EnumHasAnyFlags(PendingEdits, EMazeEditFlags::Topology))
+	{
+		if (bGenerateInConstructionScript)
 		{
-			if (!InnerWallSceneComp->GetAttachChildren()[i - 1])
-			{
-				continue;
-			}
-			//InnerWallSceneComp->GetAttachChildren()[i - 1]->UnregisterComponent();
-			InnerWallSceneComp->GetAttachChildren()[i - 1]->DestroyComponent();
+			RegenerateMaze();
+		}
+		return;
+	}
+
+	// the other edits only update pieces, so there has to be a finished maze to update
+	if (MazeGrid.Num() == 0 || IsMaterializing() || IsGeneratingAsync())
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	if (EnumHasAnyFlags(PendingEdits, EMazeEditFlags::EntryExit))
+	{
+		ApplyEntryExitEdit();
+	}
+	if (EnumHasAnyFlags(PendingEdits, EMazeEditFlags::Sizes))
+	{
+		ApplySizeEdit();
+	}
+	if (EnumHasAnyFlags(PendingEdits, EMazeEditFlags::Visuals))
+	{
+		ApplyVisualEdit(PendingEditPieceTypes);
+	}
+	if (EnumHasAnyFlags(PendingEdits, EMazeEditFlags::Collision))
+	{
+		ApplyCollisionEdit();
+	}
+	// the proxies are built from the walls, sizes and materials of the pieces
+	if (EnumHasAnyFlags(PendingEdits, EMazeEditFlags::LOD)
+		|| (bBuildLODProxies && EnumHasAnyFlags(PendingEdits, EMazeEditFlags::EntryExit | EMazeEditFlags::Sizes | EMazeEditFlags::Visuals)))
+	{
+		ApplyLODEdit();
+	}
+
+	// edited pieces are spawned visible, so the culling has to look at them again
+	PieceCullingCell = INDEX_NONE;
+	
+	UE_LOG(LogTemp, Log, TEXT("Maze %d x %d updated in %.2f ms"), MazeGrid.Width, MazeGrid.Height, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+void AMazeBase::ApplyEntryExitEdit()
+{
+	NormalizeEntryAndExitSides();
+	const FMazeGenerationSettings Settings = MakeGenerationSettings();
+	if (Settings.MazeWidth != MazeGrid.Width || Settings.MazeHeight != MazeGrid.Height)
+	{
+		// the size was changed without regenerating, the walls would not line up with the spawned maze
+		return;
+	}
+
+	// the entry and exit stages only need the size of the grid
+	FMazeLayout Layout;
+	Layout.Grid.Width = MazeGrid.Width;
+	Layout.Grid.Height = MazeGrid.Height;
+	Layout.EntryExitRandomSeed = EntryExitRandomSeed;
+	FMazeLayoutGenerator(Settings).RecarveEntryAndExit(Layout);
+
+	TArray<int32> OldOpenEdges = OpenOuterEdgeIndices;
+	OldOpenEdges.Add(EntryOuterEdgeIndex);
+	OldOpenEdges.Add(ExitOuterEdgeIndex);
+	TArray<int32> NewOpenEdges = Layout.OpenOuterEdges;
+	NewOpenEdges.Add(Layout.EntryOuterEdge);
+	NewOpenEdges.Add(Layout.ExitOuterEdge);
+
+	FMazePieceTable& Table = GetPieceTable(EMazePieceType::EMPT_OuterWall);
+	TArray<int32> ChangedOuterEdges;
+	for (int32 OuterEdgeIndex : OldOpenEdges)
+	{
+		if (OuterEdgeIndex != INDEX_NONE && !NewOpenEdges.Contains(OuterEdgeIndex)
+			&& !Table.Components[OuterEdgeIndex] && Table.Instances[OuterEdgeIndex] == INDEX_NONE)
+		{
+			SpawnPiece(EMazePieceType::EMPT_OuterWall, OuterEdgeIndex, GetOuterWallTransform(OuterEdgeIndex));
+			ChangedOuterEdges.Add(OuterEdgeIndex);
 		}
 	}
+	for (int32 OuterEdgeIndex : NewOpenEdges)
+	{
+		if (OuterEdgeIndex != INDEX_NONE && !OldOpenEdges.Contains(OuterEdgeIndex))
+		{
+			RemovePiece(EMazePieceType::EMPT_OuterWall, OuterEdgeIndex);
+			ChangedOuterEdges.Add(OuterEdgeIndex);
+		}
+	}
+	FlushPendingInstances(EMazePieceType::EMPT_OuterWall);
+	RebuildPieceContainers();
+
+	EntryOuterEdgeIndex = Layout.EntryOuterEdge;
+	ExitOuterEdgeIndex = Layout.ExitOuterEdge;
+	OpenOuterEdgeIndices = MoveTemp(Layout.OpenOuterEdges);
+	if (bHasEntry)
+	{
+		EntryWallNumber = Layout.EntryWallNumber;
+	}
+	if (bHasExit)
+	{
+		ExitWallNumber = Layout.ExitWallNumber;
+	}
+	UpdateLayoutTransforms();
+
+	if (ExitFlowField.IsBuilt())
+	{
+		BuildFlowFields();
+	}
+	BuildCellTagIndex();
 
-	if (!OuterWallSceneComp->GetAttachChildren().IsEmpty())
+	const bool bMergedOuterWalls = UsesMergedGeometry(EMazePieceType::EMPT_OuterWall);
+	if ((bMergedOuterWalls || bMergedCollision) && ChangedOuterEdges.Num() > 0)
 	{
-		for (int32 i = OuterWallSceneComp->GetAttachChildren().Num(); i > 0; i--)
+		const FMazeMergedGeometryBuilder Builder = MakeMergedGeometryBuilder();
+		TArray<int32> ChangedChunks;
+		for (int32 OuterEdgeIndex : ChangedOuterEdges)
 		{
-			if (!OuterWallSceneComp->GetAttachChildren()[i - 1])
-			{
-				continue;
-			}
-			//OuterWallSceneComp->GetAttachChildren()[i - 1]->UnregisterComponent();
-			OuterWallSceneComp->GetAttachChildren()[i - 1]->DestroyComponent();
+			ChangedChunks.AddUnique(Builder.GetChunkOfOuterEdge(OuterEdgeIndex));
+		}
+		if (bMergedOuterWalls)
+		{
+			RebuildMergedChunks(ChangedChunks);
+		}
+		if (bMergedCollision)
+		{
+			RebuildMergedCollisionChunks(ChangedChunks);
 		}
 	}
+}
+
+void AMazeBase::ApplySizeEdit()
+{
+	if (!UpdatePieceSizes())
+	{
+		return;
+	}
 
-	if (!InnerCornerSceneComp->GetAttachChildren().IsEmpty())
+	for (int32 Type = 0; Type < static_cast<int32>(EMazePieceType::EMPT_MAX); Type++)
 	{
-		for (int32 i = InnerCornerSceneComp->GetAttachChildren().Num(); i > 0; i--)
+		const EMazePieceType PieceType = static_cast<EMazePieceType>(Type);
+		FMazePieceTable& Table = GetPieceTable(PieceType);
+		for (int32 PieceIndex = 0; PieceIndex < Table.Components.Num(); PieceIndex++)
 		{
-			if (!InnerCornerSceneComp->GetAttachChildren()[i - 1])
+			if (Table.Components[PieceIndex])
 			{
-				continue;
+				Table.Components[PieceIndex]->SetRelativeTransform(GetPieceTransform(PieceType, PieceIndex));
 			}
-			//InnerCornerSceneComp->GetAttachChildren()[i - 1]->UnregisterComponent();
-			InnerCornerSceneComp->GetAttachChildren()[i - 1]->DestroyComponent();
 		}
-	}
 
-	if (!OuterCornerSceneComp->GetAttachChildren().IsEmpty())
-	{
-		for (int32 i = OuterCornerSceneComp->GetAttachChildren().Num(); i > 0; i--)
+		if (Table.InstancedMesh && Table.InstancePieces.Num() > 0)
 		{
-			if (!OuterCornerSceneComp->GetAttachChildren()[i - 1])
+			// instances are stored in the order of InstancePieces, so they can be moved in one batch
+			TArray<FTransform> Transforms;
+			Transforms.Reserve(Table.InstancePieces.Num());
+			for (int32 PieceIndex : Table.InstancePieces)
 			{
-				continue;
+				Transforms.Add(GetPieceTransform(PieceType, PieceIndex));
 			}
-			//OuterCornerSceneComp->GetAttachChildren()[i - 1]->UnregisterComponent();
-			OuterCornerSceneComp->GetAttachChildren()[i - 1]->DestroyComponent();
+			Table.InstancedMesh->BatchUpdateInstancesTransforms(0, Transforms, false, true);
 		}
 	}
+	UpdateLayoutTransforms();
+
+	if (MergedPieceTypes != 0)
+	{
+		RebuildMergedGeometry();
+	}
+	if (bMergedCollision)
+	{
+		RebuildMergedCollision();
+	}
 }
 
-void AMazeBase::GenerateFloors()
+void AMazeBase::ApplyVisualEdit(int32 PieceTypes)
 {
-	if (bUseMeshSizes)
+	for (int32 Type = 0; Type < static_cast<int32>(EMazePieceType::EMPT_MAX); Type++)
 	{
-		if (!FloorMeshSize)
+		const bool bWasMerged = (MergedPieceTypes & (1 << Type)) != 0;
+		if ((PieceTypes & (1 << Type)) != 0 && bWasMerged != UsesMergedGeometry(static_cast<EMazePieceType>(Type)))
 		{
-			UE_LOG(LogTemp, Error, TEXT("The maze is using the floor mesh size but does not have a floor mesh set"));
+			// merged pieces have no entry in the piece tables, so they are spawned again from the layout
+			MaterializeLayout(MakeLayoutFromMaze(), FPlatformTime::Seconds());
 			return;
 		}
-		FloorSize = FloorMeshSize->GetBoundingBox().GetSize();
 	}
-
-	FTransform FloorTileTransform;
 	
-	for (int32 i = 0; i < MazeWidth; i++)
-	{
-		for (int32 j = 0; j < MazeHeight; j++)
-		{
-			// setup cell data
-			FloorTileTransform.SetLocation(FVector(
-				((i * FloorSize.X) - (FloorSize.X * (MazeWidth - 1)) / 2),
-				((j * FloorSize.Y) - (FloorSize.Y * (MazeHeight - 1)) / 2),
-				0));
-			FMazeCellData TempCellData;
-			TempCellData.MazeCellTransform = FloorTileTransform;
-			TempCellData.bAlgorithmHasVisited = false;
-			TempCellData.MazeCellCoordinates = FIntPoint(i, j);
-
-			// create new child actor component and apply chosen class. Only works in instanced asset
-			CreateChildActorInstance(FloorTileTransform,
-				FloorActorClass,
-				FloorSceneComp,
-				FName(TEXT("Floor " + FString::FromInt(i) + ", " + FString::FromInt(j))),
-				&FloorContainer);
-
-			// Set cell position enum based on cell location
-			if (i == 0 && j == 0)
-			{
-				TempCellData.CellPosition = (ECellPosition::ECP_BottomLeftCorner);
-			}
-			else if (i == 0 && j == (MazeHeight - 1))
-			{
-				TempCellData.CellPosition =(ECellPosition::ECP_BottomRightCorner);
-			}
-			else if (i == (MazeWidth - 1) && j == 0)
-			{
-				TempCellData.CellPosition =(ECellPosition::ECP_TopLeftCorner);
-			}
-			else if (i == (MazeWidth - 1) && j == (MazeHeight - 1))
-			{
-				TempCellData.CellPosition =(ECellPosition::ECP_TopRightCorner);
-			}
-			else if (j == 0)
-			{
-				TempCellData.CellPosition =(ECellPosition::ECP_LeftSide);
-			}
-			else if (j == (MazeHeight - 1))
+	for (int32 Type = 0; Type < static_cast<int32>(EMazePieceType::EMPT_MAX); Type++)
+	{
+		const EMazePieceType PieceType = static_cast<EMazePieceType>(Type);
+		if ((PieceTypes & (1 << Type)) == 0 || UsesMergedGeometry(PieceType))
+		{
+			continue;
+		}
+
+		FMazePieceTable& Table = GetPieceTable(PieceType);
+		const bool bHasInstances = Table.InstancePieces.Num() > 0;
+		const bool bHasComponents = Table.Components.ContainsByPredicate([](const TObjectPtr<UChildActorComponent>& Component) { return Component != nullptr; });
+		
+		if (UsesInstancedMesh(PieceType))
+		{
+			if (bHasComponents)
 			{
-				TempCellData.CellPosition =(ECellPosition::ECP_RightSide);
+				RespawnPieces(PieceType);
 			}
-			else if (i == 0)
+			else if (bHasInstances)
 			{
-				TempCellData.CellPosition =(ECellPosition::ECP_BottomSide);
+				// picks up a changed mesh
+				GetOrCreateInstancedMesh(PieceType);
 			}
-			else if (i == (MazeWidth - 1))
+		}
+		else if (bHasInstances)
+		{
+			RespawnPieces(PieceType);
+		}
+		else
+		{
+			UClass* Class = GetPieceClass(PieceType);
+			for (UChildActorComponent* Component : Table.Components)
 			{
-				TempCellData.CellPosition =(ECellPosition::ECP_TopSide);
+				if (Component && Component->GetChildActorClass() != Class)
+				{
+					Component->SetChildActorClass(Class);
+					ApplyPieceCollision(Component);
+					ApplyPieceDrawDistance(Component);
+				}
 			}
-			else
+		}
+	}
+
+	// picks up changed materials and chunk sizes
+	if (MergedPieceTypes != 0)
+	{
+		RebuildMergedGeometry();
+	}
+}
+
+void AMazeBase::ApplyCollisionEdit()
+{
+	for (int32 Type = 0; Type < static_cast<int32>(EMazePieceType::EMPT_MAX); Type++)
+	{
+		FMazePieceTable& Table = GetPieceTable(static_cast<EMazePieceType>(Type));
+		for (UChildActorComponent* Component : Table.Components)
+		{
+			if (Component)
 			{
-				TempCellData.CellPosition =(ECellPosition::ECP_Normal);
+				ApplyPieceCollision(Component);
 			}
-			
-			MazeData.Add(FIntPoint(i, j), TempCellData);
 		}
+		if (Table.InstancedMesh)
+		{
+			Table.InstancedMesh->SetCollisionEnabled(bMergedCollision ? ECollisionEnabled::NoCollision : ECollisionEnabled::QueryAndPhysics);
+		}
+	}
+
+	// the merged sections only have collision of their own without the merged collision
+	if (MergedPieceTypes != 0)
+	{
+		RebuildMergedGeometry();
+	}
+	
+	if (bMergedCollision)
+	{
+		RebuildMergedCollision();
+	}
+	else
+	{
+		ClearMergedCollision();
 	}
 }
 
-void AMazeBase::GenerateWalls()
+void AMazeBase::RespawnPieces(EMazePieceType Type)
 {
-	if (bUseMeshSizes)
+	FMazePieceTable& Table = GetPieceTable(Type);
+	TArray<int32> Pieces;
+	for (int32 PieceIndex = 0; PieceIndex < Table.Components.Num(); PieceIndex++)
 	{
-		if (!InnerWallMeshSize || !OuterWallMeshSize)
+		if (Table.Components[PieceIndex])
 		{
-			UE_LOG(LogTemp, Error, TEXT("The maze is using the wall mesh size but does not have a wall mesh set"));
-			return;
+			ReleasePiece(Type, Table.Components[PieceIndex]);
+			Pieces.Add(PieceIndex);
+		}
+		else if (Table.Instances[PieceIndex] != INDEX_NONE)
+		{
+			Pieces.Add(PieceIndex);
 		}
-		InnerWallSize = InnerWallMeshSize->GetBoundingBox().GetSize();
-		OuterWallSize = OuterWallMeshSize->GetBoundingBox().GetSize();
 	}
 
-	FTransform WallTileTransform;
+	Table.Reset(Table.Components.Num());
 
-	for (int32 i = 0; i < MazeWidth; i++)
+	for (int32 PieceIndex : Pieces)
 	{
-		for (int32 j = 0; j < MazeHeight; j++)
-		{
-			// set inner walls going x direction
-			if (i != MazeWidth - 1)
-			{
-				WallTileTransform.SetRotation(FRotator(0.f, 90.f, 0.f).Quaternion());
-				WallTileTransform.SetLocation(FVector(
-					((i * FloorSize.X) - (FloorSize.X * (MazeWidth - 1)) / 2) + (FloorSize.X) / 2,
-					(InnerWallSize.X + InnerCornerSize.Y) * j  - (FloorSize.X * (MazeHeight - 1)) / 2,
-					(InnerWallSize.Z + FloorSize.Z) / 2));
-
-				CreateChildActorInstance(WallTileTransform,
-					InnerWallActorClass,
-					InnerWallSceneComp,
-					FName(TEXT("Inner Wall X " + FString::FromInt(i) + ", " + FString::FromInt(j))),
-					&InnerWallContainer);
-			}
+		SpawnPiece(Type, PieceIndex, GetPieceTransform(Type, PieceIndex));
+	}
+	FlushPendingInstances(Type);
+	RebuildPieceContainers();
+}
 
-			// set inner walls going y direction
-			if (j != MazeHeight - 1)
-			{
-				WallTileTransform.SetRotation(FRotator(0.f, 180.f, 0.f).Quaternion());
-				WallTileTransform.SetLocation(FVector(
-					(InnerWallSize.X + InnerCornerSize.X) * i - (FloorSize.X * (MazeWidth - 1)) / 2,
-					((j * FloorSize.Y) - (FloorSize.Y * (MazeHeight - 1)) / 2) + (FloorSize.Y) / 2,
-					(InnerWallSize.Z + FloorSize.Z) / 2));
-
-				CreateChildActorInstance(WallTileTransform,
-					InnerWallActorClass,
-					InnerWallSceneComp,
-					FName(TEXT("Inner Wall Y " + FString::FromInt(i) + ", " + FString::FromInt(j))),
-					&InnerWallContainer);
-			}
-			
-			// set outer walls -X 
-			if (i == 0)
-			{
-				WallTileTransform.SetRotation(FRotator(0.f, -90.f, 0.f).Quaternion());
-				WallTileTransform.SetLocation(FVector(
-					(-((FloorSize.X) + (FloorSize.X * (MazeWidth - 1))) / 2),
-					(OuterWallSize.X + OuterCornerSize.Y) * j  - (FloorSize.X * (MazeHeight - 1)) / 2,
-					(OuterWallSize.Z + FloorSize.Z) / 2));
-
-				CreateChildActorInstance(WallTileTransform,
-					OuterWallActorClass,
-					OuterWallSceneComp,
-					FName(TEXT("Outer Wall -X " + FString::FromInt(i) + ", " + FString::FromInt(j))),
-					&OuterWallContainer);
-			}
+void AMazeBase::ClearMaze()
+{
 
-			// set outer walls +X 
-			if (i == (MazeWidth - 1))
-			{
-				WallTileTransform.SetRotation(FRotator(0.f, 90.f, 0.f).Quaternion());
-				WallTileTransform.SetLocation(FVector(
-					(((FloorSize.X) + (FloorSize.X * (MazeWidth - 1))) / 2),
-					(OuterWallSize.X + OuterCornerSize.Y) * j  - (FloorSize.X * (MazeHeight- 1)) / 2,
-					(OuterWallSize.Z + FloorSize.Z) / 2));
-
-				CreateChildActorInstance(WallTileTransform,
-					OuterWallActorClass,
-					OuterWallSceneComp,
-					FName(TEXT("Outer Wall +X " + FString::FromInt(i) + ", " + FString::FromInt(j))),
-					&OuterWallContainer);
-			}
-			
-			// Set Outer Walls -Y 
-			if (j == 0)
+	MazeGrid.Empty();
+	FloorContainer.Empty();
+	InnerWallContainer.Empty();
+	OuterWallContainer.Empty();
+	InnerCornerContainer.Empty();
+	OuterCornerContainer.Empty();
+	EntryOuterEdgeIndex = INDEX_NONE;
+	ExitOuterEdgeIndex = INDEX_NONE;
+	OpenOuterEdgeIndices.Empty();
+	RoomCenters.Empty();
+	RemovedRoomDoorwayTransforms.Empty();
+	RoomMinCells.Empty();
+	RoomMaxCells.Empty();
+	DoorwayEdgeIndices.Empty();
+	DeadEndCellIndices.Empty();
+	CarvedLayout = FMazeLayout();
+	Pathfinder.Reset();
+	ResetFlowFields();
+	CellTagIndex.Reset();
+	ClearMergedGeometry();
+	ClearMergedCollision();
+	ClearVisibility();
+	ClearLODProxies();
+
+	// stop a materialization that is still running
+	MaterializationStage = EMazeMaterializationStage::EMMS_Done;
+	MaterializationIndex = 0;
+	SetActorTickEnabled(false);
+
+	// the pool limits may have changed since the pieces were pooled
+	TrimPiecePools(bPoolPieces ? PiecePoolMaxSize : 0);
+
+	for (int32 Type = 0; Type < static_cast<int32>(EMazePieceType::EMPT_MAX); Type++)
+	{
+		const EMazePieceType PieceType = static_cast<EMazePieceType>(Type);
+		FMazePieceTable& Table = GetPieceTable(PieceType);
+		for (UChildActorComponent* Component : Table.Components)
+		{
+			if (Component)
 			{
-				WallTileTransform.SetRotation(FRotator(0.f, 0.f, 0.f).Quaternion());
-				WallTileTransform.SetLocation(FVector(
-					(OuterWallSize.X + OuterCornerSize.Y) * i  - (FloorSize.X * (MazeWidth - 1)) / 2,
-					(-((FloorSize.X) + (FloorSize.X * (MazeHeight - 1))) / 2),
-					(OuterWallSize.Z + FloorSize.Z) / 2));
-
-				CreateChildActorInstance(WallTileTransform,
-					OuterWallActorClass,
-					OuterWallSceneComp,
-					FName(TEXT("Outer Wall -Y " + FString::FromInt(i) + ", " + FString::FromInt(j))),
-					&OuterWallContainer);
+				ReleasePiece(PieceType, Component);
 			}
+		}
+		Table.Reset(0);
 
-			// Set Outer Walls +Y 
-			if (j == (MazeHeight - 1))
+		TSet<USceneComponent*> PooledComponents;
+		PooledComponents.Reserve(Table.Pool.Num());
+		for (UChildActorComponent* Component : Table.Pool)
+		{
+			PooledComponents.Add(Component);
+		}
+		
+		USceneComponent* SceneComp = GetPieceSceneComponent(PieceType);
+		for (int32 i = SceneComp->GetAttachChildren().Num(); i > 0; i--)
+		{
+			USceneComponent* Child = SceneComp->GetAttachChildren()[i - 1];
+			// the instanced mesh and the pooled pieces are kept around and reused by the next generation
+			if (!Child || Child == Table.InstancedMesh.Get() || PooledComponents.Contains(Child))
 			{
-				WallTileTransform.SetRotation(FRotator(0.f, 180.f, 0.f).Quaternion());
-				WallTileTransform.SetLocation(FVector(
-					(OuterWallSize.X + OuterCornerSize.Y) * i  - (FloorSize.X * (MazeWidth - 1)) / 2,
-					(((FloorSize.X) + (FloorSize.X * (MazeHeight - 1))) / 2),
-					(OuterWallSize.Z + FloorSize.Z) / 2));
-
-				CreateChildActorInstance(WallTileTransform,
-					OuterWallActorClass,
-					OuterWallSceneComp,
-					FName(TEXT("Outer Wall +Y " + FString::FromInt(i) + ", " + FString::FromInt(j))),
-					&OuterWallContainer);
+				continue;
 			}
+			Child->DestroyComponent();
+			GenerationStats.ComponentsDestroyed++;
 		}
 	}
 }
 
-void AMazeBase::GenerateCorners()
+bool AMazeBase::UpdatePieceSizes()
+{
+	if (!bUseMeshSizes)
+	{
+		return true;
+	}
+	
+	if (!FloorMeshSize)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The maze is using the floor mesh size but does not have a floor mesh set"));
+		return false;
+	}
+	
+	if (!InnerWallMeshSize || !OuterWallMeshSize)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The maze is using the wall mesh size but does not have a wall mesh set"));
+		return false;
+	}
+	
+	if (!InnerCornerMeshSize || !OuterCornerMeshSize)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The maze is using the corner mesh size but does not have a corner mesh set"));
+		return false;
+	}
+	
+	FloorSize = FloorMeshSize->GetBoundingBox().GetSize();
+	InnerWallSize = InnerWallMeshSize->GetBoundingBox().GetSize();
+	OuterWallSize = OuterWallMeshSize->GetBoundingBox().GetSize();
+	InnerCornerSize = InnerCornerMeshSize->GetBoundingBox().GetSize();
+	OuterCornerSize = OuterCornerMeshSize->GetBoundingBox().GetSize();
+	return true;
+}
+
+void AMazeBase::SpawnFloor(int32 CellIndex)
 {
-	if (bUseMeshSizes)
+	SpawnPiece(EMazePieceType::EMPT_Floor, CellIndex, GetCellTransform(CellIndex));
+}
+
+void AMazeBase::SpawnCellWalls(int32 CellIndex)
+{
+	const FIntPoint Cell = MazeGrid.ToCoordinates(CellIndex);
+	const int32 i = Cell.X;
+	const int32 j = Cell.Y;
+	
+	// set inner walls going x direction
+	if (i != MazeGrid.Width - 1 && MazeGrid.HasWall(CellIndex, EMazeDirection::EMD_PosX))
 	{
-		if (!InnerCornerMeshSize || !OuterCornerMeshSize)
+		const int32 EdgeIndex = MazeGrid.ToEdgeIndex(CellIndex, EMazeDirection::EMD_PosX);
+		SpawnPiece(EMazePieceType::EMPT_InnerWall, EdgeIndex, GetInnerWallTransform(EdgeIndex));
+	}
+
+	// set inner walls going y direction
+	if (j != MazeGrid.Height - 1 && MazeGrid.HasWall(CellIndex, EMazeDirection::EMD_PosY))
+	{
+		const int32 EdgeIndex = MazeGrid.ToEdgeIndex(CellIndex, EMazeDirection::EMD_PosY);
+		SpawnPiece(EMazePieceType::EMPT_InnerWall, EdgeIndex, GetInnerWallTransform(EdgeIndex));
+	}
+	
+	// set outer walls -X 
+	if (i == 0)
+	{
+		const int32 OuterEdgeIndex = MazeGrid.ToOuterEdgeIndex(EMazeDirection::EMD_NegX, j);
+		if (!IsOuterWallOpen(OuterEdgeIndex))
 		{
-			UE_LOG(LogTemp, Error, TEXT("The maze is using the corner mesh size but does not have a corner mesh set"));
-			return;
+			SpawnPiece(EMazePieceType::EMPT_OuterWall, OuterEdgeIndex, GetOuterWallTransform(OuterEdgeIndex));
 		}
-		InnerCornerSize = InnerCornerMeshSize->GetBoundingBox().GetSize();
-		OuterCornerSize = OuterCornerMeshSize->GetBoundingBox().GetSize();
 	}
 
-	FTransform CornerTileTransform;
+	// set outer walls +X 
+	if (i == (MazeGrid.Width - 1))
+	{
+		const int32 OuterEdgeIndex = MazeGrid.ToOuterEdgeIndex(EMazeDirection::EMD_PosX, j);
+		if (!IsOuterWallOpen(OuterEdgeIndex))
+		{
+			SpawnPiece(EMazePieceType::EMPT_OuterWall, OuterEdgeIndex, GetOuterWallTransform(OuterEdgeIndex));
+		}
+	}
+	
+	// Set Outer Walls -Y 
+	if (j == 0)
+	{
+		const int32 OuterEdgeIndex = MazeGrid.ToOuterEdgeIndex(EMazeDirection::EMD_NegY, i);
+		if (!IsOuterWallOpen(OuterEdgeIndex))
+		{
+			SpawnPiece(EMazePieceType::EMPT_OuterWall, OuterEdgeIndex, GetOuterWallTransform(OuterEdgeIndex));
+		}
+	}
 
-	for (int32 i = 0; i < MazeWidth + 1; i++)
+	// Set Outer Walls +Y 
+	if (j == (MazeGrid.Height - 1))
 	{
-		for (int32 j = 0; j < MazeHeight + 1; j++)
+		const int32 OuterEdgeIndex = MazeGrid.ToOuterEdgeIndex(EMazeDirection::EMD_PosY, i);
+		if (!IsOuterWallOpen(OuterEdgeIndex))
 		{
-			if (i == 0 || j == 0 || i == MazeWidth || j == MazeHeight)
-			{
-				CornerTileTransform.SetLocation(FVector(
-					(((i * FloorSize.X) - (FloorSize.X * (MazeWidth - 1)) / 2) - FloorSize.X / 2),
-					(((j * FloorSize.Y) - (FloorSize.Y * (MazeHeight - 1)) / 2) - FloorSize.Y / 2),
-					(OuterCornerSize.Z + FloorSize.Z) / 2));
-
-				CreateChildActorInstance(CornerTileTransform,
-					OuterCornerActorClass,
-					OuterCornerSceneComp,
-					FName(TEXT("Outer Corner " + FString::FromInt(i) + ", " + FString::FromInt(j))),
-					&OuterCornerContainer);
-			}
-			else
-			{
-				CornerTileTransform.SetLocation(FVector(
-					((i * FloorSize.X) - (FloorSize.X * (MazeWidth - 1)) / 2) - FloorSize.X / 2,
-					((j * FloorSize.Y) - (FloorSize.Y * (MazeHeight - 1)) / 2) - FloorSize.Y / 2,
-					(InnerCornerSize.Z + FloorSize.Z) / 2));
-				
-				CreateChildActorInstance(CornerTileTransform,
-					InnerCornerActorClass,
-					InnerCornerSceneComp,
-					FName(TEXT("Inner Corner " + FString::FromInt(i) + ", " + FString::FromInt(j))),
-					&InnerCornerContainer);
-			}
+			SpawnPiece(EMazePieceType::EMPT_OuterWall, OuterEdgeIndex, GetOuterWallTransform(OuterEdgeIndex));
 		}
 	}
 }
 
-void AMazeBase::CreateChildActorInstance(FTransform Transform, UClass* Class,
+void AMazeBase::SpawnCorner(int32 CornerIndex)
+{
+	const FIntPoint Corner = MazeGrid.CornerToCoordinates(CornerIndex);
+	if (MazeGrid.IsOuterCorner(Corner.X, Corner.Y))
+	{
+		SpawnPiece(EMazePieceType::EMPT_OuterCorner, CornerIndex, GetCornerTransform(CornerIndex));
+	}
+	else if (MazeGrid.IsCornerTouchingWall(Corner.X, Corner.Y))
+	{
+		SpawnPiece(EMazePieceType::EMPT_InnerCorner, CornerIndex, GetCornerTransform(CornerIndex));
+	}
+}
+
+UChildActorComponent* AMazeBase::CreateChildActorInstance(FTransform Transform, UClass* Class,
 	TObjectPtr<USceneComponent> ParentSceneComponent, FName ComponentName,
 	TArray<TObjectPtr<UChildActorComponent>>* Container)
 {
@@ -394,903 +756,2214 @@ void AMazeBase::CreateChildActorInstance(FTransform Transform, UClass* Class,
 			
 	if (TempComp)
 	{
+		GenerationStats.ComponentsCreated++;
 		TempComp->CreationMethod = EComponentCreationMethod::Instance;
 		TempComp->SetupAttachment(ParentSceneComponent);
 		TempComp->RegisterComponent();
 		TempComp->SetChildActorClass(Class); // TODO: Make this an array and add random option
 		TempComp->SetRelativeTransform(Transform);
-		Container->Add(TempComp);
+		if (Container)
+		{
+			Container->Add(TempComp);
+		}
 	}
+	return TempComp;
 }
 
-void AMazeBase::InitializeRandomStreamSeeds()
+void FMazePieceTable::Reset(int32 NumPieces)
 {
-	MazeRandomStream.Initialize(Seed);
-	RoomRandomStream.Initialize(Seed);
-}
-
-void AMazeBase::GenerateAndSetRandomSeed()
+	Components.Reset();
+	Components.SetNumZeroed(NumPieces);
+	Instances.Init(INDEX_NONE, NumPieces);
+	InstancePieces.Reset();
+	PendingPieces.Reset();
+	PendingTransforms.Reset();
+	
+	if (InstancedMesh)
+	{
+		InstancedMesh->ClearInstances();
+	}
+}
+
+FMazePieceTable& AMazeBase::GetPieceTable(EMazePieceType Type)
 {
-	SetMazeSeed(FMath::Rand());
+	if (PieceTables.Num() != static_cast<int32>(EMazePieceType::EMPT_MAX))
+	{
+		PieceTables.SetNum(static_cast<int32>(EMazePieceType::EMPT_MAX));
+	}
+	return PieceTables[static_cast<int32>(Type)];
 }
 
-void AMazeBase::RegenerateMaze()
+void AMazeBase::InitializePieceTables()
 {
-	if (!bUseCustomSeed && bGenerateRandomSeed)
+	GetPieceTable(EMazePieceType::EMPT_Floor).Reset(MazeGrid.Num());
+	GetPieceTable(EMazePieceType::EMPT_InnerWall).Reset(MazeGrid.NumEdges());
+	GetPieceTable(EMazePieceType::EMPT_OuterWall).Reset(MazeGrid.NumOuterEdges());
+	GetPieceTable(EMazePieceType::EMPT_InnerCorner).Reset(MazeGrid.NumCorners());
+	GetPieceTable(EMazePieceType::EMPT_OuterCorner).Reset(MazeGrid.NumCorners());
+}
+
+UClass* AMazeBase::GetPieceClass(EMazePieceType Type) const
+{
+	switch (Type)
 	{
-		GenerateAndSetRandomSeed();
+	case EMazePieceType::EMPT_Floor :
+		return FloorActorClass;
+	case EMazePieceType::EMPT_InnerWall :
+		return InnerWallActorClass;
+	case EMazePieceType::EMPT_OuterWall :
+		return OuterWallActorClass;
+	case EMazePieceType::EMPT_InnerCorner :
+		return InnerCornerActorClass;
+	case EMazePieceType::EMPT_OuterCorner :
+		return OuterCornerActorClass;
+	default:
+		return nullptr;
+	}
+}
+
+UStaticMesh* AMazeBase::GetPieceMesh(EMazePieceType Type) const
+{
+	switch (Type)
+	{
+	case EMazePieceType::EMPT_Floor :
+		return FloorMeshSize;
+	case EMazePieceType::EMPT_InnerWall :
+		return InnerWallMeshSize;
+	case EMazePieceType::EMPT_OuterWall :
+		return OuterWallMeshSize;
+	case EMazePieceType::EMPT_InnerCorner :
+		return InnerCornerMeshSize;
+	case EMazePieceType::EMPT_OuterCorner :
+		return OuterCornerMeshSize;
+	default:
+		return nullptr;
 	}
+}
 
-	ClearMaze();
-	InitializeRandomStreamSeeds();
-	GenerateFloors();
-	GenerateCorners();
-	GenerateWalls();
-	GenerateRooms();
-	ImplementMazeAlgorithm();
-	CarveEntryAndExit();
+USceneComponent* AMazeBase::GetPieceSceneComponent(EMazePieceType Type) const
+{
+	switch (Type)
+	{
+	case EMazePieceType::EMPT_Floor :
+		return FloorSceneComp;
+	case EMazePieceType::EMPT_InnerWall :
+		return InnerWallSceneComp;
+	case EMazePieceType::EMPT_OuterWall :
+		return OuterWallSceneComp;
+	case EMazePieceType::EMPT_InnerCorner :
+		return InnerCornerSceneComp;
+	case EMazePieceType::EMPT_OuterCorner :
+		return OuterCornerSceneComp;
+	default:
+		return CenterSceneComp;
+	}
 }
 
-void AMazeBase::GenerateRooms()
+TArray<TObjectPtr<UChildActorComponent>>* AMazeBase::GetPieceContainer(EMazePieceType Type)
 {
-	if (!bCreateRooms || NumberOfRooms <= 0)
+	switch (Type)
 	{
-		return;
+	case EMazePieceType::EMPT_Floor :
+		return &FloorContainer;
+	case EMazePieceType::EMPT_InnerWall :
+		return &InnerWallContainer;
+	case EMazePieceType::EMPT_OuterWall :
+		return &OuterWallContainer;
+	case EMazePieceType::EMPT_InnerCorner :
+		return &InnerCornerContainer;
+	case EMazePieceType::EMPT_OuterCorner :
+		return &OuterCornerContainer;
+	default:
+		return nullptr;
+	}
+}
+
+bool AMazeBase::UsesInstancedMesh(EMazePieceType Type) const
+{
+	return RenderBackend == EMazeRenderBackend::EMRB_InstancedMeshes
+		&& (ChildActorPieceTypes & (1 << static_cast<int32>(Type))) == 0
+		&& GetPieceMesh(Type) != nullptr;
+}
+
+UHierarchicalInstancedStaticMeshComponent* AMazeBase::GetOrCreateInstancedMesh(EMazePieceType Type)
+{
+	FMazePieceTable& Table = GetPieceTable(Type);
+	if (!Table.InstancedMesh)
+	{
+		Table.InstancedMesh = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+		if (!Table.InstancedMesh)
+		{
+			return nullptr;
+		}
+		GenerationStats.ComponentsCreated++;
+		Table.InstancedMesh->CreationMethod = EComponentCreationMethod::Instance;
+		Table.InstancedMesh->SetupAttachment(GetPieceSceneComponent(Type));
+		Table.InstancedMesh->RegisterComponent();
+	}
+
+	Table.InstancedMesh->SetCollisionEnabled(bMergedCollision ? ECollisionEnabled::NoCollision : ECollisionEnabled::QueryAndPhysics);
+
+	// instances are culled one by one, unlike the component bounds that cover the whole maze
+	const int32 InstanceDrawDistance = FMath::CeilToInt32(GetPieceDrawDistance());
+	if (Table.InstancedMesh->InstanceEndCullDistance != InstanceDrawDistance)
+	{
+		Table.InstancedMesh->SetCullDistances(InstanceDrawDistance, InstanceDrawDistance);
+	}
+
+	if (Table.InstancedMesh->GetStaticMesh() != GetPieceMesh(Type))
+	{
+		Table.InstancedMesh->SetStaticMesh(GetPieceMesh(Type));
+	}
+	return Table.InstancedMesh;
+}
+
+bool AMazeBase::UsesMergedGeometry(EMazePieceType Type) const
+{
+	if (RenderBackend != EMazeRenderBackend::EMRB_MergedGeometry || (ChildActorPieceTypes & (1 << static_cast<int32>(Type))) != 0)
+	{
+		return false;
+	}
+
+	switch (Type)
+	{
+	case EMazePieceType::EMPT_InnerCorner :
+		return UsesMergedGeometry(EMazePieceType::EMPT_InnerWall);
+	case EMazePieceType::EMPT_OuterCorner :
+		return UsesMergedGeometry(EMazePieceType::EMPT_OuterWall);
+	default:
+		return true;
+	}
+}
+
+TArray<int32> AMazeBase::GetOpenOuterEdges() const
+{
+	TArray<int32> OpenOuterEdges = OpenOuterEdgeIndices;
+	if (EntryOuterEdgeIndex != INDEX_NONE)
+	{
+		OpenOuterEdges.Add(EntryOuterEdgeIndex);
+	}
+	if (ExitOuterEdgeIndex != INDEX_NONE)
+	{
+		OpenOuterEdges.Add(ExitOuterEdgeIndex);
+	}
+	return OpenOuterEdges;
+}
+
+FMazeMergedGeometrySizes AMazeBase::GetMergedGeometrySizes() const
+{
+	FMazeMergedGeometrySizes Sizes;
+	Sizes.Floor = FloorSize;
+	Sizes.InnerWall = InnerWallSize;
+	Sizes.OuterWall = OuterWallSize;
+	Sizes.InnerCorner = InnerCornerSize;
+	Sizes.OuterCorner = OuterCornerSize;
+	return Sizes;
+}
+
+FMazeMergedGeometryBuilder AMazeBase::MakeMergedGeometryBuilder() const
+{
+	return FMazeMergedGeometryBuilder(MazeGrid, GetOpenOuterEdges(), GetMergedGeometrySizes(), MergedChunkSize);
+}
+
+UProceduralMeshComponent* AMazeBase::GetOrCreateMergedChunkMesh(int32 ChunkIndex)
+{
+	if (MergedChunkMeshes.Num() <= ChunkIndex)
+	{
+		MergedChunkMeshes.SetNum(ChunkIndex + 1);
+	}
+	
+	TObjectPtr<UProceduralMeshComponent>& Mesh = MergedChunkMeshes[ChunkIndex];
+	if (!Mesh)
+	{
+		Mesh = NewObject<UProceduralMeshComponent>(this);
+		if (!Mesh)
+		{
+			return nullptr;
+		}
+		GenerationStats.ComponentsCreated++;
+		Mesh->CreationMethod = EComponentCreationMethod::Instance;
+		Mesh->bUseAsyncCooking = true;
+		Mesh->SetupAttachment(CenterSceneComp);
+		Mesh->RegisterComponent();
+	}
+	Mesh->SetCullDistance(GetPieceDrawDistance(0.5 * MergedChunkSize * FVector2D(FloorSize.X, FloorSize.Y).Size()));
+	return Mesh;
+}
+
+void AMazeBase::RebuildMergedGeometry()
+{
+	MergedPieceTypes = 0;
+	for (int32 Type = 0; Type < static_cast<int32>(EMazePieceType::EMPT_MAX); Type++)
+	{
+		if (UsesMergedGeometry(static_cast<EMazePieceType>(Type)))
+		{
+			MergedPieceTypes |= 1 << Type;
+		}
 	}
 	
-	if (RoomHeight >= MazeHeight || RoomWidth >= MazeWidth)
+	if (MergedPieceTypes == 0 || MazeGrid.Num() == 0)
 	{
-		UE_LOG(LogTemp, Error, TEXT("Room height or room width is too large."));
+		ClearMergedGeometry();
 		return;
 	}
 
-	int32 XRandMin = 1;
-	int32 YRandMin = 1;
-	int32 XRandMax = (MazeWidth - 1) - RoomWidth;
-	int32 YRandMax = (MazeHeight - 1) - RoomHeight;
+	const int32 NumChunks = MakeMergedGeometryBuilder().NumChunks();
+	TArray<int32> Chunks;
+	Chunks.Reserve(NumChunks);
+	for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ChunkIndex++)
+	{
+		Chunks.Add(ChunkIndex);
+	}
+	RebuildMergedChunks(Chunks);
+}
+
+void AMazeBase::RebuildMergedChunks(const TArray<int32>& Chunks)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const FMazeMergedGeometryBuilder Builder = MakeMergedGeometryBuilder();
+
+	// chunk meshes of a bigger maze or a smaller chunk size
+	for (int32 ChunkIndex = MergedChunkMeshes.Num(); ChunkIndex > Builder.NumChunks(); ChunkIndex--)
+	{
+		if (MergedChunkMeshes[ChunkIndex - 1])
+		{
+			MergedChunkMeshes[ChunkIndex - 1]->DestroyComponent();
+			GenerationStats.ComponentsDestroyed++;
+		}
+	}
+	if (MergedChunkMeshes.Num() > Builder.NumChunks())
+	{
+		MergedChunkMeshes.SetNum(Builder.NumChunks());
+	}
+
+	FMazeMergedChunk Chunk;
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	for (int32 ChunkIndex : Chunks)
+	{
+		UProceduralMeshComponent* Mesh = GetOrCreateMergedChunkMesh(ChunkIndex);
+		if (!Mesh)
+		{
+			continue;
+		}
+		
+		Builder.BuildChunk(ChunkIndex, Chunk);
+		for (int32 Section = 0; Section < static_cast<int32>(EMazeMergedSection::EMMS_MAX); Section++)
+		{
+			const EMazePieceType PieceType = MazeBase::MergedSectionPieceTypes[Section];
+			if ((MergedPieceTypes & (1 << static_cast<int32>(PieceType))) == 0 || Chunk.Boxes[Section].IsEmpty())
+			{
+				Mesh->ClearMeshSection(Section);
+				continue;
+			}
+
+			Vertices.Reset();
+			Triangles.Reset();
+			Normals.Reset();
+			UVs.Reset();
+			for (const FBox& Box : Chunk.Boxes[Section])
+			{
+				FMazeMergedGeometryBuilder::AppendBox(Box, Vertices, Triangles, Normals, UVs);
+			}
+			Mesh->CreateMeshSection(Section, Vertices, Triangles, Normals, UVs, TArray<FColor>(), TArray<FProcMeshTangent>(), !bMergedCollision);
+
+			const UStaticMesh* PieceMesh = GetPieceMesh(PieceType);
+			Mesh->SetMaterial(Section, PieceMesh ? PieceMesh->GetMaterial(0) : nullptr);
+		}
+	}
+
+	UE_LOG(LogTemp, Verbose, TEXT("Built %d merged geometry chunks in %.2f ms"), Chunks.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+void AMazeBase::ClearMergedGeometry()
+{
+	MergedPieceTypes = 0;
+	for (UProceduralMeshComponent* Mesh : MergedChunkMeshes)
+	{
+		if (Mesh)
+		{
+			Mesh->ClearAllMeshSections();
+		}
+	}
+}
+
+SIZE_T AMazeBase::GetPieceDataAllocatedSize() const
+{
+	SIZE_T Size = MazeGrid.Cells.GetAllocatedSize() + PieceTables.GetAllocatedSize();
+	for (const FMazePieceTable& Table : PieceTables)
+	{
+		Size += Table.Components.GetAllocatedSize() + Table.Instances.GetAllocatedSize() + Table.InstancePieces.GetAllocatedSize() + Table.Pool.GetAllocatedSize();
+	}
+	for (const TArray<TObjectPtr<UChildActorComponent>>* Container : { &FloorContainer, &InnerWallContainer, &OuterWallContainer, &InnerCornerContainer, &OuterCornerContainer })
+	{
+		Size += Container->GetAllocatedSize();
+	}
+	return Size;
+}
+
+void AMazeBase::ApplyPieceCollision(UChildActorComponent* Component) const
+{
+	if (AActor* ChildActor = Component->GetChildActor())
+	{
+		if (ChildActor->GetActorEnableCollision() == bMergedCollision)
+		{
+			ChildActor->SetActorEnableCollision(!bMergedCollision);
+		}
+	}
+}
+
+UProceduralMeshComponent* AMazeBase::GetOrCreateLODProxyMesh(int32 BlockIndex)
+{
+	if (LODProxyMeshes.Num() <= BlockIndex)
+	{
+		LODProxyMeshes.SetNum(BlockIndex + 1);
+	}
+	
+	TObjectPtr<UProceduralMeshComponent>& Mesh = LODProxyMeshes[BlockIndex];
+	if (!Mesh)
+	{
+		Mesh = NewObject<UProceduralMeshComponent>(this);
+		if (!Mesh)
+		{
+			return nullptr;
+		}
+		GenerationStats.ComponentsCreated++;
+		Mesh->CreationMethod = EComponentCreationMethod::Instance;
+		Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Mesh->SetupAttachment(CenterSceneComp);
+		Mesh->RegisterComponent();
+	}
+	return Mesh;
+}
 
-	for (int32 i = 0; i < NumberOfRooms; i++)
+void AMazeBase::RebuildLODProxies()
+{
+	if (!bBuildLODProxies || LODProxyDistance <= 0.f || MazeGrid.Num() == 0)
 	{
-		bool bRoomsSpawned = false;
-		int32 LoopCounter = 0; // keeps track of times around loop, will cancel at 20
+		ClearLODProxies();
+		return;
+	}
 
-		LOOP: while (!bRoomsSpawned)
+	const double StartTime = FPlatformTime::Seconds();
+	const FMazeMergedGeometryBuilder Builder(MazeGrid, GetOpenOuterEdges(), GetMergedGeometrySizes(), LODProxyBlockSize);
+
+	// proxy meshes of a bigger maze or a smaller block size
+	for (int32 BlockIndex = LODProxyMeshes.Num(); BlockIndex > Builder.NumChunks(); BlockIndex--)
+	{
+		if (LODProxyMeshes[BlockIndex - 1])
 		{
-			LoopCounter++;
+			LODProxyMeshes[BlockIndex - 1]->DestroyComponent();
+			GenerationStats.ComponentsDestroyed++;
+		}
+	}
+	if (LODProxyMeshes.Num() > Builder.NumChunks())
+	{
+		LODProxyMeshes.SetNum(Builder.NumChunks());
+	}
 
-			int32 RoomRandY = RoomRandomStream.RandRange(YRandMin, YRandMax);
-			int32 RoomRandX = RoomRandomStream.RandRange(XRandMin, XRandMax);
-			FIntPoint CellCoord(RoomRandX, RoomRandY);
+	LODProxyCount = 0;
+	FMazeMergedChunk Block;
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	for (int32 BlockIndex = 0; BlockIndex < Builder.NumChunks(); BlockIndex++)
+	{
+		UProceduralMeshComponent* Mesh = GetOrCreateLODProxyMesh(BlockIndex);
+		if (!Mesh)
+		{
+			continue;
+		}
 
-			if(((NumberOfRooms * RoomWidth * RoomHeight) > ((MazeHeight * MazeWidth) - (2 * (MazeHeight - 1) + 2 * (MazeWidth - 1)))) || (LoopCounter > 20))
+		// drawn from where the pieces of the block may stop being drawn, see GetPieceDrawDistance
+		Mesh->MinDrawDistance = LODProxyDistance;
+		Builder.BuildChunk(BlockIndex, Block);
+		for (int32 Section = 0; Section < static_cast<int32>(EMazeMergedSection::EMMS_MAX); Section++)
+		{
+			if (Block.Boxes[Section].IsEmpty())
 			{
-				bRoomsSpawned = true;
+				Mesh->ClearMeshSection(Section);
+				continue;
 			}
-			
-			FMazeCellData* CellFound = MazeData.Find(CellCoord);
-			if (CellFound)
+
+			Vertices.Reset();
+			Triangles.Reset();
+			Normals.Reset();
+			UVs.Reset();
+			for (const FBox& Box : Block.Boxes[Section])
 			{
-				TArray<FVector> RoomCellLocations;
-				TArray<FMazeCellData> TempCellData;
-				FBox RoomBounds;
-				//UE_LOG(LogTemp, Warning, TEXT("Cell Location: %d , %d"), CellFound->CellCoordinates.X, CellFound->CellCoordinates.Y);
-				
-				
-				for (int32 j = CellFound->MazeCellCoordinates.X; j < CellFound->MazeCellCoordinates.X + RoomWidth; j++)
-				{
-					for (int32 k = CellFound->MazeCellCoordinates.Y; k < CellFound->MazeCellCoordinates.Y + RoomHeight; k++)
-					{
-						FMazeCellData* TempCell = MazeData.Find(FIntPoint(j,k));
-						if (TempCell)
-						{
-							// if any of the cells found have been visited before, start process over
-							if (TempCell->bAlgorithmHasVisited)
-							{
-								goto LOOP; // start while loop again
-							}
-							TempCellData.Add(*TempCell);
-							RoomCellLocations.Add(TempCell->MazeCellTransform.GetLocation());
-						}
-					}
-				}
-				
-				int32 ArrayBounds = RoomCellLocations.Num() - 1; // cap the array bounds
-				FVector BoxHeight = FVector(0.f, 0.f, 2 * FloorSize.Z); // Vector to add to the room bounds to add height
-				RoomBounds = FBox(RoomCellLocations[0] + BoxHeight + GetActorLocation(), RoomCellLocations[ArrayBounds] + BoxHeight + GetActorLocation()); // create box to delete wall and corner instances
+				FMazeMergedGeometryBuilder::AppendBox(Box, Vertices, Triangles, Normals, UVs);
+			}
+			Mesh->CreateMeshSection(Section, Vertices, Triangles, Normals, UVs, TArray<FColor>(), TArray<FProcMeshTangent>(), false);
 
-				// Mark room cells as visited
-				for (auto Cell : TempCellData)
-				{
-					FMazeCellData* TempCell = MazeData.Find(FIntPoint(Cell.MazeCellCoordinates.X, Cell.MazeCellCoordinates.Y));
-					if (TempCell)
-					{
-						TempCell->bAlgorithmHasVisited = true;
-					}
-				}
+			const UStaticMesh* PieceMesh = GetPieceMesh(MazeBase::MergedSectionPieceTypes[Section]);
+			Mesh->SetMaterial(Section, PieceMesh ? PieceMesh->GetMaterial(0) : nullptr);
+		}
+		if (Block.NumBoxes() > 0)
+		{
+			LODProxyCount++;
+		}
+	}
 
-				// delete components to make rooms
-				TArray<TObjectPtr<USceneComponent>> ComponentsToDelete;
-				
-				for (auto Component : InnerWallContainer)
-				{
-					if (!Component || !Component->GetChildActor())
-					{
-						continue;
-					}
-					
-					if (RoomBounds.Intersect(Component->GetChildActor()->GetComponentsBoundingBox()))
-					{
-						ComponentsToDelete.Add(Component);
-					}
-				}
+	UE_LOG(LogTemp, Verbose, TEXT("Built %d LOD proxies in %.2f ms"), LODProxyCount, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
 
-				for (auto Component : InnerCornerContainer)
-				{
-					if (!Component || !Component->GetChildActor())
-					{
-						continue;
-					}
-					
-					if (RoomBounds.Intersect(Component->GetChildActor()->GetComponentsBoundingBox()))
-					{
-						ComponentsToDelete.Add(Component);
-					}
-				}
-				
-				// carve room doors
-				for (int32 RoomDoorCounter = 0; RoomDoorCounter < NumberOfRoomDoors; RoomDoorCounter++)
-				{
-					int32 RandPosX = RoomRandomStream.RandRange(0,RoomWidth - 1);
-					int32 RandPosY = RoomRandomStream.RandRange(0,RoomHeight - 1);
-					int32 RandSide = RoomRandomStream.RandRange(0,3);
-					FBox DoorBounds;
-					for (int32 j = TempCellData[0].MazeCellCoordinates.X; j <= TempCellData[TempCellData.Num() - 1].MazeCellCoordinates.X; j++)
-					{
-						for (int32 k = TempCellData[0].MazeCellCoordinates.Y; k <= TempCellData[TempCellData.Num() - 1].MazeCellCoordinates.Y; k++)
-						{
-							if (RandSide == 0)
-							{
-								if (j == TempCellData[0].MazeCellCoordinates.X)
-								{
-									if (k == TempCellData[0].MazeCellCoordinates.Y + RandPosY)
-									{
-										DoorBounds = FBox(MazeData.Find(FIntPoint(j - 1,k))->MazeCellTransform.GetLocation() + BoxHeight + GetActorLocation(),
-											MazeData.Find(FIntPoint(j,k))->MazeCellTransform.GetLocation() + BoxHeight + GetActorLocation());
-									}
-								}
-							}
-							else if (RandSide == 1)
-							{
-								if (j == TempCellData[TempCellData.Num() - 1].MazeCellCoordinates.X)
-								{
-									if (k == TempCellData[0].MazeCellCoordinates.Y + RandPosY)
-									{
-										DoorBounds = FBox(MazeData.Find(FIntPoint(j,k))->MazeCellTransform.GetLocation() + BoxHeight + GetActorLocation(),
-											MazeData.Find(FIntPoint(j + 1,k))->MazeCellTransform.GetLocation() + BoxHeight + GetActorLocation());
-									}
-								}
-							}
-							else if (RandSide == 2)
-							{
-								if (k == TempCellData[0].MazeCellCoordinates.Y)
-								{
-									if (j == TempCellData[0].MazeCellCoordinates.X + RandPosX)
-									{
-										DoorBounds = FBox(MazeData.Find(FIntPoint(j,k - 1))->MazeCellTransform.GetLocation() + BoxHeight + GetActorLocation(),
-											MazeData.Find(FIntPoint(j,k))->MazeCellTransform.GetLocation() + BoxHeight + GetActorLocation());
-									}
-								}
-							}
-							else if (RandSide == 3)
-							{
-								if (k == TempCellData[TempCellData.Num() - 1].MazeCellCoordinates.Y)
-								{
-									if (j == TempCellData[0].MazeCellCoordinates.X + RandPosX)
-									{
-										DoorBounds = FBox(MazeData.Find(FIntPoint(j,k))->MazeCellTransform.GetLocation() + BoxHeight + GetActorLocation(),
-											MazeData.Find(FIntPoint(j,k + 1))->MazeCellTransform.GetLocation() + BoxHeight + GetActorLocation());
-									}
-								}
-							}
-						}	
-					}
-			
-					
-					FTransform DoorwayTransform;
+void AMazeBase::ClearLODProxies()
+{
+	LODProxyCount = 0;
+	for (UProceduralMeshComponent* Mesh : LODProxyMeshes)
+	{
+		if (Mesh)
+		{
+			Mesh->ClearAllMeshSections();
+		}
+	}
+}
 
-					for (auto Component : InnerWallContainer)
-					{
-						if (!Component || !Component->GetChildActor())
-						{
-							continue;
-						}
-					
-						if (DoorBounds.Intersect(Component->GetChildActor()->GetComponentsBoundingBox()))
-						{
-							ComponentsToDelete.Add(Component);
-							DoorwayTransform = Component->GetComponentTransform();
-						}
-					}
+float AMazeBase::GetPieceDrawDistance(double ExtraRadius) const
+{
+	if (!bBuildLODProxies || LODProxyDistance <= 0.f)
+	{
+		return 0.f;
+	}
 
-					RemovedRoomDoorwayTransforms.Add(DoorwayTransform);
-				}
+	// a proxy switches on the distance to the center of its block, which is up to half a block diagonal away from its pieces
+	const double BlockRadius = 0.5 * LODProxyBlockSize * FVector2D(FloorSize.X, FloorSize.Y).Size();
+	return LODProxyDistance + (BlockRadius + ExtraRadius) * GetActorScale3D().GetAbsMax();
+}
 
-				// delete all room and door components
-				if (!ComponentsToDelete.IsEmpty())
-				{
-					for (int32 k = ComponentsToDelete.Num(); k > 0; k--)
-					{
-						if (!ComponentsToDelete[k - 1])
-						{
-							continue;
-						}
-						//ComponentsToDelete[k - 1]->UnregisterComponent();
-						ComponentsToDelete[k - 1]->DestroyComponent();
-					}
-				}
-				
-				RoomCenters.Add(RoomBounds.GetCenter());
-				bRoomsSpawned = true;
+void AMazeBase::ApplyPieceDrawDistance(UChildActorComponent* Component) const
+{
+	if (AActor* ChildActor = Component->GetChildActor())
+	{
+		const float DrawDistance = GetPieceDrawDistance();
+		ChildActor->ForEachComponent<UPrimitiveComponent>(false, [DrawDistance](UPrimitiveComponent* Primitive)
+		{
+			Primitive->SetCullDistance(DrawDistance);
+		});
+	}
+}
+
+void AMazeBase::ApplyLODEdit()
+{
+	for (int32 Type = 0; Type < static_cast<int32>(EMazePieceType::EMPT_MAX); Type++)
+	{
+		FMazePieceTable& Table = GetPieceTable(static_cast<EMazePieceType>(Type));
+		for (UChildActorComponent* Component : Table.Components)
+		{
+			if (Component)
+			{
+				ApplyPieceDrawDistance(Component);
 			}
 		}
+		if (Table.InstancedMesh)
+		{
+			GetOrCreateInstancedMesh(static_cast<EMazePieceType>(Type));
+		}
+	}
+	for (int32 ChunkIndex = 0; ChunkIndex < MergedChunkMeshes.Num(); ChunkIndex++)
+	{
+		if (MergedChunkMeshes[ChunkIndex])
+		{
+			GetOrCreateMergedChunkMesh(ChunkIndex);
+		}
+	}
+
+	RebuildLODProxies();
+}
+
+UProceduralMeshComponent* AMazeBase::GetOrCreateCollisionChunkMesh(int32 ChunkIndex)
+{
+	if (CollisionChunkMeshes.Num() <= ChunkIndex)
+	{
+		CollisionChunkMeshes.SetNum(ChunkIndex + 1);
+		CollisionChunkPrimitives.SetNumZeroed(ChunkIndex + 1);
+	}
+	
+	TObjectPtr<UProceduralMeshComponent>& Mesh = CollisionChunkMeshes[ChunkIndex];
+	if (!Mesh)
+	{
+		Mesh = NewObject<UProceduralMeshComponent>(this);
+		if (!Mesh)
+		{
+			return nullptr;
+		}
+		GenerationStats.ComponentsCreated++;
+		Mesh->CreationMethod = EComponentCreationMethod::Instance;
+		// the mesh has no sections, its collision is only the convex boxes
+		Mesh->bUseComplexAsSimpleCollision = false;
+		Mesh->bUseAsyncCooking = true;
+		Mesh->SetupAttachment(CenterSceneComp);
+		Mesh->RegisterComponent();
+	}
+	return Mesh;
+}
+
+void AMazeBase::RebuildMergedCollision()
+{
+	if (MazeGrid.Num() == 0)
+	{
+		ClearMergedCollision();
+		return;
+	}
+
+	const int32 NumChunks = MakeMergedGeometryBuilder().NumChunks();
+	TArray<int32> Chunks;
+	Chunks.Reserve(NumChunks);
+	for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ChunkIndex++)
+	{
+		Chunks.Add(ChunkIndex);
 	}
+	RebuildMergedCollisionChunks(Chunks);
 }
 
-void AMazeBase::ImplementMazeAlgorithm()
+void AMazeBase::RebuildMergedCollisionChunks(const TArray<int32>& Chunks)
 {
-	FIntPoint StartingCell; // cell used to start the algorithm
-	if (MazeData.Find(MazeAlgorithmStartingCell))
+	const FIntPoint GridSize(MazeGrid.Width, MazeGrid.Height);
+	if (PendingCollisionBuild)
 	{
-		if (MazeAlgorithmStartingCell.X > MazeWidth || MazeAlgorithmStartingCell.Y > MazeHeight || MazeData.Find(MazeAlgorithmStartingCell)->bAlgorithmHasVisited)
+		PendingCollisionBuild->bCancelled = true;
+		if (PendingCollisionChunkSize != MergedChunkSize || PendingCollisionGridSize != GridSize)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Maze Algorithm Starting Point is out of bounds, changing to (0, 0)"));
-			StartingCell = FIntPoint(0,0);
+			// the cancelled build numbered its chunks for another grid or chunk size, so none of them can be reused
+			PendingCollisionBuild.Reset();
+			PendingCollisionChunks.Reset();
+			RebuildMergedCollision();
+			return;
 		}
-		else
+		
+		for (int32 ChunkIndex : Chunks)
 		{
-			StartingCell = MazeAlgorithmStartingCell;
+			PendingCollisionChunks.AddUnique(ChunkIndex);
 		}
 	}
 	else
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Maze Algorithm Starting Point is out of bounds, changing to (0, 0)"));
-		StartingCell = FIntPoint(0,0);
+		PendingCollisionChunks = Chunks;
 	}
+	PendingCollisionChunkSize = MergedChunkSize;
+	PendingCollisionGridSize = GridSize;
 
-	DeadEnds.Empty();
-	TArray<FMazeCellData> CellQueue;
-	int32 CurX = StartingCell.X;
-	int32 CurY = StartingCell.Y;
+	const TSharedRef<FMazeAsyncGeneration, ESPMode::ThreadSafe> Build = MakeShared<FMazeAsyncGeneration, ESPMode::ThreadSafe>();
+	PendingCollisionBuild = Build;
 	
-	FMazeCellData* CurrentCell = MazeData.Find(FIntPoint(CurX, CurY));
-	bool bDoneIterating = false;
-	TArray<FMazeCellData> UnVisitedNearbyCells;
-
-	bool bCheckPrevious = false;
-	bool bEndCounter = false; // used to find all of the dead ends
+	const double StartTime = FPlatformTime::Seconds();
+	TWeakObjectPtr<AMazeBase> WeakThis(this);
 	
-	while (!bDoneIterating)
+	// the worker gets its own copy of the grid, the maze can change while it runs
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakThis, Build, Grid = MazeGrid, OpenOuterEdges = GetOpenOuterEdges(), Sizes = GetMergedGeometrySizes(),
+		ChunkSize = MergedChunkSize, Chunks = PendingCollisionChunks, StartTime]()
 	{
-		if (CurrentCell)
+		const FMazeMergedGeometryBuilder Builder(Grid, OpenOuterEdges, Sizes, ChunkSize);
+		TArray<TArray<TArray<FVector>>> ChunkConvexes;
+		ChunkConvexes.SetNum(Chunks.Num());
+		FMazeMergedChunk Chunk;
+		for (int32 i = 0; i < Chunks.Num(); i++)
 		{
-			if (!bCheckPrevious)
+			if (Build->bCancelled)
 			{
-				CellQueue.Add(*CurrentCell);
+				return;
 			}
 			
-			CurrentCell->bAlgorithmHasVisited = true;
-			ECellPosition CurrentCellPosition = CurrentCell->CellPosition;
-			int32 RandDir;
-			
-			FMazeCellData* CheckCell = nullptr;
-			switch (CurrentCellPosition)
+			Builder.BuildChunk(Chunks[i], Chunk);
+			ChunkConvexes[i].Reserve(Chunk.NumBoxes());
+			for (const TArray<FBox>& SectionBoxes : Chunk.Boxes)
 			{
-			case ECellPosition::ECP_Normal :
-					
-				CheckCell = MazeData.Find(FIntPoint(CurX + 1, CurY)); // cell up
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY + 1)); // cell right
-				if (CheckCell)
+				for (const FBox& Box : SectionBoxes)
 				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
+					FMazeMergedGeometryBuilder::GetBoxCorners(Box, ChunkConvexes[i].AddDefaulted_GetRef());
 				}
+			}
+		}
 
-				CheckCell = MazeData.Find(FIntPoint(CurX - 1, CurY)); // cell down
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Build, Chunks, ChunkConvexes = MoveTemp(ChunkConvexes), NumChunks = Builder.NumChunks(), StartTime]()
+		{
+			AMazeBase* Maze = WeakThis.Get();
+			if (!Maze || Build->bCancelled || Maze->PendingCollisionBuild.Get() != &Build.Get())
+			{
+				return;
+			}
+			
+			Maze->PendingCollisionBuild.Reset();
+			Maze->PendingCollisionChunks.Reset();
+			Maze->ApplyMergedCollision(Chunks, ChunkConvexes, NumChunks, StartTime);
+		});
+	});
+}
 
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY - 1)); // cell left
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				break;
-				
-			case ECellPosition::ECP_LeftSide :
-					
-				CheckCell = MazeData.Find(FIntPoint(CurX + 1, CurY)); // cell up
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-					
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY + 1)); // cell right
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
+void AMazeBase::ApplyMergedCollision(const TArray<int32>& Chunks, const TArray<TArray<TArray<FVector>>>& ChunkConvexes, int32 NumChunks, double StartTime)
+{
+	const double BodyStartTime = FPlatformTime::Seconds();
 
-				CheckCell = MazeData.Find(FIntPoint(CurX - 1, CurY)); // cell down
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				break;
-				
-			case ECellPosition::ECP_RightSide :
+	// chunk meshes of a bigger maze or a smaller chunk size
+	for (int32 ChunkIndex = CollisionChunkMeshes.Num(); ChunkIndex > NumChunks; ChunkIndex--)
+	{
+		if (CollisionChunkMeshes[ChunkIndex - 1])
+		{
+			CollisionChunkMeshes[ChunkIndex - 1]->DestroyComponent();
+			GenerationStats.ComponentsDestroyed++;
+		}
+	}
+	if (CollisionChunkMeshes.Num() > NumChunks)
+	{
+		CollisionChunkMeshes.SetNum(NumChunks);
+		CollisionChunkPrimitives.SetNum(NumChunks);
+	}
+	
+	for (int32 i = 0; i < Chunks.Num(); i++)
+	{
+		if (UProceduralMeshComponent* Mesh = GetOrCreateCollisionChunkMesh(Chunks[i]))
+		{
+			// the body setup is cooked asynchronously because bUseAsyncCooking is set
+			Mesh->SetCollisionConvexMeshes(ChunkConvexes[i]);
+			CollisionChunkPrimitives[Chunks[i]] = ChunkConvexes[i].Num();
+		}
+	}
 
-				CheckCell = MazeData.Find(FIntPoint(CurX + 1, CurY)); // cell up
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
+	const double EndTime = FPlatformTime::Seconds();
+	MergedCollisionBodyCreationMs = (EndTime - BodyStartTime) * 1000.0;
+	UE_LOG(LogTemp, Log, TEXT("Maze collision of %d chunks built in %.2f ms with %d box primitives, %.2f ms of it creating bodies"),
+		Chunks.Num(), (EndTime - StartTime) * 1000.0, GetMergedCollisionPrimitiveCount(), MergedCollisionBodyCreationMs);
+}
 
-				CheckCell = MazeData.Find(FIntPoint(CurX - 1, CurY)); // cell down
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
+void AMazeBase::ClearMergedCollision()
+{
+	if (PendingCollisionBuild)
+	{
+		PendingCollisionBuild->bCancelled = true;
+		PendingCollisionBuild.Reset();
+	}
+	PendingCollisionChunks.Reset();
 
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY - 1)); // cell left
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				break;
-				
-			case ECellPosition::ECP_TopSide :
-					
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY + 1)); // cell right
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
+	for (UProceduralMeshComponent* Mesh : CollisionChunkMeshes)
+	{
+		if (Mesh)
+		{
+			Mesh->ClearCollisionConvexMeshes();
+		}
+	}
+	for (int32& Primitives : CollisionChunkPrimitives)
+	{
+		Primitives = 0;
+	}
+}
 
-				CheckCell = MazeData.Find(FIntPoint(CurX - 1, CurY)); // cell down
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
+void AMazeBase::RebuildVisibility()
+{
+	ClearVisibility();
 
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY - 1)); // cell left
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				break;
-				
-			case ECellPosition::ECP_BottomSide :
+	const TSharedRef<FMazeAsyncGeneration, ESPMode::ThreadSafe> Build = MakeShared<FMazeAsyncGeneration, ESPMode::ThreadSafe>();
+	PendingVisibilityBuild = Build;
+	TWeakObjectPtr<AMazeBase> WeakThis(this);
 
-				CheckCell = MazeData.Find(FIntPoint(CurX + 1, CurY)); // cell up
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-					
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY + 1)); // cell right
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY - 1)); // cell left
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				break;
-				
-			case ECellPosition::ECP_BottomRightCorner :
+	// built into a local set that only replaces Visibility on the game thread, so culling keeps using the old one meanwhile
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakThis, Build, Grid = MazeGrid, Radius = VisibilityRadius]()
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		FMazeVisibility NewVisibility;
+		NewVisibility.Build(Grid, Radius);
+		const float BuildMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		if (Build->bCancelled)
+		{
+			return;
+		}
 
-				CheckCell = MazeData.Find(FIntPoint(CurX + 1, CurY)); // cell up
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Build, NewVisibility = MoveTemp(NewVisibility), BuildMs]() mutable
+		{
+			AMazeBase* Maze = WeakThis.Get();
+			if (!Maze || Build->bCancelled || Maze->PendingVisibilityBuild.Get() != &Build.Get())
+			{
+				return;
+			}
 
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY - 1)); // cell left
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				break;
-				
-			case ECellPosition::ECP_BottomLeftCorner :
+			Maze->PendingVisibilityBuild.Reset();
+			Maze->Visibility = MoveTemp(NewVisibility);
+			Maze->VisibilityBuildMs = BuildMs;
+			Maze->PieceCullingCell = INDEX_NONE;
+			if (!Maze->Visibility.IsBuilt())
+			{
+				return;
+			}
+			UE_LOG(LogTemp, Log, TEXT("Maze visibility of %d cells with a radius of %d built in %.2f ms, %.1f KB"),
+				Maze->Visibility.Num(), Maze->Visibility.GetRadius(), BuildMs, Maze->Visibility.GetAllocatedSize() / 1024.0);
+		});
+	});
+}
 
-				CheckCell = MazeData.Find(FIntPoint(CurX + 1, CurY)); // cell up
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY + 1)); // cell right
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				break;
-				
-			case ECellPosition::ECP_TopRightCorner :
+void AMazeBase::ClearVisibility()
+{
+	if (PendingVisibilityBuild)
+	{
+		PendingVisibilityBuild->bCancelled = true;
+		PendingVisibilityBuild.Reset();
+	}
+	ClearPieceCulling();
+	Visibility.Reset();
+}
 
-				CheckCell = MazeData.Find(FIntPoint(CurX - 1, CurY)); // cell down
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
+bool AMazeBase::IsCellVisibleFrom(FIntPoint FromCell, FIntPoint ToCell) const
+{
+	if (!MazeGrid.IsValidCoordinates(FromCell) || !MazeGrid.IsValidCoordinates(ToCell) || Visibility.Num() != MazeGrid.Num())
+	{
+		return false;
+	}
+	return Visibility.IsVisible(MazeGrid.ToIndex(FromCell), MazeGrid.ToIndex(ToCell));
+}
 
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY - 1)); // cell left
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				break;
-				
-			case ECellPosition::ECP_TopLeftCorner :
+void AMazeBase::UpdatePieceCulling(FVector ViewLocation)
+{
+	const int32 ViewCell = GetCellIndexAtLocation(ViewLocation);
+	if (ViewCell == INDEX_NONE || IsMaterializing() || !Visibility.IsBuilt() || Visibility.Num() != MazeGrid.Num())
+	{
+		ClearPieceCulling();
+		return;
+	}
+	if (ViewCell == PieceCullingCell)
+	{
+		return;
+	}
+	PieceCullingCell = ViewCell;
+	bPieceCullingActive = true;
 
-				CheckCell = MazeData.Find(FIntPoint(CurX - 1, CurY)); // cell down
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
+	TArray<int32> VisibleCells;
+	Visibility.GetVisibleCells(ViewCell, VisibleCells);
+	VisibleCellMask.Init(false, MazeGrid.Num());
+	for (int32 CellIndex : VisibleCells)
+	{
+		VisibleCellMask[CellIndex] = true;
+	}
 
-				CheckCell = MazeData.Find(FIntPoint(CurX, CurY + 1)); // cell right
-				if (CheckCell)
-				{
-					if (!CheckCell->bAlgorithmHasVisited)
-					{
-						UnVisitedNearbyCells.Add(*CheckCell);
-					}
-				}
-				break;
-				
-			default:
-				break;
+	// the hidden state is read back from the pieces, so pieces spawned or swapped since the last update are handled too
+	VisiblePieceCount = 0;
+	CulledPieceCount = 0;
+	for (int32 Type = 0; Type < PieceTables.Num(); Type++)
+	{
+		const FMazePieceTable& Table = PieceTables[Type];
+		for (int32 PieceIndex = 0; PieceIndex < Table.Components.Num(); PieceIndex++)
+		{
+			AActor* ChildActor = Table.Components[PieceIndex] ? Table.Components[PieceIndex]->GetChildActor() : nullptr;
+			if (!ChildActor)
+			{
+				continue;
 			}
 
-			int32 ArrayLength = UnVisitedNearbyCells.Num();
-			//UE_LOG(LogTemp, Warning, TEXT("%d"), ArrayLength);
-			if (ArrayLength > 0)
+			const bool bHidden = !IsPieceInVisibleCell(static_cast<EMazePieceType>(Type), PieceIndex);
+			if (ChildActor->IsHidden() != bHidden)
 			{
-				bEndCounter = false;
-				RandDir = MazeRandomStream.RandRange(0 , ArrayLength - 1);
-				FMazeCellData CellToUse = UnVisitedNearbyCells[RandDir];
-				FMazeCellData* NextCell = MazeData.Find(FIntPoint(CellToUse.MazeCellCoordinates.X, CellToUse.MazeCellCoordinates.Y));
-				if (NextCell)
-				{
-					FBox Box;
-					if (NextCell->MazeCellCoordinates.X < CurrentCell->MazeCellCoordinates.X || NextCell->MazeCellCoordinates.Y < CurrentCell->MazeCellCoordinates.Y)
-					{
-						Box = FBox(NextCell->MazeCellTransform.GetLocation()  + FVector(0.f, 0.f, 2*FloorSize.Z) + GetActorLocation(),
-						           CurrentCell->MazeCellTransform.GetLocation() + FVector(0.f, 0.f, 2*FloorSize.Z) + GetActorLocation());
-					}
-					else
-					{
-						Box = FBox(CurrentCell->MazeCellTransform.GetLocation() + FVector(0.f, 0.f, 2*FloorSize.Z) + GetActorLocation(),
-						           NextCell->MazeCellTransform.GetLocation() + FVector(0.f, 0.f, 2*FloorSize.Z) + GetActorLocation());
-					}
-
-					TArray<TObjectPtr<USceneComponent>> ComponentsToDelete;
-					
-					for (auto Component : InnerWallContainer)
-					{
-						if (!Component || !Component->GetChildActor())
-						{
-							continue;
-						}
-					
-						if (Box.Intersect(Component->GetChildActor()->GetComponentsBoundingBox()))
-						{
-							ComponentsToDelete.Add(Component);
-						}
-					}
-
-					if (!ComponentsToDelete.IsEmpty())
-					{
-						for (int32 k = ComponentsToDelete.Num(); k > 0; k--)
-						{
-							if (!ComponentsToDelete[k - 1])
-							{
-								continue;
-							}
-							//ComponentsToDelete[k - 1]->UnregisterComponent();
-							ComponentsToDelete[k - 1]->DestroyComponent();
-						}
-					}
-					
-					CurrentCell = NextCell;
-					CurX = CurrentCell->MazeCellCoordinates.X;
-					CurY = CurrentCell->MazeCellCoordinates.Y;
-					bCheckPrevious = false;
-				}
+				ChildActor->SetActorHiddenInGame(bHidden);
+			}
+			if (bHidden)
+			{
+				CulledPieceCount++;
 			}
 			else
 			{
-				if (!bEndCounter)
-				{
-					DeadEnds.Add(CellQueue[CellQueue.Num() - 1].MazeCellTransform.GetLocation());
-					bEndCounter = true;
-				}
-
-				CellQueue.RemoveAt(CellQueue.Num() - 1); // remove last cell from the queue
-				if (CellQueue.Num() > 0)
-				{
-					FMazeCellData CellToUse = CellQueue[CellQueue.Num() - 1];
-					FMazeCellData* NextCell = MazeData.Find(FIntPoint(CellToUse.MazeCellCoordinates.X, CellToUse.MazeCellCoordinates.Y));
-					if (NextCell)
-					{
-						bCheckPrevious = true;
-						CurrentCell = NextCell;
-						CurX = CurrentCell->MazeCellCoordinates.X;
-						CurY = CurrentCell->MazeCellCoordinates.Y;
-					}
-				}
-				else
-				{
-					bDoneIterating = true;
-				}
-				
+				VisiblePieceCount++;
 			}
-			UnVisitedNearbyCells.Empty();
-		}
-		else
-		{
-			bDoneIterating = true;
 		}
-		
+		VisiblePieceCount += Table.InstancePieces.Num();
 	}
-}
-
-void AMazeBase::CarveEntryAndExit()
-{
 
-	TArray<TObjectPtr<USceneComponent>> ComponentsToDelete;
-	
-	if (bHasEntry)
+	if (MergedChunkMeshes.Num() > 0)
 	{
-		if (bEntrySide1)
-		{
-			bEntrySide2 = false;
-			bEntrySide3 = false;
-			bEntrySide4 = false;
-		}
-		else if (bEntrySide2)
-		{
-			bEntrySide1 = false;
-			bEntrySide3 = false;
-			bEntrySide4 = false;
-		}
-		else if (bEntrySide3)
+		const FMazeMergedGeometryBuilder Builder = MakeMergedGeometryBuilder();
+		TBitArray<> VisibleChunks(false, Builder.NumChunks());
+		for (int32 CellIndex : VisibleCells)
 		{
-			bEntrySide1 = false;
-			bEntrySide2 = false;
-			bEntrySide4 = false;
-		}
-		else if (bEntrySide4)
-		{
-			bEntrySide1 = false;
-			bEntrySide2 = false;
-			bEntrySide3 = false;
+			VisibleChunks[Builder.GetChunkOfCell(CellIndex)] = true;
 		}
-		
-		if (!bCustomEntry)
+		for (int32 ChunkIndex = 0; ChunkIndex < MergedChunkMeshes.Num(); ChunkIndex++)
 		{
-			if (bRandomEntry)
+			UProceduralMeshComponent* Mesh = MergedChunkMeshes[ChunkIndex];
+			if (!Mesh)
 			{
-				if (bEntrySide1 || bEntrySide3)
-				{
-					EntryWallNumber = MazeRandomStream.RandRange(0, MazeWidth - 1);
-				}
-				else if (bEntrySide2 || bEntrySide4)
-				{
-					EntryWallNumber = MazeRandomStream.RandRange(0, MazeHeight - 1);
-				}
-				else
-				{
-					EntryWallNumber = 0;
-				}
+				continue;
 			}
-		}
-
-		if ((bEntrySide1 || bEntrySide3) && EntryWallNumber > MazeWidth - 1)
-		{
-			UE_LOG(LogTemp, Error, TEXT("EntryWallNumber is greater than MazeWidth"));
-			return;
-		}
 
-		if ((bEntrySide2 || bEntrySide4) && EntryWallNumber > MazeHeight - 1)
-		{
-			UE_LOG(LogTemp, Error, TEXT("EntryWallNumber is greater than MazeHeight"));
-			return;
-		}
-		
-		FBox EntryBox;
-		FVector BoxAddition = FVector(0.f, 0.f, 2*FloorSize.Z);
-		if (bEntrySide1)
-		{
-			FMazeCellData* Cell = MazeData.Find(FIntPoint(EntryWallNumber, 0));
-			if (Cell)
-			{
-				FVector CellLocation = Cell->MazeCellTransform.GetLocation() + GetActorLocation();
-				EntryBox = FBox(CellLocation + FVector( 0.f, -(FloorSize.Y / 2 + OuterWallSize.Y), 0.f) + BoxAddition,
-				CellLocation + BoxAddition);
-			}
-		}
-		else if (bEntrySide2)
-		{
-			FMazeCellData* Cell = MazeData.Find(FIntPoint(0, EntryWallNumber));
-			if (Cell)
+			const bool bVisible = VisibleChunks.IsValidIndex(ChunkIndex) && VisibleChunks[ChunkIndex];
+			if (Mesh->IsVisible() != bVisible)
 			{
-				FVector CellLocation = Cell->MazeCellTransform.GetLocation() + GetActorLocation();
-				EntryBox = FBox(CellLocation + FVector( -(FloorSize.X / 2 + OuterWallSize.Y), 0.f, 0.f) + BoxAddition,
-				CellLocation + BoxAddition);
+				Mesh->SetVisibility(bVisible);
 			}
-		}
-		else if (bEntrySide3)
-		{
-			FMazeCellData* Cell = MazeData.Find(FIntPoint(EntryWallNumber, MazeHeight - 1));
-			if (Cell)
+			if (bVisible)
 			{
-				FVector CellLocation = Cell->MazeCellTransform.GetLocation() + GetActorLocation();
-				EntryBox = FBox(CellLocation + BoxAddition,
-				CellLocation + FVector( 0.f, (FloorSize.Y / 2 + OuterWallSize.Y), 0.f) + BoxAddition);
+				VisiblePieceCount++;
 			}
-		}
-		else if (bEntrySide4)
-		{
-			FMazeCellData* Cell = MazeData.Find(FIntPoint(MazeWidth - 1, EntryWallNumber));
-			if (Cell)
+			else
 			{
-				FVector CellLocation = Cell->MazeCellTransform.GetLocation() + GetActorLocation();
-				EntryBox = FBox(CellLocation + BoxAddition,
-				CellLocation + FVector( (FloorSize.X / 2 + OuterWallSize.Y), 0.f, 0.f) + BoxAddition);
+				CulledPieceCount++;
 			}
 		}
+	}
+}
 
-		FTransform EntryTransform;
-		
-		for (auto Component : OuterWallContainer)
+void AMazeBase::ClearPieceCulling()
+{
+	if (!bPieceCullingActive)
+	{
+		return;
+	}
+	bPieceCullingActive = false;
+	PieceCullingCell = INDEX_NONE;
+	VisiblePieceCount = 0;
+	CulledPieceCount = 0;
+
+	for (const FMazePieceTable& Table : PieceTables)
+	{
+		for (UChildActorComponent* Component : Table.Components)
 		{
-			if (!Component || !Component->GetChildActor())
-			{
-				continue;
-			}
-					
-			if (EntryBox.Intersect(Component->GetChildActor()->GetComponentsBoundingBox()))
+			AActor* ChildActor = Component ? Component->GetChildActor() : nullptr;
+			if (ChildActor && ChildActor->IsHidden())
 			{
-				ComponentsToDelete.Add(Component);
-				EntryTransform = Component->GetComponentTransform();
+				ChildActor->SetActorHiddenInGame(false);
 			}
 		}
-		
-		EntryWallTransform = EntryTransform;
-		
 	}
-	
-	if (bHasExit)
+	for (UProceduralMeshComponent* Mesh : MergedChunkMeshes)
 	{
-
-		if (bExitSide1)
-		{
-			bExitSide2 = false;
-			bExitSide3 = false;
-			bExitSide4 = false;
-		}
-		else if (bExitSide2)
+		if (Mesh && !Mesh->IsVisible())
 		{
-			bExitSide1 = false;
-			bExitSide3 = false;
-			bExitSide4 = false;
-		}
-		else if (bExitSide3)
-		{
-			bExitSide1 = false;
-			bExitSide2 = false;
-			bExitSide4 = false;
+			Mesh->SetVisibility(true);
 		}
-		else if (bEntrySide4)
+	}
+}
+
+bool AMazeBase::IsPieceInVisibleCell(EMazePieceType Type, int32 PieceIndex) const
+{
+	switch (Type)
+	{
+	case EMazePieceType::EMPT_Floor :
+		return VisibleCellMask[PieceIndex];
+	case EMazePieceType::EMPT_InnerWall :
 		{
-			bExitSide1 = false;
-			bExitSide2 = false;
-			bExitSide3 = false;
+			const int32 CellIndex = PieceIndex / 2;
+			const int32 Neighbor = MazeGrid.GetNeighbor(CellIndex, PieceIndex % 2 == 0 ? EMazeDirection::EMD_PosX : EMazeDirection::EMD_PosY);
+			return VisibleCellMask[CellIndex] || (Neighbor != INDEX_NONE && VisibleCellMask[Neighbor]);
 		}
-		
-		if (!bCustomExit)
+	case EMazePieceType::EMPT_OuterWall :
+		return VisibleCellMask[MazeGrid.GetOuterEdgeCell(PieceIndex)];
+	case EMazePieceType::EMPT_InnerCorner :
+	case EMazePieceType::EMPT_OuterCorner :
 		{
-			if (bRandomExit)
+			// corner (X, Y) touches the cells from (X - 1, Y - 1) to (X, Y)
+			const FIntPoint Corner = MazeGrid.CornerToCoordinates(PieceIndex);
+			for (int32 Y = Corner.Y - 1; Y <= Corner.Y; Y++)
 			{
-				if (bExitSide1 || bExitSide3)
-				{
-					ExitWallNumber = MazeRandomStream.RandRange(0, MazeWidth - 1);
-				}
-				else if (bExitSide2 || bExitSide4)
-				{
-					ExitWallNumber = MazeRandomStream.RandRange(0, MazeHeight - 1);
-				}
-				else
+				for (int32 X = Corner.X - 1; X <= Corner.X; X++)
 				{
-					ExitWallNumber = 0;
+					if (MazeGrid.IsValidCoordinates(X, Y) && VisibleCellMask[MazeGrid.ToIndex(X, Y)])
+					{
+						return true;
+					}
 				}
 			}
+			return false;
 		}
+	default:
+		return true;
+	}
+}
 
-		if ((bExitSide1 || bExitSide3) && ExitWallNumber > MazeWidth - 1)
-		{
-			UE_LOG(LogTemp, Error, TEXT("ExitWallNumber is greater than MazeWidth"));
-			return;
-		}
+void AMazeBase::SpawnPiece(EMazePieceType Type, int32 PieceIndex, const FTransform& Transform)
+{
+	FMazePieceTable& Table = GetPieceTable(Type);
+	if (UsesMergedGeometry(Type))
+	{
+		// drawn by the chunk meshes built in FinishMaterialization
+		return;
+	}
+	
+	if (UsesInstancedMesh(Type))
+	{
+		// instances are added in one batch by FlushPendingInstances
+		Table.PendingPieces.Add(PieceIndex);
+		Table.PendingTransforms.Add(Transform);
+	}
+	else
+	{
+		Table.Components[PieceIndex] = AcquirePiece(Type, Transform);
+	}
+}
+
+UChildActorComponent* AMazeBase::AcquirePiece(EMazePieceType Type, const FTransform& Transform)
+{
+	FMazePieceTable& Table = GetPieceTable(Type);
+	UClass* Class = GetPieceClass(Type);
 
-		if ((bExitSide2 || bExitSide4) && ExitWallNumber > MazeHeight - 1)
+	// pooled pieces can be destroyed from outside, for example by an undo in the editor
+	while (!Table.Pool.IsEmpty() && !IsValid(Table.Pool.Last()))
+	{
+		Table.Pool.Pop();
+	}
+	
+	if (Table.Pool.IsEmpty())
+	{
+		Table.PoolMisses++;
+		if (bPoolPieces)
 		{
-			UE_LOG(LogTemp, Error, TEXT("ExitWallNumber is greater than MazeHeight"));
-			return;
+			// grow the pool by more than one piece at a time, the extra pieces wait hidden until they are needed
+			for (int32 i = 1; i < PiecePoolGrowSize && Table.Pool.Num() < PiecePoolMaxSize; i++)
+			{
+				if (UChildActorComponent* Extra = CreateChildActorInstance(Transform, Class, GetPieceSceneComponent(Type), NAME_None, nullptr))
+				{
+					SetPooledPieceHidden(Extra, true);
+					Table.Pool.Add(Extra);
+				}
+			}
 		}
 		
-		FBox ExitBox;
-		FVector BoxAddition = FVector(0.f, 0.f, 2*FloorSize.Z);
-		if (bExitSide1)
+		// create new child actor component and apply chosen class. Only works in instanced asset
+		UChildActorComponent* Created = CreateChildActorInstance(Transform, Class, GetPieceSceneComponent(Type), NAME_None, GetPieceContainer(Type));
+		if (Created)
 		{
-			FMazeCellData* Cell = MazeData.Find(FIntPoint(ExitWallNumber, 0));
-			if (Cell)
-			{
-				FVector CellLocation = Cell->MazeCellTransform.GetLocation() + GetActorLocation();
-				ExitBox = FBox(CellLocation + FVector( 0.f, -(FloorSize.Y / 2 + OuterWallSize.Y), 0.f) + BoxAddition,
-				CellLocation + BoxAddition);
-			}
+			ApplyPieceCollision(Created);
+			ApplyPieceDrawDistance(Created);
 		}
-		else if (bExitSide2)
+		return Created;
+	}
+
+	Table.PoolHits++;
+	UChildActorComponent* Component = Table.Pool.Pop();
+	if (Component->GetChildActorClass() != Class)
+	{
+		Component->SetChildActorClass(Class);
+	}
+	Component->SetRelativeTransform(Transform);
+	SetPooledPieceHidden(Component, false);
+	ApplyPieceCollision(Component);
+	ApplyPieceDrawDistance(Component);
+	GetPieceContainer(Type)->Add(Component);
+	return Component;
+}
+
+void AMazeBase::ReleasePiece(EMazePieceType Type, UChildActorComponent* Component)
+{
+	if (!IsValid(Component))
+	{
+		return;
+	}
+
+	FMazePieceTable& Table = GetPieceTable(Type);
+	if (!bPoolPieces || Table.Pool.Num() >= PiecePoolMaxSize)
+	{
+		Component->DestroyComponent();
+		GenerationStats.ComponentsDestroyed++;
+		return;
+	}
+
+	SetPooledPieceHidden(Component, true);
+	Table.Pool.Add(Component);
+}
+
+void AMazeBase::SetPooledPieceHidden(UChildActorComponent* Component, bool bHidden)
+{
+	if (AActor* ChildActor = Component->GetChildActor())
+	{
+		ChildActor->SetActorHiddenInGame(bHidden);
+		ChildActor->SetActorEnableCollision(!bHidden);
+#if WITH_EDITOR
+		ChildActor->SetIsTemporarilyHiddenInEditor(bHidden);
+#endif
+	}
+}
+
+void AMazeBase::TrimPiecePools(int32 MaxPiecesPerType)
+{
+	for (FMazePieceTable& Table : PieceTables)
+	{
+		while (Table.Pool.Num() > FMath::Max(MaxPiecesPerType, 0))
 		{
-			FMazeCellData* Cell = MazeData.Find(FIntPoint(0, ExitWallNumber));
-			if (Cell)
+			if (UChildActorComponent* Component = Table.Pool.Pop())
 			{
-				FVector CellLocation = Cell->MazeCellTransform.GetLocation() + GetActorLocation();
-				ExitBox = FBox(CellLocation + FVector( -(FloorSize.X / 2 + OuterWallSize.Y), 0.f, 0.f) + BoxAddition,
-				CellLocation + BoxAddition);
+				Component->DestroyComponent();
+				GenerationStats.ComponentsDestroyed++;
 			}
 		}
-		else if (bExitSide3)
+	}
+}
+
+int32 AMazeBase::GetPooledPieceCount() const
+{
+	int32 Count = 0;
+	for (const FMazePieceTable& Table : PieceTables)
+	{
+		Count += Table.Pool.Num();
+	}
+	return Count;
+}
+
+int32 AMazeBase::GetPiecePoolHitCount() const
+{
+	int32 Count = 0;
+	for (const FMazePieceTable& Table : PieceTables)
+	{
+		Count += Table.PoolHits;
+	}
+	return Count;
+}
+
+int32 AMazeBase::GetPiecePoolMissCount() const
+{
+	int32 Count = 0;
+	for (const FMazePieceTable& Table : PieceTables)
+	{
+		Count += Table.PoolMisses;
+	}
+	return Count;
+}
+
+void AMazeBase::RebuildPieceContainers()
+{
+	for (int32 Type = 0; Type < static_cast<int32>(EMazePieceType::EMPT_MAX); Type++)
+	{
+		const FMazePieceTable& Table = GetPieceTable(static_cast<EMazePieceType>(Type));
+		TArray<TObjectPtr<UChildActorComponent>>* Container = GetPieceContainer(static_cast<EMazePieceType>(Type));
+		Container->Reset();
+		for (const TObjectPtr<UChildActorComponent>& Component : Table.Components)
 		{
-			FMazeCellData* Cell = MazeData.Find(FIntPoint(ExitWallNumber, MazeHeight - 1));
-			if (Cell)
+			if (Component)
 			{
-				FVector CellLocation = Cell->MazeCellTransform.GetLocation() + GetActorLocation();
-				ExitBox = FBox(CellLocation + BoxAddition,
-				CellLocation + FVector( 0.f, (FloorSize.Y / 2 + OuterWallSize.Y), 0.f) + BoxAddition);
+				Container->Add(Component);
 			}
 		}
-		else if (bExitSide4)
+	}
+}
+
+void AMazeBase::FlushPendingInstances(EMazePieceType Type)
+{
+	FMazePieceTable& Table = GetPieceTable(Type);
+	if (Table.PendingPieces.IsEmpty())
+	{
+		return;
+	}
+	
+	UHierarchicalInstancedStaticMeshComponent* InstancedMesh = GetOrCreateInstancedMesh(Type);
+	if (InstancedMesh)
+	{
+		const int32 FirstInstance = InstancedMesh->GetInstanceCount();
+		InstancedMesh->AddInstances(Table.PendingTransforms, false);
+		for (int32 i = 0; i < Table.PendingPieces.Num(); i++)
 		{
-			FMazeCellData* Cell = MazeData.Find(FIntPoint(MazeWidth - 1, ExitWallNumber));
-			if (Cell)
-			{
-				FVector CellLocation = Cell->MazeCellTransform.GetLocation() + GetActorLocation();
-				ExitBox = FBox(CellLocation + BoxAddition,
-				CellLocation + FVector( (FloorSize.X / 2 + OuterWallSize.Y), 0.f, 0.f) + BoxAddition);
-			}
+			Table.Instances[Table.PendingPieces[i]] = FirstInstance + i;
+			Table.InstancePieces.Add(Table.PendingPieces[i]);
 		}
+	}
+	
+	Table.PendingPieces.Reset();
+	Table.PendingTransforms.Reset();
+}
 
-		FTransform ExitTransform;
-		
-		for (auto Component : OuterWallContainer)
+void AMazeBase::FlushAllPendingInstances()
+{
+	for (int32 Type = 0; Type < static_cast<int32>(EMazePieceType::EMPT_MAX); Type++)
+	{
+		FlushPendingInstances(static_cast<EMazePieceType>(Type));
+	}
+}
+
+void AMazeBase::RemovePiece(EMazePieceType Type, int32 PieceIndex)
+{
+	FMazePieceTable& Table = GetPieceTable(Type);
+	if (!Table.Components.IsValidIndex(PieceIndex))
+	{
+		return;
+	}
+
+	if (Table.Components[PieceIndex])
+	{
+		ReleasePiece(Type, Table.Components[PieceIndex]);
+		Table.Components[PieceIndex] = nullptr;
+	}
+
+	const int32 InstanceIndex = Table.Instances[PieceIndex];
+	if (InstanceIndex != INDEX_NONE && Table.InstancedMesh)
+	{
+		// the hierarchical instanced mesh removes at swap, so the last instance takes over the removed index
+		Table.InstancedMesh->RemoveInstance(InstanceIndex);
+		const int32 MovedPiece = Table.InstancePieces.Last();
+		Table.InstancePieces.RemoveAtSwap(InstanceIndex);
+		if (MovedPiece != PieceIndex)
 		{
-			if (!Component || !Component->GetChildActor())
-			{
-				continue;
-			}
-					
-			if (ExitBox.Intersect(Component->GetChildActor()->GetComponentsBoundingBox()))
+			Table.Instances[MovedPiece] = InstanceIndex;
+		}
+		Table.Instances[PieceIndex] = INDEX_NONE;
+	}
+}
+
+int32 AMazeBase::GetSpawnedChildActorCount() const
+{
+	int32 Count = 0;
+	for (const FMazePieceTable& Table : PieceTables)
+	{
+		for (const TObjectPtr<UChildActorComponent>& Component : Table.Components)
+		{
+			if (Component && Component->GetChildActor())
 			{
-				ComponentsToDelete.Add(Component);
-				ExitTransform = Component->GetComponentTransform();
+				Count++;
 			}
 		}
-		
-		ExitWallTransform = ExitTransform;
 	}
+	return Count;
+}
+
+int32 AMazeBase::GetSpawnedInstanceCount() const
+{
+	int32 Count = 0;
+	for (const FMazePieceTable& Table : PieceTables)
+	{
+		if (Table.InstancedMesh)
+		{
+			Count += Table.InstancedMesh->GetInstanceCount();
+		}
+	}
+	return Count;
+}
+
+int32 AMazeBase::GetPathCacheHitCount() const
+{
+	return Pathfinder.GetNumCacheHits();
+}
 
-	if (!ComponentsToDelete.IsEmpty())
+int32 AMazeBase::GetPathCacheMissCount() const
+{
+	return Pathfinder.GetNumCacheMisses();
+}
+
+int32 AMazeBase::GetMergedSectionCount() const
+{
+	int32 Count = 0;
+	for (UProceduralMeshComponent* Mesh : MergedChunkMeshes)
 	{
-		for (int32 k = ComponentsToDelete.Num(); k > 0; k--)
+		if (!Mesh)
 		{
-			if (!ComponentsToDelete[k - 1])
+			continue;
+		}
+		for (int32 Section = 0; Section < Mesh->GetNumSections(); Section++)
+		{
+			if (Mesh->GetProcMeshSection(Section)->ProcVertexBuffer.Num() > 0)
 			{
-				continue;
+				Count++;
 			}
-			//ComponentsToDelete[k - 1]->UnregisterComponent();
-			ComponentsToDelete[k - 1]->DestroyComponent();
 		}
 	}
+	return Count;
 }
 
+int32 AMazeBase::GetMergedCollisionPrimitiveCount() const
+{
+	int32 Count = 0;
+	for (int32 Primitives : CollisionChunkPrimitives)
+	{
+		Count += Primitives;
+	}
+	return Count;
+}
 
-// Called every frame
-void AMazeBase::Tick(float DeltaTime)
+void AMazeBase::GenerateAndSetRandomSeed()
 {
-	Super::Tick(DeltaTime);
+	SetMazeSeed(FMath::Rand());
+}
+
+FMazeGenerationSettings AMazeBase::MakeGenerationSettings() const
+{
+	FMazeGenerationSettings Settings;
+	Settings.MazeWidth = MazeWidth;
+	Settings.MazeHeight = MazeHeight;
+	Settings.Seed = Seed;
+	Settings.MazeAlgorithmStartingCell = MazeAlgorithmStartingCell;
+	Settings.Algorithm = Algorithm;
+	Settings.ParallelTileSize = ParallelTileSize;
+	Settings.bCreateRooms = bCreateRooms;
+	Settings.NumberOfRooms = NumberOfRooms;
+	Settings.RoomWidth = RoomWidth;
+	Settings.RoomHeight = RoomHeight;
+	Settings.NumberOfRoomDoors = NumberOfRoomDoors;
+	Settings.bHasEntry = bHasEntry;
+	Settings.bCustomEntry = bCustomEntry;
+	Settings.bRandomEntry = bRandomEntry;
+	Settings.EntryWallNumber = EntryWallNumber;
+	Settings.EntrySide = bEntrySide1 ? 1 : bEntrySide2 ? 2 : bEntrySide3 ? 3 : bEntrySide4 ? 4 : 0;
+	Settings.bHasExit = bHasExit;
+	Settings.bCustomExit = bCustomExit;
+	Settings.bRandomExit = bRandomExit;
+	Settings.ExitWallNumber = ExitWallNumber;
+	Settings.ExitSide = bExitSide1 ? 1 : bExitSide2 ? 2 : bExitSide3 ? 3 : bExitSide4 ? 4 : 0;
+	Settings.AdditionalOuterWallOpenings = AdditionalOuterWallOpenings;
+	return Settings;
+}
+
+void AMazeBase::NormalizeEntryAndExitSides()
+{
+	if (bHasEntry)
+	{
+		if (bEntrySide1)
+		{
+			bEntrySide2 = false;
+			bEntrySide3 = false;
+			bEntrySide4 = false;
+		}
+		else if (bEntrySide2)
+		{
+			bEntrySide1 = false;
+			bEntrySide3 = false;
+			bEntrySide4 = false;
+		}
+		else if (bEntrySide3)
+		{
+			bEntrySide1 = false;
+			bEntrySide2 = false;
+			bEntrySide4 = false;
+		}
+		else if (bEntrySide4)
+		{
+			bEntrySide1 = false;
+			bEntrySide2 = false;
+			bEntrySide3 = false;
+		}
+	}
+
+	if (bHasExit)
+	{
+		if (bExitSide1)
+		{
+			bExitSide2 = false;
+			bExitSide3 = false;
+			bExitSide4 = false;
+		}
+		else if (bExitSide2)
+		{
+			bExitSide1 = false;
+			bExitSide3 = false;
+			bExitSide4 = false;
+		}
+		else if (bExitSide3)
+		{
+			bExitSide1 = false;
+			bExitSide2 = false;
+			bExitSide4 = false;
+		}
+		else if (bEntrySide4)
+		{
+			bExitSide1 = false;
+			bExitSide2 = false;
+			bExitSide3 = false;
+		}
+	}
+}
+
+void AMazeBase::RegenerateMaze()
+{
+	MAZE_SCOPE_CYCLE_COUNTER(STAT_MazeRegenerate);
+	CancelAsyncGeneration();
+	
+	if (!bUseCustomSeed && bGenerateRandomSeed)
+	{
+		GenerateAndSetRandomSeed();
+	}
+	NormalizeEntryAndExitSides();
 
+	const double StartTime = FPlatformTime::Seconds();
+	FMazeLayout Layout;
+	FMazeGenerationStats LayoutStats;
+	SolveLayout(MakeGenerationSettings(), ShouldUseLayoutCache(), bPersistLayoutCache, Layout, LayoutStats);
+	MaterializeLayout(MoveTemp(Layout), StartTime, LayoutStats);
 }
 
+void AMazeBase::RegenerateMazeAsync()
+{
+	// a newer request always wins, the old worker stops at its next cancellation check
+	CancelAsyncGeneration();
+	
+	if (!bUseCustomSeed && bGenerateRandomSeed)
+	{
+		GenerateAndSetRandomSeed();
+	}
+	NormalizeEntryAndExitSides();
+
+	const TSharedRef<FMazeAsyncGeneration, ESPMode::ThreadSafe> Generation = MakeShared<FMazeAsyncGeneration, ESPMode::ThreadSafe>();
+	PendingGeneration = Generation;
+	
+	const FMazeGenerationSettings Settings = MakeGenerationSettings();
+	const double StartTime = FPlatformTime::Seconds();
+	TWeakObjectPtr<AMazeBase> WeakThis(this);
+	const bool bUseCache = ShouldUseLayoutCache();
+	const bool bPersistCache = bPersistLayoutCache;
+	
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakThis, Generation, Settings, StartTime, bUseCache, bPersistCache]()
+	{
+		FMazeLayout Layout;
+		FMazeGenerationStats LayoutStats;
+		if (!SolveLayout(Settings, bUseCache, bPersistCache, Layout, LayoutStats, &Generation->bCancelled))
+		{
+			return;
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Generation, Layout = MoveTemp(Layout), LayoutStats, StartTime]() mutable
+		{
+			AMazeBase* Maze = WeakThis.Get();
+			if (!Maze || Generation->bCancelled || Maze->PendingGeneration.Get() != &Generation.Get())
+			{
+				return;
+			}
+			
+			Maze->PendingGeneration.Reset();
+			Maze->MaterializeLayout(MoveTemp(Layout), StartTime, LayoutStats);
+		});
+	});
+}
+
+bool AMazeBase::SolveLayout(const FMazeGenerationSettings& Settings, bool bUseCache, bool bPersistCache,
+	FMazeLayout& OutLayout, FMazeGenerationStats& OutStats, const std::atomic<bool>* CancelFlag)
+{
+	MAZE_SCOPE_CYCLE_COUNTER(STAT_MazeSolveLayout);
+	OutStats = FMazeGenerationStats();
+	if (bUseCache && FMazeLayoutCache::Get().Find(Settings, OutLayout, bPersistCache))
+	{
+		OutStats.bFromLayoutCache = true;
+		return true;
+	}
+
+	FMazeLayoutGenerator Generator(Settings);
+	if (!Generator.Generate(OutLayout, CancelFlag))
+	{
+		return false;
+	}
+	OutStats = Generator.GetStats();
+
+	if (bUseCache)
+	{
+		FMazeLayoutCache::Get().Add(Settings, OutLayout, bPersistCache);
+	}
+	return true;
+}
+
+void AMazeBase::CancelAsyncGeneration()
+{
+	if (PendingGeneration)
+	{
+		PendingGeneration->bCancelled = true;
+		PendingGeneration.Reset();
+	}
+}
+
+void AMazeBase::MaterializeLayout(FMazeLayout&& Layout, double StartTime, const FMazeGenerationStats& LayoutStats)
+{
+	// set before clearing, so the pieces of the last maze count as destroyed by this generation
+	GenerationStats = LayoutStats;
+	ClearMaze();
+	bConstructionFailed = !UpdatePieceSizes();
+	if (bConstructionFailed)
+	{
+		// whoever waits on the async or loaded maze still has to hear that it is over
+		OnMazeMaterializationProgress.Broadcast(1.f);
+		OnMazeConstructionCompleted.Broadcast();
+		return;
+	}
+
+	if (bSpawnOnlyRemainingPieces)
+	{
+		// the layout is already solved, so only spawn what is left of it
+		ApplyLayout(MoveTemp(Layout));
+	}
+	else
+	{
+		// spawn every piece of an uncarved grid first, the carved ones are destroyed in the last stage
+		MazeGrid.Init(Layout.Grid.Width, Layout.Grid.Height);
+		CarvedLayout = MoveTemp(Layout);
+	}
+	InitializePieceTables();
+
+	MaterializationStage = EMazeMaterializationStage::EMMS_Floors;
+	MaterializationIndex = 0;
+	MaterializationStartTime = StartTime;
+
+	const UWorld* World = GetWorld();
+	if (MaterializationFrameBudgetMs > 0.f && World && World->IsGameWorld())
+	{
+		// Tick picks the work up from here
+		SetActorTickEnabled(true);
+		return;
+	}
+
+	ContinueMaterialization(TNumericLimits<double>::Max());
+	FinishMaterialization();
+}
+
+bool AMazeBase::ContinueMaterialization(double EndTime)
+{
+	// spawns pieces of the current stage until the stage is done or the time is up, returns true when the stage is done
+	auto RunSteps = [this, EndTime](int32 NumSteps, TFunctionRef<void(int32)> Step)
+	{
+		while (MaterializationIndex < NumSteps)
+		{
+			Step(MaterializationIndex++);
+			if (FPlatformTime::Seconds() >= EndTime)
+			{
+				break;
+			}
+		}
+		return MaterializationIndex >= NumSteps;
+	};
+	
+	while (MaterializationStage != EMazeMaterializationStage::EMMS_Done)
+	{
+		const double StageStartTime = FPlatformTime::Seconds();
+		bool bStageDone = true;
+		switch (MaterializationStage)
+		{
+		case EMazeMaterializationStage::EMMS_Floors :
+			{
+				MAZE_SCOPE_CYCLE_COUNTER(STAT_MazeFloors);
+				bStageDone = RunSteps(MazeGrid.Num(), [this](int32 CellIndex) { SpawnFloor(CellIndex); });
+			}
+			break;
+			
+		case EMazeMaterializationStage::EMMS_Corners :
+			{
+				MAZE_SCOPE_CYCLE_COUNTER(STAT_MazeCorners);
+				bStageDone = RunSteps(MazeGrid.NumCorners(), [this](int32 CornerIndex) { SpawnCorner(CornerIndex); });
+			}
+			break;
+			
+		case EMazeMaterializationStage::EMMS_Walls :
+			{
+				MAZE_SCOPE_CYCLE_COUNTER(STAT_MazeWalls);
+				bStageDone = RunSteps(MazeGrid.Num(), [this](int32 CellIndex) { SpawnCellWalls(CellIndex); });
+			}
+			break;
+			
+		case EMazeMaterializationStage::EMMS_Carve :
+			if (!bSpawnOnlyRemainingPieces)
+			{
+				MAZE_SCOPE_CYCLE_COUNTER(STAT_MazeCarve);
+				FlushAllPendingInstances();
+				RemoveCarvedPieces(CarvedLayout);
+				ApplyLayout(MoveTemp(CarvedLayout));
+				CarvedLayout = FMazeLayout();
+			}
+			break;
+			
+		default:
+			break;
+		}
+
+		if (bStageDone)
+		{
+			// the instances of a stage count towards the stage
+			FlushAllPendingInstances();
+		}
+		const double Now = FPlatformTime::Seconds();
+		MazeBase::GetStageMs(GenerationStats, MaterializationStage) += (Now - StageStartTime) * 1000.0;
+		
+		if (bStageDone)
+		{
+			MaterializationStage = static_cast<EMazeMaterializationStage>(static_cast<uint8>(MaterializationStage) + 1);
+			MaterializationIndex = 0;
+		}
+		
+		if (Now >= EndTime)
+		{
+			break;
+		}
+	}
+
+	// instances queued in this slice are added together, so they show up this frame
+	FlushAllPendingInstances();
+	return MaterializationStage == EMazeMaterializationStage::EMMS_Done;
+}
+
+void AMazeBase::FinishMaterialization()
+{
+	MAZE_SCOPE_CYCLE_COUNTER(STAT_MazeFinish);
+	const double FinishStartTime = FPlatformTime::Seconds();
+	MaterializationStage = EMazeMaterializationStage::EMMS_Done;
+	SetActorTickEnabled(false);
+
+	// pieces removed by the carve stage went back to the pool
+	RebuildPieceContainers();
+	RebuildMergedGeometry();
+	if (bMergedCollision)
+	{
+		RebuildMergedCollision();
+	}
+	if (bBuildFlowFields)
+	{
+		BuildFlowFields();
+	}
+	if (bBuildVisibility)
+	{
+		RebuildVisibility();
+	}
+	if (bBuildLODProxies)
+	{
+		RebuildLODProxies();
+	}
+	PieceCullingCell = INDEX_NONE;
+	GenerationStats.BytesUsed = GetPieceDataAllocatedSize();
+	GenerationStats.FinishMs = (FPlatformTime::Seconds() - FinishStartTime) * 1000.0;
+	GenerationStats.TotalMs = (FPlatformTime::Seconds() - MaterializationStartTime) * 1000.0;
+	
+	UE_LOG(LogTemp, Log, TEXT("Maze %d x %d generated in %.2f ms with %d child actors, %d mesh instances and %d merged sections, %d pool hits and %d pool misses"),
+		MazeGrid.Width, MazeGrid.Height, GenerationStats.TotalMs,
+		GetSpawnedChildActorCount(), GetSpawnedInstanceCount(), GetMergedSectionCount(), GetPiecePoolHitCount(), GetPiecePoolMissCount());
+
+	OnMazeMaterializationProgress.Broadcast(1.f);
+	OnMazeConstructionCompleted.Broadcast();
+}
+
+float AMazeBase::GetMaterializationProgress() const
+{
+	if (MaterializationStage == EMazeMaterializationStage::EMMS_Done)
+	{
+		return 1.f;
+	}
+
+	// floors, corners and walls each take one step per cell or corner, carving takes one more step at the end
+	const int32 TotalSteps = MazeGrid.Num() + MazeGrid.NumCorners() + MazeGrid.Num() + 1;
+	int32 DoneSteps = MaterializationIndex;
+	if (MaterializationStage > EMazeMaterializationStage::EMMS_Floors)
+	{
+		DoneSteps += MazeGrid.Num();
+	}
+	if (MaterializationStage > EMazeMaterializationStage::EMMS_Corners)
+	{
+		DoneSteps += MazeGrid.NumCorners();
+	}
+	if (MaterializationStage > EMazeMaterializationStage::EMMS_Walls)
+	{
+		DoneSteps += MazeGrid.Num();
+	}
+	return static_cast<float>(DoneSteps) / TotalSteps;
+}
+
+void AMazeBase::ApplyLayout(FMazeLayout&& Layout)
+{
+	MazeGrid = MoveTemp(Layout.Grid);
+	EntryOuterEdgeIndex = Layout.EntryOuterEdge;
+	ExitOuterEdgeIndex = Layout.ExitOuterEdge;
+	OpenOuterEdgeIndices = MoveTemp(Layout.OpenOuterEdges);
+	EntryExitRandomSeed = Layout.EntryExitRandomSeed;
+
+	if (bHasEntry)
+	{
+		EntryWallNumber = Layout.EntryWallNumber;
+	}
+
+	if (bHasExit)
+	{
+		ExitWallNumber = Layout.ExitWallNumber;
+	}
+
+	RoomMinCells = MoveTemp(Layout.RoomMinCells);
+	RoomMaxCells = MoveTemp(Layout.RoomMaxCells);
+	DoorwayEdgeIndices = MoveTemp(Layout.DoorwayEdges);
+	DeadEndCellIndices = MoveTemp(Layout.DeadEndCells);
+	Pathfinder.Reset();
+	UpdateLayoutTransforms();
+	CellTagRandomStream.Initialize(Seed);
+	BuildCellTagIndex();
+}
+
+void AMazeBase::UpdateLayoutTransforms()
+{
+	if (bHasEntry)
+	{
+		EntryWallTransform = EntryOuterEdgeIndex != INDEX_NONE ? GetOuterWallTransform(EntryOuterEdgeIndex) * GetActorTransform() : FTransform();
+	}
+
+	if (bHasExit)
+	{
+		ExitWallTransform = ExitOuterEdgeIndex != INDEX_NONE ? GetOuterWallTransform(ExitOuterEdgeIndex) * GetActorTransform() : FTransform();
+	}
+
+	FVector BoxHeight = FVector(0.f, 0.f, 2 * FloorSize.Z); // Vector to add to the room bounds to add height
+	RoomCenters.Reset(RoomMinCells.Num());
+	for (int32 i = 0; i < RoomMinCells.Num(); i++)
+	{
+		const FBox RoomBounds(
+			GetCellTransform(MazeGrid.ToIndex(RoomMinCells[i])).GetLocation() + BoxHeight + GetActorLocation(),
+			GetCellTransform(MazeGrid.ToIndex(RoomMaxCells[i])).GetLocation() + BoxHeight + GetActorLocation());
+		RoomCenters.Add(RoomBounds.GetCenter());
+	}
+
+	RemovedRoomDoorwayTransforms.Reset(DoorwayEdgeIndices.Num());
+	for (int32 EdgeIndex : DoorwayEdgeIndices)
+	{
+		RemovedRoomDoorwayTransforms.Add(EdgeIndex != INDEX_NONE ? GetInnerWallTransform(EdgeIndex) * GetActorTransform() : FTransform());
+	}
+
+	DeadEnds.Reset(DeadEndCellIndices.Num());
+	for (int32 CellIndex : DeadEndCellIndices)
+	{
+		DeadEnds.Add(GetCellTransform(CellIndex).GetLocation());
+	}
+}
+
+FMazeLayout AMazeBase::MakeLayoutFromMaze() const
+{
+	FMazeLayout Layout;
+	Layout.Grid = MazeGrid;
+	Layout.RoomMinCells = RoomMinCells;
+	Layout.RoomMaxCells = RoomMaxCells;
+	Layout.DoorwayEdges = DoorwayEdgeIndices;
+	Layout.DeadEndCells = DeadEndCellIndices;
+	Layout.EntryOuterEdge = EntryOuterEdgeIndex;
+	Layout.ExitOuterEdge = ExitOuterEdgeIndex;
+	Layout.OpenOuterEdges = OpenOuterEdgeIndices;
+	Layout.EntryWallNumber = EntryWallNumber;
+	Layout.ExitWallNumber = ExitWallNumber;
+	Layout.EntryExitRandomSeed = EntryExitRandomSeed;
+	return Layout;
+}
+
+bool AMazeBase::SaveLayoutToFile(const FString& Filename) const
+{
+	if (MazeGrid.Num() == 0 || IsMaterializing())
+	{
+		UE_LOG(LogTemp, Error, TEXT("The maze has no finished layout to save"));
+		return false;
+	}
+
+	FMazeLayoutFileHeader Header;
+	Header.Seed = Seed;
+	Header.Algorithm = static_cast<uint8>(Algorithm);
+	Header.FloorSize = FVector3f(FloorSize);
+	Header.InnerWallSize = FVector3f(InnerWallSize);
+	Header.OuterWallSize = FVector3f(OuterWallSize);
+	Header.InnerCornerSize = FVector3f(InnerCornerSize);
+	Header.OuterCornerSize = FVector3f(OuterCornerSize);
+	return FMazeLayoutFile::SaveToFile(Filename, MakeLayoutFromMaze(), Header);
+}
+
+bool AMazeBase::LoadLayoutFromFile(const FString& Filename)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	FMazeLayoutFileHeader Header;
+	FMazeLayout Layout;
+	if (!FMazeLayoutFile::LoadFromFile(Filename, Header, Layout))
+	{
+		return false;
+	}
+
+	CancelAsyncGeneration();
+	MazeWidth = Header.Width;
+	MazeHeight = Header.Height;
+	Seed = Header.Seed;
+	Algorithm = static_cast<EMazeAlgorithm>(Header.Algorithm);
+	bHasEntry = Layout.EntryOuterEdge != INDEX_NONE;
+	bHasExit = Layout.ExitOuterEdge != INDEX_NONE;
+
+	MaterializeLayout(MoveTemp(Layout), StartTime);
+	return !bConstructionFailed;
+}
+
+void AMazeBase::RemoveCarvedPieces(const FMazeLayout& Layout)
+{
+	const FMazeGrid& SolvedGrid = Layout.Grid;
+	for (int32 CellIndex = 0; CellIndex < SolvedGrid.Num(); CellIndex++)
+	{
+		for (EMazeDirection Direction : { EMazeDirection::EMD_PosX, EMazeDirection::EMD_PosY })
+		{
+			// edges on the outside of the grid report a wall in both grids, so they are never removed here
+			if (MazeGrid.HasWall(CellIndex, Direction) && !SolvedGrid.HasWall(CellIndex, Direction))
+			{
+				RemovePiece(EMazePieceType::EMPT_InnerWall, MazeGrid.ToEdgeIndex(CellIndex, Direction));
+			}
+		}
+	}
+
+	// corners inside of a room
+	for (int32 i = 0; i < Layout.RoomMinCells.Num(); i++)
+	{
+		for (int32 X = Layout.RoomMinCells[i].X + 1; X <= Layout.RoomMaxCells[i].X; X++)
+		{
+			for (int32 Y = Layout.RoomMinCells[i].Y + 1; Y <= Layout.RoomMaxCells[i].Y; Y++)
+			{
+				RemovePiece(EMazePieceType::EMPT_InnerCorner, MazeGrid.ToCornerIndex(X, Y));
+			}
+		}
+	}
+
+	if (Layout.EntryOuterEdge != INDEX_NONE)
+	{
+		RemovePiece(EMazePieceType::EMPT_OuterWall, Layout.EntryOuterEdge);
+	}
+	if (Layout.ExitOuterEdge != INDEX_NONE)
+	{
+		RemovePiece(EMazePieceType::EMPT_OuterWall, Layout.ExitOuterEdge);
+	}
+	for (int32 OuterEdgeIndex : Layout.OpenOuterEdges)
+	{
+		RemovePiece(EMazePieceType::EMPT_OuterWall, OuterEdgeIndex);
+	}
+}
+
+FTransform AMazeBase::GetCellTransform(int32 CellIndex) const
+{
+	const FIntPoint Cell = MazeGrid.ToCoordinates(CellIndex);
+	return FTransform(FVector(
+		((Cell.X * FloorSize.X) - (FloorSize.X * (MazeGrid.Width - 1)) / 2),
+		((Cell.Y * FloorSize.Y) - (FloorSize.Y * (MazeGrid.Height - 1)) / 2),
+		0));
+}
+
+FTransform AMazeBase::GetInnerWallTransform(int32 EdgeIndex) const
+{
+	const FIntPoint Cell = MazeGrid.ToCoordinates(EdgeIndex / 2);
+	const int32 i = Cell.X;
+	const int32 j = Cell.Y;
+	FTransform WallTileTransform;
+
+	if (EdgeIndex % 2 == 0)
+	{
+		// inner walls going x direction
+		WallTileTransform.SetRotation(FRotator(0.f, 90.f, 0.f).Quaternion());
+		WallTileTransform.SetLocation(FVector(
+			((i * FloorSize.X) - (FloorSize.X * (MazeGrid.Width - 1)) / 2) + (FloorSize.X) / 2,
+			(InnerWallSize.X + InnerCornerSize.Y) * j  - (FloorSize.X * (MazeGrid.Height - 1)) / 2,
+			(InnerWallSize.Z + FloorSize.Z) / 2));
+	}
+	else
+	{
+		// inner walls going y direction
+		WallTileTransform.SetRotation(FRotator(0.f, 180.f, 0.f).Quaternion());
+		WallTileTransform.SetLocation(FVector(
+			(InnerWallSize.X + InnerCornerSize.X) * i - (FloorSize.X * (MazeGrid.Width - 1)) / 2,
+			((j * FloorSize.Y) - (FloorSize.Y * (MazeGrid.Height - 1)) / 2) + (FloorSize.Y) / 2,
+			(InnerWallSize.Z + FloorSize.Z) / 2));
+	}
+	return WallTileTransform;
+}
+
+FTransform AMazeBase::GetOuterWallTransform(int32 OuterEdgeIndex) const
+{
+	int32 Position;
+	const EMazeDirection Side = MazeGrid.GetOuterEdgeSide(OuterEdgeIndex, Position);
+	FTransform WallTileTransform;
+
+	switch (Side)
+	{
+	case EMazeDirection::EMD_NegX :
+		WallTileTransform.SetRotation(FRotator(0.f, -90.f, 0.f).Quaternion());
+		WallTileTransform.SetLocation(FVector(
+			(-((FloorSize.X) + (FloorSize.X * (MazeGrid.Width - 1))) / 2),
+			(OuterWallSize.X + OuterCornerSize.Y) * Position  - (FloorSize.X * (MazeGrid.Height - 1)) / 2,
+			(OuterWallSize.Z + FloorSize.Z) / 2));
+		break;
+		
+	case EMazeDirection::EMD_PosX :
+		WallTileTransform.SetRotation(FRotator(0.f, 90.f, 0.f).Quaternion());
+		WallTileTransform.SetLocation(FVector(
+			(((FloorSize.X) + (FloorSize.X * (MazeGrid.Width - 1))) / 2),
+			(OuterWallSize.X + OuterCornerSize.Y) * Position  - (FloorSize.X * (MazeGrid.Height - 1)) / 2,
+			(OuterWallSize.Z + FloorSize.Z) / 2));
+		break;
+		
+	case EMazeDirection::EMD_NegY :
+		WallTileTransform.SetRotation(FRotator(0.f, 0.f, 0.f).Quaternion());
+		WallTileTransform.SetLocation(FVector(
+			(OuterWallSize.X + OuterCornerSize.Y) * Position  - (FloorSize.X * (MazeGrid.Width - 1)) / 2,
+			(-((FloorSize.X) + (FloorSize.X * (MazeGrid.Height - 1))) / 2),
+			(OuterWallSize.Z + FloorSize.Z) / 2));
+		break;
+		
+	case EMazeDirection::EMD_PosY :
+		WallTileTransform.SetRotation(FRotator(0.f, 180.f, 0.f).Quaternion());
+		WallTileTransform.SetLocation(FVector(
+			(OuterWallSize.X + OuterCornerSize.Y) * Position  - (FloorSize.X * (MazeGrid.Width - 1)) / 2,
+			(((FloorSize.X) + (FloorSize.X * (MazeGrid.Height - 1))) / 2),
+			(OuterWallSize.Z + FloorSize.Z) / 2));
+		break;
+		
+	default:
+		break;
+	}
+	return WallTileTransform;
+}
+
+FTransform AMazeBase::GetCornerTransform(int32 CornerIndex) const
+{
+	const FIntPoint Corner = MazeGrid.CornerToCoordinates(CornerIndex);
+	const float CornerHeight = MazeGrid.IsOuterCorner(Corner.X, Corner.Y) ? OuterCornerSize.Z : InnerCornerSize.Z;
+	return FTransform(FVector(
+		((Corner.X * FloorSize.X) - (FloorSize.X * (MazeGrid.Width - 1)) / 2) - FloorSize.X / 2,
+		((Corner.Y * FloorSize.Y) - (FloorSize.Y * (MazeGrid.Height - 1)) / 2) - FloorSize.Y / 2,
+		(CornerHeight + FloorSize.Z) / 2));
+}
+
+bool AMazeBase::IsOuterWallOpen(int32 OuterEdgeIndex) const
+{
+	return OuterEdgeIndex == EntryOuterEdgeIndex || OuterEdgeIndex == ExitOuterEdgeIndex || OpenOuterEdgeIndices.Contains(OuterEdgeIndex);
+}
+
+FTransform AMazeBase::GetPieceTransform(EMazePieceType Type, int32 PieceIndex) const
+{
+	switch (Type)
+	{
+	case EMazePieceType::EMPT_Floor :
+		return GetCellTransform(PieceIndex);
+	case EMazePieceType::EMPT_InnerWall :
+		return GetInnerWallTransform(PieceIndex);
+	case EMazePieceType::EMPT_OuterWall :
+		return GetOuterWallTransform(PieceIndex);
+	default:
+		return GetCornerTransform(PieceIndex);
+	}
+}
+
+FMazeCellData AMazeBase::GetMazeCellData(FIntPoint CellCoordinates) const
+{
+	FMazeCellData CellData;
+	if (!MazeGrid.IsValidCoordinates(CellCoordinates))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Cell (%d, %d) is not part of the maze"), CellCoordinates.X, CellCoordinates.Y);
+		return CellData;
+	}
+
+	const int32 CellIndex = MazeGrid.ToIndex(CellCoordinates);
+	CellData.MazeCellTransform = GetCellTransform(CellIndex);
+	CellData.MazeCellCoordinates = CellCoordinates;
+	CellData.CellPosition = MazeGrid.GetCellPosition(CellIndex);
+	CellData.bAlgorithmHasVisited = MazeGrid.HasFlag(CellIndex, EMazeCellFlags::Visited);
+	return CellData;
+}
+
+TArray<FMazeCellData> AMazeBase::GetAllMazeCellData() const
+{
+	TArray<FMazeCellData> AllCellData;
+	AllCellData.Reserve(MazeGrid.Num());
+	for (int32 CellIndex = 0; CellIndex < MazeGrid.Num(); CellIndex++)
+	{
+		AllCellData.Add(GetMazeCellData(MazeGrid.ToCoordinates(CellIndex)));
+	}
+	return AllCellData;
+}
+
+bool AMazeBase::FindPath(FIntPoint FromCell, FIntPoint ToCell, TArray<FIntPoint>& OutCells)
+{
+	OutCells.Reset();
+	// while spawning the grid may still be the uncarved one
+	if (MazeGrid.Num() == 0 || IsMaterializing() || !MazeGrid.IsValidCoordinates(FromCell) || !MazeGrid.IsValidCoordinates(ToCell))
+	{
+		return false;
+	}
+
+	if (!Pathfinder.IsInitialized())
+	{
+		Pathfinder.Init(MazeGrid, MaxCachedPaths);
+	}
+
+	TArray<int32> Cells;
+	if (!Pathfinder.FindPath(MazeGrid, MazeGrid.ToIndex(FromCell), MazeGrid.ToIndex(ToCell), Cells))
+	{
+		return false;
+	}
+
+	OutCells.Reserve(Cells.Num());
+	for (int32 CellIndex : Cells)
+	{
+		OutCells.Add(MazeGrid.ToCoordinates(CellIndex));
+	}
+	return true;
+}
+
+bool AMazeBase::FindPathWorld(FVector FromLocation, FVector ToLocation, TArray<FVector>& OutLocations)
+{
+	OutLocations.Reset();
+	const int32 FromCell = GetCellIndexAtLocation(FromLocation);
+	const int32 ToCell = GetCellIndexAtLocation(ToLocation);
+	TArray<FIntPoint> Cells;
+	if (FromCell == INDEX_NONE || ToCell == INDEX_NONE || !FindPath(MazeGrid.ToCoordinates(FromCell), MazeGrid.ToCoordinates(ToCell), Cells))
+	{
+		return false;
+	}
+
+	OutLocations.Reserve(Cells.Num());
+	for (const FIntPoint& Cell : Cells)
+	{
+		OutLocations.Add(CellToWorld(Cell));
+	}
+	return true;
+}
+
+int32 AMazeBase::GetCellIndexAtLocation(const FVector& WorldLocation) const
+{
+	FIntPoint Cell;
+	return WorldToCell(WorldLocation, Cell) ? MazeGrid.ToIndex(Cell) : INDEX_NONE;
+}
+
+bool AMazeBase::WorldToCell(FVector WorldLocation, FIntPoint& OutCell) const
+{
+	if (MazeGrid.Num() == 0 || FloorSize.X <= 0 || FloorSize.Y <= 0)
+	{
+		return false;
+	}
+
+	// cell X spans the half open range [X - 0.5, X + 0.5) around its center in cell space
+	const FVector2D CellSpaceLocation = GetCellSpaceLocation(WorldLocation);
+	OutCell.X = FMath::FloorToInt32(CellSpaceLocation.X + 0.5);
+	OutCell.Y = FMath::FloorToInt32(CellSpaceLocation.Y + 0.5);
+	return MazeGrid.IsValidCoordinates(OutCell);
+}
+
+FVector AMazeBase::CellToWorld(FIntPoint Cell) const
+{
+	// GetCellTransform is arithmetic too, cells outside the grid continue its spacing
+	const FVector LocalLocation(
+		Cell.X * FloorSize.X - FloorSize.X * (MazeGrid.Width - 1) / 2,
+		Cell.Y * FloorSize.Y - FloorSize.Y * (MazeGrid.Height - 1) / 2,
+		0);
+	return GetActorTransform().TransformPosition(LocalLocation);
+}
+
+int32 AMazeBase::GetOpenDirections(FIntPoint Cell) const
+{
+	if (!MazeGrid.IsValidCoordinates(Cell))
+	{
+		return 0;
+	}
+
+	const int32 CellIndex = MazeGrid.ToIndex(Cell);
+	int32 OpenDirections = 0;
+	for (int32 Direction = 0; Direction < static_cast<int32>(EMazeDirection::EMD_MAX); Direction++)
+	{
+		if (!MazeGrid.HasWall(CellIndex, static_cast<EMazeDirection>(Direction)))
+		{
+			OpenDirections |= 1 << Direction;
+		}
+	}
+	return OpenDirections;
+}
+
+bool AMazeBase::IsWallBetween(FIntPoint CellA, FIntPoint CellB) const
+{
+	if (!MazeGrid.IsValidCoordinates(CellA) || !MazeGrid.IsValidCoordinates(CellB))
+	{
+		return true;
+	}
+
+	const FIntPoint Offset = CellB - CellA;
+	EMazeDirection Direction;
+	if (Offset == FIntPoint(1, 0))
+	{
+		Direction = EMazeDirection::EMD_PosX;
+	}
+	else if (Offset == FIntPoint(0, 1))
+	{
+		Direction = EMazeDirection::EMD_PosY;
+	}
+	else if (Offset == FIntPoint(-1, 0))
+	{
+		Direction = EMazeDirection::EMD_NegX;
+	}
+	else if (Offset == FIntPoint(0, -1))
+	{
+		Direction = EMazeDirection::EMD_NegY;
+	}
+	else
+	{
+		return true;
+	}
+	return MazeGrid.HasWall(MazeGrid.ToIndex(CellA), Direction);
+}
+
+EMazeDirection AMazeBase::GetFlowDirection(EMazeFlowFieldTarget Target, FIntPoint Cell, int32 RoomIndex) const
+{
+	const FMazeFlowField* FlowField = GetFlowField(Target, RoomIndex);
+	if (!FlowField || !MazeGrid.IsValidCoordinates(Cell))
+	{
+		return EMazeDirection::EMD_MAX;
+	}
+	return FlowField->GetDirection(MazeGrid.ToIndex(Cell));
+}
+
+FVector AMazeBase::GetFlowDirectionAtLocation(EMazeFlowFieldTarget Target, FVector WorldLocation, int32 RoomIndex) const
+{
+	const FMazeFlowField* FlowField = GetFlowField(Target, RoomIndex);
+	const int32 CellIndex = GetCellIndexAtLocation(WorldLocation);
+	if (!FlowField || CellIndex == INDEX_NONE)
+	{
+		return FVector::ZeroVector;
+	}
+
+	switch (FlowField->GetDirection(CellIndex))
+	{
+	case EMazeDirection::EMD_PosX :
+		return GetActorTransform().TransformVectorNoScale(FVector::ForwardVector);
+	case EMazeDirection::EMD_PosY :
+		return GetActorTransform().TransformVectorNoScale(FVector::RightVector);
+	case EMazeDirection::EMD_NegX :
+		return GetActorTransform().TransformVectorNoScale(FVector::BackwardVector);
+	case EMazeDirection::EMD_NegY :
+		return GetActorTransform().TransformVectorNoScale(FVector::LeftVector);
+	default:
+		return FVector::ZeroVector;
+	}
+}
+
+void AMazeBase::SetFlowFieldTarget(FVector WorldLocation)
+{
+	const int32 CellIndex = GetCellIndexAtLocation(WorldLocation);
+	if (CellIndex != INDEX_NONE)
+	{
+		SetFlowFieldTargetCell(MazeGrid.ToCoordinates(CellIndex));
+	}
+}
+
+void AMazeBase::SetFlowFieldTargetCell(FIntPoint Cell)
+{
+	// while spawning the grid may still be the uncarved one
+	if (IsMaterializing() || !MazeGrid.IsValidCoordinates(Cell))
+	{
+		return;
+	}
+	MovingTargetFlowField.Retarget(MazeGrid, MazeGrid.ToIndex(Cell));
+}
+
+void AMazeBase::BuildFlowFields()
+{
+	if (ExitOuterEdgeIndex != INDEX_NONE)
+	{
+		ExitFlowField.Build(MazeGrid, MazeGrid.GetOuterEdgeCell(ExitOuterEdgeIndex));
+	}
+	else
+	{
+		ExitFlowField.Reset();
+	}
+
+	RoomFlowFields.SetNum(RoomMinCells.Num());
+	for (int32 i = 0; i < RoomMinCells.Num(); i++)
+	{
+		RoomFlowFields[i].Build(MazeGrid, MazeGrid.ToIndex((RoomMinCells[i] + RoomMaxCells[i]) / 2));
+	}
+}
+
+void AMazeBase::ResetFlowFields()
+{
+	ExitFlowField.Reset();
+	RoomFlowFields.Empty();
+	MovingTargetFlowField.Reset();
+}
+
+const FMazeFlowField* AMazeBase::GetFlowField(EMazeFlowFieldTarget Target, int32 RoomIndex) const
+{
+	switch (Target)
+	{
+	case EMazeFlowFieldTarget::EMFT_Exit :
+		return ExitFlowField.IsBuilt() ? &ExitFlowField : nullptr;
+	case EMazeFlowFieldTarget::EMFT_Room :
+		return RoomFlowFields.IsValidIndex(RoomIndex) && RoomFlowFields[RoomIndex].IsBuilt() ? &RoomFlowFields[RoomIndex] : nullptr;
+	case EMazeFlowFieldTarget::EMFT_MovingTarget :
+		return MovingTargetFlowField.IsBuilt() ? &MovingTargetFlowField : nullptr;
+	default:
+		return nullptr;
+	}
+}
+
+EMazeCellTag AMazeBase::GetCellTag(FIntPoint Cell) const
+{
+	return MazeGrid.IsValidCoordinates(Cell) ? CellTagIndex.GetTag(MazeGrid.ToIndex(Cell)) : EMazeCellTag::EMCT_MAX;
+}
+
+int32 AMazeBase::GetTaggedCellCount(EMazeCellTag Tag) const
+{
+	return CellTagIndex.GetCells(Tag).Num();
+}
+
+void AMazeBase::FindNearestTaggedCells(EMazeCellTag Tag, FVector WorldLocation, int32 Count, TArray<FVector>& OutLocations) const
+{
+	OutLocations.Reset();
+	TArray<int32> Cells;
+	CellTagIndex.FindNearest(Tag, GetCellSpaceLocation(WorldLocation), Count, Cells);
+	OutLocations.Reserve(Cells.Num());
+	for (int32 CellIndex : Cells)
+	{
+		OutLocations.Add(GetCellWorldLocation(CellIndex));
+	}
+}
+
+void AMazeBase::FindTaggedCellsWithinSteps(EMazeCellTag Tag, FVector WorldLocation, int32 MaxSteps, TArray<FVector>& OutLocations)
+{
+	OutLocations.Reset();
+	const int32 StartCell = GetCellIndexAtLocation(WorldLocation);
+	if (StartCell == INDEX_NONE)
+	{
+		return;
+	}
+
+	TArray<int32> Cells;
+	CellTagIndex.FindWithinSteps(MazeGrid, Tag, StartCell, MaxSteps, Cells);
+	OutLocations.Reserve(Cells.Num());
+	for (int32 CellIndex : Cells)
+	{
+		OutLocations.Add(GetCellWorldLocation(CellIndex));
+	}
+}
+
+bool AMazeBase::GetRandomTaggedCell(EMazeCellTag Tag, FVector ExcludedLocation, float ExcludedRadius, FVector& OutLocation)
+{
+	// the index measures in the local space of the maze
+	const float LocalRadius = ExcludedRadius / GetActorScale3D().GetAbsMax();
+	const int32 CellIndex = CellTagIndex.GetRandomCell(Tag, GetCellSpaceLocation(ExcludedLocation), LocalRadius, CellTagRandomStream);
+	if (CellIndex == INDEX_NONE)
+	{
+		return false;
+	}
+	OutLocation = GetCellWorldLocation(CellIndex);
+	return true;
+}
+
+void AMazeBase::BuildCellTagIndex()
+{
+	TArray<int32, TInlineAllocator<2>> EntryExitCells;
+	if (EntryOuterEdgeIndex != INDEX_NONE)
+	{
+		EntryExitCells.Add(MazeGrid.GetOuterEdgeCell(EntryOuterEdgeIndex));
+	}
+	if (ExitOuterEdgeIndex != INDEX_NONE)
+	{
+		EntryExitCells.Add(MazeGrid.GetOuterEdgeCell(ExitOuterEdgeIndex));
+	}
+	CellTagIndex.Build(MazeGrid, EntryExitCells, FVector2D(FloorSize.X, FloorSize.Y));
+}
+
+FVector2D AMazeBase::GetCellSpaceLocation(const FVector& WorldLocation) const
+{
+	if (FloorSize.X <= 0 || FloorSize.Y <= 0)
+	{
+		return FVector2D::ZeroVector;
+	}
+
+	// inverse of GetCellTransform without rounding to a cell
+	const FVector LocalLocation = GetActorTransform().InverseTransformPosition(WorldLocation);
+	return FVector2D(
+		LocalLocation.X / FloorSize.X + (MazeGrid.Width - 1) * 0.5,
+		LocalLocation.Y / FloorSize.Y + (MazeGrid.Height - 1) * 0.5);
+}
+
+FVector AMazeBase::GetCellWorldLocation(int32 CellIndex) const
+{
+	return CellToWorld(MazeGrid.ToCoordinates(CellIndex));
+}
+
+
+// Called every frame
+void AMazeBase::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (IsMaterializing())
+	{
+		if (ContinueMaterialization(FPlatformTime::Seconds() + MaterializationFrameBudgetMs / 1000.0))
+		{
+			FinishMaterialization();
+		}
+		else
+		{
+			OnMazeMaterializationProgress.Broadcast(GetMaterializationProgress());
+		}
+	}
+}
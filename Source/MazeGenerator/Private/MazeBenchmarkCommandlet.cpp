@@ -0,0 +1,692 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeBenchmarkCommandlet.h"
+
+#include <atomic>
+
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/UObjectArray.h"
+
+namespace MazeBenchmark
+{
+	/// <summary>
+	/// Counts the allocations made while it is GMalloc and passes every call on to the allocator it replaced.
+	/// Counts the allocations of every thread, not only the ones of the maze.
+	/// </summary>
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc* InInner)
+			: Inner(InInner)
+		{
+		}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			Track(Count);
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			Track(Count);
+			return Inner->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			Track(Count);
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			Track(Count);
+			return Inner->TryRealloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+
+		virtual void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+
+		virtual void UpdateStats() override { Inner->UpdateStats(); }
+
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+		FORCEINLINE uint64 GetAllocations() const { return Allocations.load(std::memory_order_relaxed); }
+
+		FORCEINLINE uint64 GetAllocatedBytes() const { return AllocatedBytes.load(std::memory_order_relaxed); }
+
+	private:
+		FORCEINLINE void Track(SIZE_T Count)
+		{
+			// a realloc to 0 bytes is a free
+			if (Count > 0)
+			{
+				Allocations.fetch_add(1, std::memory_order_relaxed);
+				AllocatedBytes.fetch_add(Count, std::memory_order_relaxed);
+			}
+		}
+
+		FMalloc* Inner;
+
+		std::atomic<uint64> Allocations = 0;
+
+		std::atomic<uint64> AllocatedBytes = 0;
+	};
+
+	/// <summary>
+	/// Created by the first suite that counts allocations and installed as GMalloc while a suite runs.
+	/// It is never deleted, another thread may still be inside one of its calls after GMalloc was put back.
+	/// </summary>
+	static FCountingMalloc* AllocationCounter = nullptr;
+
+	static FORCEINLINE bool IsCountingAllocations()
+	{
+		return AllocationCounter && GMalloc == AllocationCounter;
+	}
+
+	/// <summary>
+	/// Counters read before a run, subtracted from the ones read after it.
+	/// </summary>
+	struct FSample
+	{
+		FSample()
+			: Allocations(IsCountingAllocations() ? AllocationCounter->GetAllocations() : 0)
+			, AllocatedBytes(IsCountingAllocations() ? AllocationCounter->GetAllocatedBytes() : 0)
+			, Objects(GUObjectArray.GetObjectArrayNumMinusAvailable())
+			, UsedPhysical(FPlatformMemory::GetStats().UsedPhysical)
+			, Time(FPlatformTime::Seconds())
+		{
+		}
+
+		uint64 Allocations;
+		uint64 AllocatedBytes;
+		int32 Objects;
+		uint64 UsedPhysical;
+		double Time;
+	};
+
+	static void FillResult(FMazeBenchmarkResult& Result, const FSample& Before, const FSample& After)
+	{
+		Result.TotalMs = (After.Time - Before.Time) * 1000.0;
+		Result.Allocations = After.Allocations - Before.Allocations;
+		Result.AllocatedBytes = After.AllocatedBytes - Before.AllocatedBytes;
+		Result.ObjectsCreated = After.Objects - Before.Objects;
+		Result.UsedPhysicalDeltaBytes = static_cast<int64>(After.UsedPhysical) - static_cast<int64>(Before.UsedPhysical);
+	}
+
+	/// <summary>
+	/// Name of an enum value without its prefix, EMA_Prim gives Prim.
+	/// </summary>
+	static FString GetValueKey(const UEnum* Enum, int64 Value)
+	{
+		FString Key = Enum->GetNameStringByValue(Value);
+		int32 Separator = INDEX_NONE;
+		if (Key.FindChar(TEXT('_'), Separator))
+		{
+			Key.RightChopInline(Separator + 1);
+		}
+		return Key;
+	}
+
+	static constexpr double MegaBytes = 1024.0 * 1024.0;
+}
+
+TArray<TPair<FString, double>> FMazeBenchmarkResult::GetStageMs() const
+{
+	TArray<TPair<FString, double>> StageMs;
+	StageMs.Emplace(TEXT("rooms"), Stats.RoomsMs);
+	StageMs.Emplace(TEXT("algorithm"), Stats.AlgorithmMs);
+	StageMs.Emplace(TEXT("entry_exit"), Stats.EntryExitMs);
+	if (Backend != TEXT("Layout"))
+	{
+		StageMs.Emplace(TEXT("floors"), Stats.FloorsMs);
+		StageMs.Emplace(TEXT("corners"), Stats.CornersMs);
+		StageMs.Emplace(TEXT("walls"), Stats.WallsMs);
+		StageMs.Emplace(TEXT("carve"), Stats.CarveMs);
+		StageMs.Emplace(TEXT("finish"), Stats.FinishMs);
+	}
+	return StageMs;
+}
+
+TSharedRef<FJsonObject> FMazeBenchmarkResult::ToJson() const
+{
+	TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+	Object->SetStringField(TEXT("name"), Name);
+	Object->SetNumberField(TEXT("width"), Width);
+	Object->SetNumberField(TEXT("height"), Height);
+	Object->SetStringField(TEXT("algorithm"), Algorithm);
+	Object->SetStringField(TEXT("backend"), Backend);
+	Object->SetBoolField(TEXT("skipped"), bSkipped);
+	Object->SetBoolField(TEXT("failed"), bFailed);
+	if (bSkipped)
+	{
+		return Object;
+	}
+
+	TSharedRef<FJsonObject> Stages = MakeShared<FJsonObject>();
+	for (const TPair<FString, double>& Stage : GetStageMs())
+	{
+		Stages->SetNumberField(Stage.Key, Stage.Value);
+	}
+	Object->SetObjectField(TEXT("stages_ms"), Stages);
+	Object->SetNumberField(TEXT("total_ms"), TotalMs);
+	Object->SetNumberField(TEXT("allocations"), static_cast<double>(Allocations));
+	Object->SetNumberField(TEXT("allocated_mb"), AllocatedBytes / MazeBenchmark::MegaBytes);
+	Object->SetNumberField(TEXT("uobjects_created"), ObjectsCreated);
+	Object->SetNumberField(TEXT("used_physical_delta_mb"), UsedPhysicalDeltaBytes / MazeBenchmark::MegaBytes);
+	Object->SetNumberField(TEXT("cells_visited"), Stats.CellsVisited);
+	Object->SetNumberField(TEXT("walls_carved"), Stats.WallsCarved);
+	Object->SetNumberField(TEXT("room_placement_retries"), Stats.RoomPlacementRetries);
+	Object->SetNumberField(TEXT("components_created"), Stats.ComponentsCreated);
+	Object->SetNumberField(TEXT("components_destroyed"), Stats.ComponentsDestroyed);
+	Object->SetNumberField(TEXT("scratch_mb"), Stats.ScratchBytes / MazeBenchmark::MegaBytes);
+	Object->SetNumberField(TEXT("bytes_used_mb"), Stats.BytesUsed / MazeBenchmark::MegaBytes);
+	return Object;
+}
+
+UMazeBenchmarkCommandlet::UMazeBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UMazeBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 Width = 1000;
+	int32 Height = 1000;
+	int32 Seed = 0;
+	int32 Iterations = 3;
+	FParse::Value(*Params, TEXT("Width="), Width);
+	FParse::Value(*Params, TEXT("Height="), Height);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+
+	if (Width <= 0 || Height <= 0 || Iterations <= 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Width, Height and Iterations have to be greater than 0"));
+		return 1;
+	}
+
+	if (FParse::Param(*Params, TEXT("Suite")))
+	{
+		return RunSuite(Params, Seed, Iterations);
+	}
+	
+	if (FParse::Param(*Params, TEXT("Tiles")))
+	{
+		BenchmarkParallelTiles(Seed, Iterations);
+	}
+	else
+	{
+		BenchmarkAlgorithms(Width, Height, Seed, Iterations);
+	}
+	return 0;
+}
+
+void UMazeBenchmarkCommandlet::BenchmarkAlgorithms(int32 Width, int32 Height, int32 Seed, int32 Iterations)
+{
+	const UEnum* AlgorithmEnum = StaticEnum<EMazeAlgorithm>();
+	const double NumCells = static_cast<double>(Width) * Height;
+
+	UE_LOG(LogTemp, Display, TEXT("Maze algorithm benchmark, %d x %d cells, seed %d, best of %d"), Width, Height, Seed, Iterations);
+	
+	// the last entry of a UENUM is the generated _MAX
+	for (int32 i = 0; i < AlgorithmEnum->NumEnums() - 1; i++)
+	{
+		FMazeGenerationSettings Settings;
+		Settings.MazeWidth = Width;
+		Settings.MazeHeight = Height;
+		Settings.Seed = Seed;
+		Settings.Algorithm = static_cast<EMazeAlgorithm>(AlgorithmEnum->GetValueByIndex(i));
+
+		int64 PeakBytes = 0;
+		const double BestSeconds = TimeGeneration(Settings, Iterations, PeakBytes);
+
+		UE_LOG(LogTemp, Display, TEXT("%-24s %10.2f ms %14.0f cells/s %10.2f MB peak"),
+			*AlgorithmEnum->GetDisplayNameTextByIndex(i).ToString(),
+			BestSeconds * 1000.0,
+			NumCells / FMath::Max(BestSeconds, UE_SMALL_NUMBER),
+			PeakBytes / (1024.0 * 1024.0));
+	}
+}
+
+void UMazeBenchmarkCommandlet::BenchmarkParallelTiles(int32 Seed, int32 Iterations)
+{
+	for (int32 Size : { 1000, 4000 })
+	{
+		FMazeGenerationSettings Settings;
+		Settings.MazeWidth = Size;
+		Settings.MazeHeight = Size;
+		Settings.Seed = Seed;
+
+		int64 SerialBytes = 0;
+		Settings.Algorithm = EMazeAlgorithm::EMA_Backtracker;
+		const double SerialSeconds = TimeGeneration(Settings, Iterations, SerialBytes);
+
+		int64 ParallelBytes = 0;
+		Settings.Algorithm = EMazeAlgorithm::EMA_ParallelTiles;
+		const double ParallelSeconds = TimeGeneration(Settings, Iterations, ParallelBytes);
+
+		UE_LOG(LogTemp, Display, TEXT("%d x %d: backtracker %.2f ms, parallel tiles %.2f ms (tile size %d), %.2fx faster"),
+			Size, Size, SerialSeconds * 1000.0, ParallelSeconds * 1000.0, Settings.ParallelTileSize,
+			SerialSeconds / FMath::Max(ParallelSeconds, UE_SMALL_NUMBER));
+	}
+}
+
+double UMazeBenchmarkCommandlet::TimeGeneration(const FMazeGenerationSettings& Settings, int32 Iterations, int64& OutPeakBytes)
+{
+	double BestSeconds = TNumericLimits<double>::Max();
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		FMazeLayout Layout;
+		FMazeLayoutGenerator Generator(Settings);
+		
+		const double StartTime = FPlatformTime::Seconds();
+		Generator.Generate(Layout);
+		BestSeconds = FMath::Min(BestSeconds, FPlatformTime::Seconds() - StartTime);
+		
+		OutPeakBytes = FMath::Max(OutPeakBytes, static_cast<int64>(Layout.Grid.Cells.GetAllocatedSize()) + Generator.GetPeakScratchBytes());
+	}
+	return BestSeconds;
+}
+
+int32 UMazeBenchmarkCommandlet::RunSuite(const FString& Params, int32 Seed, int32 Iterations)
+{
+	TArray<int32> Sizes = { 10, 100, 500, 2000 };
+	FString SizesParam;
+	if (FParse::Value(*Params, TEXT("Sizes="), SizesParam, false))
+	{
+		TArray<FString> SizeStrings;
+		SizesParam.ParseIntoArray(SizeStrings, TEXT(","));
+		Sizes.Reset();
+		for (const FString& SizeString : SizeStrings)
+		{
+			Sizes.Add(FCString::Atoi(*SizeString));
+		}
+	}
+	if (Sizes.IsEmpty() || Sizes.ContainsByPredicate([](int32 Size) { return Size <= 0; }))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Sizes has to be a list of sizes greater than 0"));
+		return 1;
+	}
+
+	FString OutputFile = FPaths::ProjectSavedDir() / TEXT("MazeBenchmark") / TEXT("Results.json");
+	FString BaselineFile;
+	double Tolerance = 0.15;
+	double MinDeltaMs = 1.0;
+	double MinDeltaAllocations = 1000.0;
+	int64 MaxChildActorCells = 250000;
+	int64 MaxInstancedCells = 1000000;
+	FParse::Value(*Params, TEXT("Output="), OutputFile);
+	FParse::Value(*Params, TEXT("Baseline="), BaselineFile);
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+	FParse::Value(*Params, TEXT("MinDeltaMs="), MinDeltaMs);
+	FParse::Value(*Params, TEXT("MinDeltaAllocations="), MinDeltaAllocations);
+	FParse::Value(*Params, TEXT("MaxChildActorCells="), MaxChildActorCells);
+	FParse::Value(*Params, TEXT("MaxInstancedCells="), MaxInstancedCells);
+
+	UStaticMesh* PieceMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!PieceMesh)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not load the piece mesh /Engine/BasicShapes/Cube"));
+		return 1;
+	}
+
+	// the counter sits on every allocation of every thread, which is only acceptable while a commandlet owns the process
+	const bool bCountAllocations = IsRunningCommandlet();
+	FMalloc* PreviousMalloc = GMalloc;
+	if (bCountAllocations)
+	{
+		if (!MazeBenchmark::AllocationCounter)
+		{
+			MazeBenchmark::AllocationCounter = new MazeBenchmark::FCountingMalloc(GMalloc);
+		}
+		GMalloc = MazeBenchmark::AllocationCounter;
+	}
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("MazeBenchmark"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	const UEnum* AlgorithmEnum = StaticEnum<EMazeAlgorithm>();
+	const UEnum* BackendEnum = StaticEnum<EMazeRenderBackend>();
+	TArray<FMazeBenchmarkResult> Results;
+
+	UE_LOG(LogTemp, Display, TEXT("Maze benchmark suite, seed %d, best of %d"), Seed, Iterations);
+	
+	for (int32 Size : Sizes)
+	{
+		// the last entry of a UENUM is the generated _MAX
+		for (int32 i = 0; i < AlgorithmEnum->NumEnums() - 1; i++)
+		{
+			const EMazeAlgorithm Algorithm = static_cast<EMazeAlgorithm>(AlgorithmEnum->GetValueByIndex(i));
+			const FMazeGenerationSettings Settings = MakeSuiteSettings(Size, Seed, Algorithm);
+
+			Results.Add(MeasureLayout(Settings, Iterations));
+			for (int32 j = 0; j < BackendEnum->NumEnums() - 1; j++)
+			{
+				const EMazeRenderBackend Backend = static_cast<EMazeRenderBackend>(BackendEnum->GetValueByIndex(j));
+				const int64 NumCells = static_cast<int64>(Size) * Size;
+				if ((Backend == EMazeRenderBackend::EMRB_ChildActors && NumCells > MaxChildActorCells)
+					|| (Backend == EMazeRenderBackend::EMRB_InstancedMeshes && NumCells > MaxInstancedCells))
+				{
+					FMazeBenchmarkResult& Skipped = Results.AddDefaulted_GetRef();
+					Skipped.Width = Size;
+					Skipped.Height = Size;
+					Skipped.Algorithm = MazeBenchmark::GetValueKey(AlgorithmEnum, static_cast<int64>(Algorithm));
+					Skipped.Backend = MazeBenchmark::GetValueKey(BackendEnum, static_cast<int64>(Backend));
+					Skipped.Name = FString::Printf(TEXT("%dx%d/%s/%s"), Size, Size, *Skipped.Algorithm, *Skipped.Backend);
+					Skipped.bSkipped = true;
+				}
+				else
+				{
+					Results.Add(MeasureBackend(World, Settings, Backend, PieceMesh, Iterations));
+				}
+			}
+		}
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	GMalloc = PreviousMalloc;
+
+	for (const FMazeBenchmarkResult& Result : Results)
+	{
+		if (Result.bSkipped)
+		{
+			UE_LOG(LogTemp, Display, TEXT("%-40s skipped"), *Result.Name);
+			continue;
+		}
+		if (Result.bFailed)
+		{
+			UE_LOG(LogTemp, Error, TEXT("%-40s could not be constructed"), *Result.Name);
+			continue;
+		}
+		UE_LOG(LogTemp, Display, TEXT("%-40s %10.2f ms %10llu allocations %8d UObjects %10.2f MB"),
+			*Result.Name, Result.TotalMs, Result.Allocations, Result.ObjectsCreated, Result.AllocatedBytes / MazeBenchmark::MegaBytes);
+	}
+
+	TArray<TSharedPtr<FJsonValue>> Regressions;
+	bool bBaselineRead = true;
+	if (!BaselineFile.IsEmpty())
+	{
+		bBaselineRead = CompareWithBaseline(Results, bCountAllocations, BaselineFile, Tolerance, MinDeltaMs, MinDeltaAllocations, Regressions);
+	}
+
+	TArray<TSharedPtr<FJsonValue>> Runs;
+	for (const FMazeBenchmarkResult& Result : Results)
+	{
+		Runs.Add(MakeShared<FJsonValueObject>(Result.ToJson()));
+	}
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetNumberField(TEXT("seed"), Seed);
+	Root->SetNumberField(TEXT("iterations"), Iterations);
+	Root->SetBoolField(TEXT("allocations_counted"), bCountAllocations);
+	Root->SetNumberField(TEXT("peak_used_physical_mb"), FPlatformMemory::GetStats().PeakUsedPhysical / MazeBenchmark::MegaBytes);
+	Root->SetArrayField(TEXT("runs"), Runs);
+	if (!BaselineFile.IsEmpty())
+	{
+		Root->SetStringField(TEXT("baseline"), BaselineFile);
+		Root->SetArrayField(TEXT("regressions"), Regressions);
+	}
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	if (!FJsonSerializer::Serialize(Root, Writer) || !FFileHelper::SaveStringToFile(Json, *OutputFile))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not write the benchmark results to %s"), *OutputFile);
+		return 1;
+	}
+	UE_LOG(LogTemp, Display, TEXT("Wrote %d benchmark runs to %s"), Results.Num(), *OutputFile);
+
+	if (!bBaselineRead || Results.ContainsByPredicate([](const FMazeBenchmarkResult& Result) { return Result.bFailed; }))
+	{
+		return 1;
+	}
+	if (Regressions.Num() > 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%d metrics regressed against %s"), Regressions.Num(), *BaselineFile);
+		return 1;
+	}
+	return 0;
+}
+
+FMazeGenerationSettings UMazeBenchmarkCommandlet::MakeSuiteSettings(int32 Size, int32 Seed, EMazeAlgorithm Algorithm)
+{
+	FMazeGenerationSettings Settings;
+	Settings.MazeWidth = Size;
+	Settings.MazeHeight = Size;
+	Settings.Seed = Seed;
+	Settings.Algorithm = Algorithm;
+	Settings.bCreateRooms = true;
+	Settings.NumberOfRooms = FMath::Max(1, Size * Size / 400);
+	Settings.RoomWidth = FMath::Min(3, Size);
+	Settings.RoomHeight = FMath::Min(3, Size);
+	Settings.NumberOfRoomDoors = 2;
+	Settings.bHasEntry = true;
+	Settings.bRandomEntry = true;
+	Settings.bHasExit = true;
+	Settings.bRandomExit = true;
+	return Settings;
+}
+
+FMazeBenchmarkResult UMazeBenchmarkCommandlet::MeasureLayout(const FMazeGenerationSettings& Settings, int32 Iterations)
+{
+	FMazeBenchmarkResult Best;
+	Best.TotalMs = TNumericLimits<double>::Max();
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		FMazeBenchmarkResult Result;
+		{
+			const MazeBenchmark::FSample Before;
+			FMazeLayout Layout;
+			FMazeLayoutGenerator Generator(Settings);
+			Generator.Generate(Layout);
+			const MazeBenchmark::FSample After;
+			
+			MazeBenchmark::FillResult(Result, Before, After);
+			Result.Stats = Generator.GetStats();
+			Result.Stats.BytesUsed = Layout.Grid.Cells.GetAllocatedSize();
+		}
+		if (Result.TotalMs < Best.TotalMs)
+		{
+			Best = MoveTemp(Result);
+		}
+	}
+
+	Best.Width = Settings.MazeWidth;
+	Best.Height = Settings.MazeHeight;
+	Best.Algorithm = MazeBenchmark::GetValueKey(StaticEnum<EMazeAlgorithm>(), static_cast<int64>(Settings.Algorithm));
+	Best.Backend = TEXT("Layout");
+	Best.Name = FString::Printf(TEXT("%dx%d/%s/%s"), Best.Width, Best.Height, *Best.Algorithm, *Best.Backend);
+	return Best;
+}
+
+FMazeBenchmarkResult UMazeBenchmarkCommandlet::MeasureBackend(UWorld* World, const FMazeGenerationSettings& Settings, EMazeRenderBackend Backend, UStaticMesh* PieceMesh, int32 Iterations)
+{
+	FMazeBenchmarkResult Best;
+	Best.TotalMs = TNumericLimits<double>::Max();
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		// pieces of the last iteration would otherwise be freed in the middle of this one
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		
+		FMazeBenchmarkResult Result;
+		const MazeBenchmark::FSample Before;
+		AMazeBase* Maze = World->SpawnActor<AMazeBase>();
+		if (!Maze)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Could not spawn a maze"));
+			Best.bFailed = true;
+			break;
+		}
+		
+		Maze->MazeWidth = Settings.MazeWidth;
+		Maze->MazeHeight = Settings.MazeHeight;
+		Maze->bUseCustomSeed = true;
+		Maze->Seed = Settings.Seed;
+		Maze->Algorithm = Settings.Algorithm;
+		Maze->bCreateRooms = Settings.bCreateRooms;
+		Maze->NumberOfRooms = Settings.NumberOfRooms;
+		Maze->RoomWidth = Settings.RoomWidth;
+		Maze->RoomHeight = Settings.RoomHeight;
+		Maze->NumberOfRoomDoors = Settings.NumberOfRoomDoors;
+		Maze->bHasEntry = Settings.bHasEntry;
+		Maze->bRandomEntry = Settings.bRandomEntry;
+		Maze->bHasExit = Settings.bHasExit;
+		Maze->bRandomExit = Settings.bRandomExit;
+		Maze->bUseLayoutCache = false;
+		Maze->RenderBackend = Backend;
+		Maze->FloorActorClass = AStaticMeshActor::StaticClass();
+		Maze->InnerWallActorClass = AStaticMeshActor::StaticClass();
+		Maze->OuterWallActorClass = AStaticMeshActor::StaticClass();
+		Maze->InnerCornerActorClass = AStaticMeshActor::StaticClass();
+		Maze->OuterCornerActorClass = AStaticMeshActor::StaticClass();
+		Maze->bUseMeshSizes = true;
+		Maze->FloorMeshSize = PieceMesh;
+		Maze->InnerWallMeshSize = PieceMesh;
+		Maze->OuterWallMeshSize = PieceMesh;
+		Maze->InnerCornerMeshSize = PieceMesh;
+		Maze->OuterCornerMeshSize = PieceMesh;
+
+		Maze->RegenerateMaze();
+		const MazeBenchmark::FSample After;
+
+		MazeBenchmark::FillResult(Result, Before, After);
+		// the layout cache is off, so the layout stages are part of every run
+		Result.Stats = Maze->GetGenerationStats();
+		Result.bFailed = Maze->HasConstructionFailed();
+		
+		Maze->Destroy();
+		if (Result.bFailed)
+		{
+			// a maze without pieces is quick, it must not become the best iteration
+			Best = MoveTemp(Result);
+			break;
+		}
+		if (Result.TotalMs < Best.TotalMs)
+		{
+			Best = MoveTemp(Result);
+		}
+	}
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+	Best.Width = Settings.MazeWidth;
+	Best.Height = Settings.MazeHeight;
+	Best.Algorithm = MazeBenchmark::GetValueKey(StaticEnum<EMazeAlgorithm>(), static_cast<int64>(Settings.Algorithm));
+	Best.Backend = MazeBenchmark::GetValueKey(StaticEnum<EMazeRenderBackend>(), static_cast<int64>(Backend));
+	Best.Name = FString::Printf(TEXT("%dx%d/%s/%s"), Best.Width, Best.Height, *Best.Algorithm, *Best.Backend);
+	return Best;
+}
+
+bool UMazeBenchmarkCommandlet::CompareWithBaseline(const TArray<FMazeBenchmarkResult>& Results, bool bAllocationsCounted, const FString& BaselineFile,
+	double Tolerance, double MinDeltaMs, double MinDeltaAllocations, TArray<TSharedPtr<FJsonValue>>& OutRegressions)
+{
+	FString Json;
+	TSharedPtr<FJsonObject> Baseline;
+	if (!FFileHelper::LoadFileToString(Json, *BaselineFile) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Baseline) || !Baseline)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not read the benchmark baseline %s"), *BaselineFile);
+		return false;
+	}
+
+	// baselines written before the field existed always counted allocations
+	bool bBaselineAllocationsCounted = true;
+	Baseline->TryGetBoolField(TEXT("allocations_counted"), bBaselineAllocationsCounted);
+	const bool bCompareAllocations = bAllocationsCounted && bBaselineAllocationsCounted;
+
+	TMap<FString, TSharedPtr<FJsonObject>> BaselineRuns;
+	const TArray<TSharedPtr<FJsonValue>>* Runs = nullptr;
+	if (Baseline->TryGetArrayField(TEXT("runs"), Runs))
+	{
+		for (const TSharedPtr<FJsonValue>& Run : *Runs)
+		{
+			const TSharedPtr<FJsonObject>* RunObject = nullptr;
+			bool bFailed = false;
+			if (Run->TryGetObject(RunObject) && !(*RunObject)->GetBoolField(TEXT("skipped"))
+				&& !((*RunObject)->TryGetBoolField(TEXT("failed"), bFailed) && bFailed))
+			{
+				BaselineRuns.Add((*RunObject)->GetStringField(TEXT("name")), *RunObject);
+			}
+		}
+	}
+
+	auto Check = [&OutRegressions, Tolerance](const FString& Name, const FString& Metric, double BaselineValue, double Value, double MinDelta)
+	{
+		if (Value > BaselineValue * (1.0 + Tolerance) && Value - BaselineValue > MinDelta)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Regression in %s %s: %.2f, baseline %.2f (+%.1f%%)"),
+				*Name, *Metric, Value, BaselineValue, (Value / FMath::Max(BaselineValue, UE_SMALL_NUMBER) - 1.0) * 100.0);
+			
+			TSharedRef<FJsonObject> Regression = MakeShared<FJsonObject>();
+			Regression->SetStringField(TEXT("name"), Name);
+			Regression->SetStringField(TEXT("metric"), Metric);
+			Regression->SetNumberField(TEXT("baseline"), BaselineValue);
+			Regression->SetNumberField(TEXT("value"), Value);
+			OutRegressions.Add(MakeShared<FJsonValueObject>(Regression));
+		}
+	};
+
+	for (const FMazeBenchmarkResult& Result : Results)
+	{
+		const TSharedPtr<FJsonObject>* BaselineRun = BaselineRuns.Find(Result.Name);
+		if (Result.bSkipped || Result.bFailed || !BaselineRun)
+		{
+			continue;
+		}
+
+		Check(Result.Name, TEXT("total_ms"), (*BaselineRun)->GetNumberField(TEXT("total_ms")), Result.TotalMs, MinDeltaMs);
+		if (bCompareAllocations)
+		{
+			// the counter also sees other threads, the minimum keeps their background allocations from failing a small maze
+			Check(Result.Name, TEXT("allocations"), (*BaselineRun)->GetNumberField(TEXT("allocations")), static_cast<double>(Result.Allocations), MinDeltaAllocations);
+		}
+		
+		const TSharedPtr<FJsonObject>* BaselineStages = nullptr;
+		if ((*BaselineRun)->TryGetObjectField(TEXT("stages_ms"), BaselineStages))
+		{
+			for (const TPair<FString, double>& Stage : Result.GetStageMs())
+			{
+				double BaselineMs = 0.0;
+				if ((*BaselineStages)->TryGetNumberField(Stage.Key, BaselineMs))
+				{
+					Check(Result.Name, Stage.Key, BaselineMs, Stage.Value, MinDeltaMs);
+				}
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,276 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeCellIndex.h"
+
+void FMazeCellIndex::Build(const FMazeGrid& Grid, TConstArrayView<int32> EntryExitCells, const FVector2D& InCellSize)
+{
+	Reset();
+	if (Grid.Num() == 0)
+	{
+		return;
+	}
+
+	Width = Grid.Width;
+	Height = Grid.Height;
+	CellSize = InCellSize;
+	NumBucketsX = FMath::DivideAndRoundUp(Width, BucketSize);
+	NumBucketsY = FMath::DivideAndRoundUp(Height, BucketSize);
+	const int32 NumBuckets = NumBucketsX * NumBucketsY;
+
+	Tags.SetNumUninitialized(Grid.Num());
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		EMazeCellTag Tag;
+		if (Grid.HasFlag(CellIndex, EMazeCellFlags::Room))
+		{
+			Tag = EMazeCellTag::EMCT_Room;
+		}
+		else
+		{
+			int32 Neighbors[4];
+			const int32 NumOpen = FMazePathfinder::GetOpenNeighbors(Grid, CellIndex, Neighbors);
+			Tag = NumOpen >= 3 ? EMazeCellTag::EMCT_Junction : NumOpen == 2 ? EMazeCellTag::EMCT_Corridor : EMazeCellTag::EMCT_DeadEnd;
+		}
+		Tags[CellIndex] = static_cast<uint8>(Tag);
+	}
+	for (int32 CellIndex : EntryExitCells)
+	{
+		if (Grid.IsValidIndex(CellIndex))
+		{
+			Tags[CellIndex] = static_cast<uint8>(EMazeCellTag::EMCT_EntryExit);
+		}
+	}
+
+	// counting sort of the cells of every tag by block
+	for (int32 Tag = 0; Tag < static_cast<int32>(EMazeCellTag::EMCT_MAX); Tag++)
+	{
+		BucketStarts[Tag].SetNumZeroed(NumBuckets + 1);
+	}
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		const int32 Bucket = GetBucket(CellIndex % Width / BucketSize, CellIndex / Width / BucketSize);
+		BucketStarts[Tags[CellIndex]][Bucket + 1]++;
+	}
+	TArray<int32> BucketEnds[static_cast<int32>(EMazeCellTag::EMCT_MAX)];
+	for (int32 Tag = 0; Tag < static_cast<int32>(EMazeCellTag::EMCT_MAX); Tag++)
+	{
+		TArray<int32>& Starts = BucketStarts[Tag];
+		for (int32 Bucket = 0; Bucket < NumBuckets; Bucket++)
+		{
+			Starts[Bucket + 1] += Starts[Bucket];
+		}
+		TaggedCells[Tag].SetNumUninitialized(Starts[NumBuckets]);
+		BucketEnds[Tag] = Starts;
+	}
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		const int32 Bucket = GetBucket(CellIndex % Width / BucketSize, CellIndex / Width / BucketSize);
+		TaggedCells[Tags[CellIndex]][BucketEnds[Tags[CellIndex]][Bucket]++] = CellIndex;
+	}
+}
+
+void FMazeCellIndex::Reset()
+{
+	Tags.Empty();
+	for (int32 Tag = 0; Tag < static_cast<int32>(EMazeCellTag::EMCT_MAX); Tag++)
+	{
+		TaggedCells[Tag].Empty();
+		BucketStarts[Tag].Empty();
+	}
+	Width = 0;
+	Height = 0;
+	NumBucketsX = 0;
+	NumBucketsY = 0;
+	Search.Reset();
+}
+
+TConstArrayView<int32> FMazeCellIndex::GetCells(EMazeCellTag Tag) const
+{
+	if (Tag >= EMazeCellTag::EMCT_MAX)
+	{
+		return TConstArrayView<int32>();
+	}
+	return TaggedCells[static_cast<int32>(Tag)];
+}
+
+void FMazeCellIndex::FindNearest(EMazeCellTag Tag, const FVector2D& Location, int32 Count, TArray<int32>& OutCells) const
+{
+	OutCells.Reset();
+	if (!IsBuilt() || Tag >= EMazeCellTag::EMCT_MAX || Count <= 0)
+	{
+		return;
+	}
+	const TArray<int32>& Cells = TaggedCells[static_cast<int32>(Tag)];
+	const TArray<int32>& Starts = BucketStarts[static_cast<int32>(Tag)];
+	Count = FMath::Min(Count, Cells.Num());
+	if (Count == 0)
+	{
+		return;
+	}
+
+	// the block of the closest point inside the grid, that point is never further from a cell than Location itself
+	const int32 CenterX = FMath::Clamp(FMath::FloorToInt32((FMath::Clamp(Location.X, -0.5, Width - 0.5) + 0.5) / BucketSize), 0, NumBucketsX - 1);
+	const int32 CenterY = FMath::Clamp(FMath::FloorToInt32((FMath::Clamp(Location.Y, -0.5, Height - 0.5) + 0.5) / BucketSize), 0, NumBucketsY - 1);
+	const double MinCellSize = FMath::Min(CellSize.X, CellSize.Y);
+
+	// the Count closest cells found so far, the furthest of them on top
+	struct FCandidate
+	{
+		double DistanceSquared;
+		int32 CellIndex;
+	};
+	auto IsFurther = [](const FCandidate& A, const FCandidate& B) { return A.DistanceSquared > B.DistanceSquared; };
+	TArray<FCandidate, TInlineAllocator<64>> Best;
+
+	const int32 MaxRing = FMath::Max(FMath::Max(CenterX, NumBucketsX - 1 - CenterX), FMath::Max(CenterY, NumBucketsY - 1 - CenterY));
+	for (int32 Ring = 0; Ring <= MaxRing; Ring++)
+	{
+		// every cell in this ring is at least this far away, along X or Y
+		const double RingDistance = Ring > 0 ? ((Ring - 1) * BucketSize + 0.5) * MinCellSize : 0.0;
+		if (Best.Num() == Count && RingDistance * RingDistance > Best.HeapTop().DistanceSquared)
+		{
+			break;
+		}
+
+		for (int32 BucketY = FMath::Max(CenterY - Ring, 0); BucketY <= FMath::Min(CenterY + Ring, NumBucketsY - 1); BucketY++)
+		{
+			// inside the ring only its left and right blocks belong to it
+			const bool bEdgeRow = FMath::Abs(BucketY - CenterY) == Ring;
+			const int32 StepX = bEdgeRow || Ring == 0 ? 1 : 2 * Ring;
+			for (int32 BucketX = CenterX - Ring; BucketX <= CenterX + Ring; BucketX += StepX)
+			{
+				if (BucketX < 0 || BucketX >= NumBucketsX)
+				{
+					continue;
+				}
+				const int32 Bucket = GetBucket(BucketX, BucketY);
+				for (int32 i = Starts[Bucket]; i < Starts[Bucket + 1]; i++)
+				{
+					const FCandidate Candidate = {GetDistanceSquared(Cells[i], Location), Cells[i]};
+					if (Best.Num() < Count)
+					{
+						Best.HeapPush(Candidate, IsFurther);
+					}
+					else if (Candidate.DistanceSquared < Best.HeapTop().DistanceSquared)
+					{
+						Best.HeapPopDiscard(IsFurther);
+						Best.HeapPush(Candidate, IsFurther);
+					}
+				}
+			}
+		}
+	}
+
+	Best.Sort([](const FCandidate& A, const FCandidate& B) { return A.DistanceSquared < B.DistanceSquared; });
+	OutCells.Reserve(Best.Num());
+	for (const FCandidate& Candidate : Best)
+	{
+		OutCells.Add(Candidate.CellIndex);
+	}
+}
+
+void FMazeCellIndex::FindWithinSteps(const FMazeGrid& Grid, EMazeCellTag Tag, int32 StartCell, int32 MaxSteps, TArray<int32>& OutCells)
+{
+	OutCells.Reset();
+	if (!IsBuilt() || Grid.Num() != Tags.Num() || !Grid.IsValidIndex(StartCell) || MaxSteps < 0)
+	{
+		return;
+	}
+
+	if (Search.Num() != Tags.Num())
+	{
+		Search.Init(Tags.Num());
+	}
+	Search.BeginSearch();
+
+	Search.MarkReached(StartCell, 0);
+	Search.Queue[0] = StartCell;
+	int32 QueueEnd = 1;
+	for (int32 QueueStart = 0; QueueStart < QueueEnd; QueueStart++)
+	{
+		const int32 Cell = Search.Queue[QueueStart];
+		if (Tags[Cell] == static_cast<uint8>(Tag))
+		{
+			OutCells.Add(Cell);
+		}
+		if (Search.Values[Cell] == MaxSteps)
+		{
+			continue;
+		}
+
+		int32 Neighbors[4];
+		const int32 NumNeighbors = FMazePathfinder::GetOpenNeighbors(Grid, Cell, Neighbors);
+		for (int32 i = 0; i < NumNeighbors; i++)
+		{
+			if (!Search.IsReached(Neighbors[i]))
+			{
+				Search.MarkReached(Neighbors[i], Search.Values[Cell] + 1);
+				Search.Queue[QueueEnd++] = Neighbors[i];
+			}
+		}
+	}
+}
+
+int32 FMazeCellIndex::GetRandomCell(EMazeCellTag Tag, const FVector2D& Location, float Radius, const FRandomStream& RandomStream) const
+{
+	if (!IsBuilt() || Tag >= EMazeCellTag::EMCT_MAX)
+	{
+		return INDEX_NONE;
+	}
+	const TArray<int32>& Cells = TaggedCells[static_cast<int32>(Tag)];
+	const TArray<int32>& Starts = BucketStarts[static_cast<int32>(Tag)];
+
+	// positions in Cells of the excluded cells, blocks are visited in the order they are stored, so these come out sorted
+	TArray<int32, TInlineAllocator<64>> Excluded;
+	if (Radius > 0.f)
+	{
+		const double RadiusSquared = static_cast<double>(Radius) * Radius;
+		const int32 MinBucketX = FMath::Max(FMath::FloorToInt32((Location.X - Radius / CellSize.X + 0.5) / BucketSize), 0);
+		const int32 MaxBucketX = FMath::Min(FMath::FloorToInt32((Location.X + Radius / CellSize.X + 0.5) / BucketSize), NumBucketsX - 1);
+		const int32 MinBucketY = FMath::Max(FMath::FloorToInt32((Location.Y - Radius / CellSize.Y + 0.5) / BucketSize), 0);
+		const int32 MaxBucketY = FMath::Min(FMath::FloorToInt32((Location.Y + Radius / CellSize.Y + 0.5) / BucketSize), NumBucketsY - 1);
+		for (int32 BucketY = MinBucketY; BucketY <= MaxBucketY; BucketY++)
+		{
+			for (int32 BucketX = MinBucketX; BucketX <= MaxBucketX; BucketX++)
+			{
+				const int32 Bucket = GetBucket(BucketX, BucketY);
+				for (int32 i = Starts[Bucket]; i < Starts[Bucket + 1]; i++)
+				{
+					if (GetDistanceSquared(Cells[i], Location) <= RadiusSquared)
+					{
+						Excluded.Add(i);
+					}
+				}
+			}
+		}
+	}
+
+	const int32 NumAllowed = Cells.Num() - Excluded.Num();
+	if (NumAllowed <= 0)
+	{
+		return INDEX_NONE;
+	}
+
+	// pick among the allowed cells only, then skip over the excluded positions in front of the pick
+	int32 Position = RandomStream.RandHelper(NumAllowed);
+	for (int32 ExcludedPosition : Excluded)
+	{
+		if (ExcludedPosition > Position)
+		{
+			break;
+		}
+		Position++;
+	}
+	return Cells[Position];
+}
+
+SIZE_T FMazeCellIndex::GetAllocatedSize() const
+{
+	SIZE_T Size = Tags.GetAllocatedSize() + Search.GetAllocatedSize();
+	for (int32 Tag = 0; Tag < static_cast<int32>(EMazeCellTag::EMCT_MAX); Tag++)
+	{
+		Size += TaggedCells[Tag].GetAllocatedSize() + BucketStarts[Tag].GetAllocatedSize();
+	}
+	return Size;
+}
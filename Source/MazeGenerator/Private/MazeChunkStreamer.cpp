@@ -0,0 +1,246 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeChunkStreamer.h"
+
+#include "MazeBase.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+
+// Sets default values
+AMazeChunkStreamer::AMazeChunkStreamer()
+{
+	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickInterval = 0.1f;
+
+	ChunkWidth = 10;
+	ChunkHeight = 10;
+	Seed = 0;
+	StreamingRadius = 2;
+	UnloadHysteresis = 1;
+	OpeningsPerBorder = 1;
+	MaxChunkLoadsPerTick = 1;
+	bGenerateChunksAsync = true;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Center Comp"));
+}
+
+// Called when the game starts or when spawned
+void AMazeChunkStreamer::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UpdateStreaming();
+}
+
+void AMazeChunkStreamer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UnloadAllChunks();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+FVector AMazeChunkStreamer::GetCellSize() const
+{
+	const AMazeBase* ChunkDefaults = ChunkClass ? ChunkClass->GetDefaultObject<AMazeBase>() : GetDefault<AMazeBase>();
+	if (ChunkDefaults->bUseMeshSizes && ChunkDefaults->FloorMeshSize)
+	{
+		return ChunkDefaults->FloorMeshSize->GetBoundingBox().GetSize();
+	}
+	return ChunkDefaults->FloorSize;
+}
+
+FIntPoint AMazeChunkStreamer::WorldToChunk(const FVector& WorldLocation) const
+{
+	const FVector CellSize = GetCellSize();
+	const double ChunkSizeX = ChunkWidth * CellSize.X;
+	const double ChunkSizeY = ChunkHeight * CellSize.Y;
+	if (ChunkSizeX <= 0 || ChunkSizeY <= 0)
+	{
+		return FIntPoint::ZeroValue;
+	}
+
+	// chunk (0, 0) is centered on the streamer
+	const FVector LocalLocation = GetActorTransform().InverseTransformPosition(WorldLocation);
+	return FIntPoint(
+		FMath::FloorToInt32((LocalLocation.X + ChunkSizeX / 2) / ChunkSizeX),
+		FMath::FloorToInt32((LocalLocation.Y + ChunkSizeY / 2) / ChunkSizeY));
+}
+
+FVector AMazeChunkStreamer::GetChunkLocation(FIntPoint ChunkCoordinates) const
+{
+	const FVector CellSize = GetCellSize();
+	return GetActorTransform().TransformPosition(FVector(
+		ChunkCoordinates.X * ChunkWidth * CellSize.X,
+		ChunkCoordinates.Y * ChunkHeight * CellSize.Y,
+		0));
+}
+
+AMazeBase* AMazeChunkStreamer::GetLoadedChunk(FIntPoint ChunkCoordinates) const
+{
+	const TObjectPtr<AMazeBase>* Chunk = LoadedChunks.Find(ChunkCoordinates);
+	return Chunk ? Chunk->Get() : nullptr;
+}
+
+int32 AMazeChunkStreamer::GetChunkSeed(FIntPoint ChunkCoordinates) const
+{
+	return static_cast<int32>(HashCombine(GetTypeHash(Seed), GetTypeHash(ChunkCoordinates)));
+}
+
+TArray<int32> AMazeChunkStreamer::GetBorderOpenings(FIntPoint ChunkCoordinates, bool bAlongX) const
+{
+	// the border on the +X side runs along the height of the chunk, the border on the +Y side along the width
+	const int32 BorderLength = bAlongX ? ChunkHeight : ChunkWidth;
+	FRandomStream BorderRandomStream(static_cast<int32>(HashCombine(GetChunkSeed(ChunkCoordinates), bAlongX ? 1 : 2)));
+
+	TArray<int32> Openings;
+	for (int32 i = 0; i < FMath::Min(OpeningsPerBorder, BorderLength); i++)
+	{
+		Openings.AddUnique(BorderRandomStream.RandRange(0, BorderLength - 1));
+	}
+	return Openings;
+}
+
+AMazeBase* AMazeChunkStreamer::LoadChunk(FIntPoint ChunkCoordinates)
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	const FTransform ChunkTransform(GetActorRotation(), GetChunkLocation(ChunkCoordinates));
+	UClass* Class = ChunkClass ? ChunkClass.Get() : AMazeBase::StaticClass();
+	AMazeBase* Chunk = World->SpawnActorDeferred<AMazeBase>(Class, ChunkTransform, this);
+	if (!Chunk)
+	{
+		return nullptr;
+	}
+
+	Chunk->MazeWidth = ChunkWidth;
+	Chunk->MazeHeight = ChunkHeight;
+	Chunk->bUseCustomSeed = true;
+	Chunk->SetMazeSeed(GetChunkSeed(ChunkCoordinates));
+	Chunk->bRegenerateMazeInConstructionScript = false;
+
+	// chunks are entered through their borders, so they have no entry or exit of their own
+	Chunk->bHasEntry = false;
+	Chunk->bHasExit = false;
+
+	Chunk->AdditionalOuterWallOpenings.Reset();
+	auto AddOpenings = [Chunk](const TArray<int32>& Positions, EMazeDirection Side)
+	{
+		for (int32 Position : Positions)
+		{
+			FMazeOuterWallOpening Opening;
+			Opening.Side = Side;
+			Opening.Position = Position;
+			Chunk->AdditionalOuterWallOpenings.Add(Opening);
+		}
+	};
+	AddOpenings(GetBorderOpenings(ChunkCoordinates, true), EMazeDirection::EMD_PosX);
+	AddOpenings(GetBorderOpenings(ChunkCoordinates - FIntPoint(1, 0), true), EMazeDirection::EMD_NegX);
+	AddOpenings(GetBorderOpenings(ChunkCoordinates, false), EMazeDirection::EMD_PosY);
+	AddOpenings(GetBorderOpenings(ChunkCoordinates - FIntPoint(0, 1), false), EMazeDirection::EMD_NegY);
+
+	Chunk->FinishSpawning(ChunkTransform);
+	Chunk->AttachToActor(this, FAttachmentTransformRules::KeepWorldTransform);
+
+	if (bGenerateChunksAsync)
+	{
+		Chunk->RegenerateMazeAsync();
+	}
+	else
+	{
+		Chunk->RegenerateMaze();
+	}
+
+	LoadedChunks.Add(ChunkCoordinates, Chunk);
+	return Chunk;
+}
+
+void AMazeChunkStreamer::UnloadChunk(FIntPoint ChunkCoordinates)
+{
+	TObjectPtr<AMazeBase> Chunk;
+	if (!LoadedChunks.RemoveAndCopyValue(ChunkCoordinates, Chunk))
+	{
+		return;
+	}
+
+	if (IsValid(Chunk))
+	{
+		Chunk->CancelAsyncGeneration();
+		Chunk->Destroy();
+	}
+}
+
+void AMazeChunkStreamer::UnloadAllChunks()
+{
+	TArray<FIntPoint> ChunkCoordinates;
+	LoadedChunks.GetKeys(ChunkCoordinates);
+	for (const FIntPoint& Coordinates : ChunkCoordinates)
+	{
+		UnloadChunk(Coordinates);
+	}
+}
+
+void AMazeChunkStreamer::UpdateStreaming()
+{
+	const AActor* Target = TrackedActor ? TrackedActor.Get() : UGameplayStatics::GetPlayerPawn(this, 0);
+	if (!Target)
+	{
+		return;
+	}
+
+	const FIntPoint CenterChunk = WorldToChunk(Target->GetActorLocation());
+
+	// unload chunks that are too far away
+	const int32 UnloadRadius = StreamingRadius + UnloadHysteresis;
+	TArray<FIntPoint> ChunksToUnload;
+	for (const TPair<FIntPoint, TObjectPtr<AMazeBase>>& Pair : LoadedChunks)
+	{
+		const FIntPoint Offset = Pair.Key - CenterChunk;
+		if (!IsValid(Pair.Value) || FMath::Abs(Offset.X) > UnloadRadius || FMath::Abs(Offset.Y) > UnloadRadius)
+		{
+			ChunksToUnload.Add(Pair.Key);
+		}
+	}
+	for (const FIntPoint& Coordinates : ChunksToUnload)
+	{
+		UnloadChunk(Coordinates);
+	}
+
+	// load the missing chunks closest to the tracked actor first
+	TArray<FIntPoint> ChunksToLoad;
+	for (int32 X = -StreamingRadius; X <= StreamingRadius; X++)
+	{
+		for (int32 Y = -StreamingRadius; Y <= StreamingRadius; Y++)
+		{
+			const FIntPoint Coordinates = CenterChunk + FIntPoint(X, Y);
+			if (!LoadedChunks.Contains(Coordinates))
+			{
+				ChunksToLoad.Add(Coordinates);
+			}
+		}
+	}
+
+	ChunksToLoad.Sort([CenterChunk](const FIntPoint& A, const FIntPoint& B)
+	{
+		return (A - CenterChunk).SizeSquared() < (B - CenterChunk).SizeSquared();
+	});
+
+	for (int32 i = 0; i < FMath::Min(ChunksToLoad.Num(), MaxChunkLoadsPerTick); i++)
+	{
+		LoadChunk(ChunksToLoad[i]);
+	}
+}
+
+// Called every frame
+void AMazeChunkStreamer::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UpdateStreaming();
+}
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeEllerGenerator.h"
+
+FMazeEllerGenerator::FMazeEllerGenerator(int32 InWidth, int32 InHeight, int32 Seed)
+	: Width(FMath::Max(InWidth, 0))
+	, Height(FMath::Max(InHeight, 0))
+	, RandomStream(Seed)
+{
+	RowSets.Init(INDEX_NONE, Width);
+	SetParents.SetNumUninitialized(Width * 2);
+	SetCellsLeft.SetNumUninitialized(Width * 2);
+	SetHasOpening.Init(false, Width * 2);
+	SetRemap.SetNumUninitialized(Width * 2);
+	RowCells.SetNumUninitialized(Width);
+}
+
+int32 FMazeEllerGenerator::FindSet(int32 Set)
+{
+	while (SetParents[Set] != Set)
+	{
+		SetParents[Set] = SetParents[SetParents[Set]];
+		Set = SetParents[Set];
+	}
+	return Set;
+}
+
+TConstArrayView<uint8> FMazeEllerGenerator::GenerateNextRow()
+{
+	if (!HasNextRow())
+	{
+		return TConstArrayView<uint8>();
+	}
+
+	const bool bLastRow = NextRow == Height - 1;
+	for (int32 i = 0; i < Width * 2; i++)
+	{
+		SetParents[i] = i;
+	}
+
+	// cells that nothing reached from the row before start in a set of their own
+	for (int32 i = 0; i < Width; i++)
+	{
+		if (RowSets[i] == INDEX_NONE)
+		{
+			RowSets[i] = Width + i;
+		}
+
+		EMazeCellFlags Flags = EMazeCellFlags::Visited;
+		if (i != Width - 1)
+		{
+			Flags |= EMazeCellFlags::WallPosX;
+		}
+		if (!bLastRow)
+		{
+			Flags |= EMazeCellFlags::WallPosY;
+		}
+		RowCells[i] = static_cast<uint8>(Flags);
+	}
+
+	// randomly join neighboring cells of different sets, the last row joins all of them so the maze ends connected
+	for (int32 i = 0; i < Width - 1; i++)
+	{
+		const int32 Set = FindSet(RowSets[i]);
+		const int32 NextSet = FindSet(RowSets[i + 1]);
+		if (Set != NextSet && (bLastRow || RandomStream.RandRange(0, 1) == 0))
+		{
+			RowCells[i] &= ~static_cast<uint8>(EMazeCellFlags::WallPosX);
+			SetParents[FMath::Max(Set, NextSet)] = FMath::Min(Set, NextSet);
+		}
+	}
+
+	if (!bLastRow)
+	{
+		for (int32 i = 0; i < Width; i++)
+		{
+			RowSets[i] = FindSet(RowSets[i]);
+			SetCellsLeft[RowSets[i]] = 0;
+			SetHasOpening[RowSets[i]] = false;
+			SetRemap[RowSets[i]] = INDEX_NONE;
+		}
+		for (int32 i = 0; i < Width; i++)
+		{
+			SetCellsLeft[RowSets[i]]++;
+		}
+
+		// every set needs at least one opening into the next row, the last cell of a set opens if no other cell did
+		int32 NumSets = 0;
+		for (int32 i = 0; i < Width; i++)
+		{
+			const int32 Set = RowSets[i];
+			const bool bLastCellOfSet = --SetCellsLeft[Set] == 0;
+			const bool bOpenDown = RandomStream.RandRange(0, 1) == 0 || (bLastCellOfSet && !SetHasOpening[Set]);
+			if (!bOpenDown)
+			{
+				RowSets[i] = INDEX_NONE;
+				continue;
+			}
+
+			RowCells[i] &= ~static_cast<uint8>(EMazeCellFlags::WallPosY);
+			SetHasOpening[Set] = true;
+
+			// renumber the sets carried into the next row from 0, so they never run into the new sets
+			if (SetRemap[Set] == INDEX_NONE)
+			{
+				SetRemap[Set] = NumSets++;
+			}
+			RowSets[i] = SetRemap[Set];
+		}
+	}
+
+	NextRow++;
+	return RowCells;
+}
+
+bool FMazeEllerGenerator::Generate(FRowConsumer Consumer)
+{
+	while (HasNextRow())
+	{
+		const int32 Y = NextRow;
+		if (!Consumer(Y, GenerateNextRow()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+SIZE_T FMazeEllerGenerator::GetAllocatedSize() const
+{
+	return RowSets.GetAllocatedSize() + SetParents.GetAllocatedSize() + SetCellsLeft.GetAllocatedSize()
+		+ SetHasOpening.GetAllocatedSize() + SetRemap.GetAllocatedSize() + RowCells.GetAllocatedSize();
+}
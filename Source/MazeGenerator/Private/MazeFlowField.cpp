@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeFlowField.h"
+
+#include "MazePathfinder.h"
+
+void FMazeFlowField::Build(const FMazeGrid& Grid, int32 InTargetCell)
+{
+	TargetCell = InTargetCell;
+	Width = Grid.Width;
+	bTree = false;
+	if (!Grid.IsValidIndex(TargetCell))
+	{
+		Reset();
+		return;
+	}
+
+	Directions.Init(static_cast<uint8>(EMazeDirection::EMD_MAX), Grid.Num());
+	Queue.SetNumUninitialized(Grid.Num());
+
+	// the target is marked as reached by pointing it at itself for the search, it stores EMD_MAX afterwards
+	Directions[TargetCell] = 0;
+	Queue[0] = TargetCell;
+	int32 QueueEnd = 1;
+	for (int32 QueueStart = 0; QueueStart < QueueEnd; QueueStart++)
+	{
+		const int32 Cell = Queue[QueueStart];
+		int32 Neighbors[4];
+		const int32 NumNeighbors = FMazePathfinder::GetOpenNeighbors(Grid, Cell, Neighbors);
+		for (int32 i = 0; i < NumNeighbors; i++)
+		{
+			const int32 Neighbor = Neighbors[i];
+			if (Directions[Neighbor] != static_cast<uint8>(EMazeDirection::EMD_MAX))
+			{
+				continue;
+			}
+
+			// the Y neighbors are checked first, with a width of 1 the +X and +Y offsets are the same
+			EMazeDirection Direction;
+			if (Neighbor == Cell + Width)
+			{
+				Direction = EMazeDirection::EMD_NegY;
+			}
+			else if (Neighbor == Cell - Width)
+			{
+				Direction = EMazeDirection::EMD_PosY;
+			}
+			else if (Neighbor == Cell + 1)
+			{
+				Direction = EMazeDirection::EMD_NegX;
+			}
+			else
+			{
+				Direction = EMazeDirection::EMD_PosX;
+			}
+			Directions[Neighbor] = static_cast<uint8>(Direction);
+			Queue[QueueEnd++] = Neighbor;
+		}
+	}
+	Directions[TargetCell] = static_cast<uint8>(EMazeDirection::EMD_MAX);
+	bTree = FMazePathfinder::IsTree(Grid, QueueEnd);
+}
+
+void FMazeFlowField::Retarget(const FMazeGrid& Grid, int32 NewTargetCell)
+{
+	if (NewTargetCell == TargetCell && IsBuilt())
+	{
+		return;
+	}
+	if (!bTree || !IsBuilt() || Directions.Num() != Grid.Num() || !Grid.IsValidIndex(NewTargetCell))
+	{
+		Build(Grid, NewTargetCell);
+		return;
+	}
+
+	// walk from the new target to the old one and turn every step on the way around
+	uint8 TurnedDirection = static_cast<uint8>(EMazeDirection::EMD_MAX);
+	int32 Cell = NewTargetCell;
+	while (Cell != TargetCell)
+	{
+		const EMazeDirection Direction = static_cast<EMazeDirection>(Directions[Cell]);
+		Directions[Cell] = TurnedDirection;
+		TurnedDirection = static_cast<uint8>(FMazeGrid::GetOppositeDirection(Direction));
+		switch (Direction)
+		{
+		case EMazeDirection::EMD_PosX :
+			Cell += 1;
+			break;
+		case EMazeDirection::EMD_PosY :
+			Cell += Width;
+			break;
+		case EMazeDirection::EMD_NegX :
+			Cell -= 1;
+			break;
+		default:
+			Cell -= Width;
+			break;
+		}
+	}
+	Directions[TargetCell] = TurnedDirection;
+	TargetCell = NewTargetCell;
+}
+
+void FMazeFlowField::Reset()
+{
+	Directions.Empty();
+	Queue.Empty();
+	TargetCell = INDEX_NONE;
+	bTree = false;
+}
@@ -0,0 +1,306 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeGrid.h"
+
+void FMazeGrid::Init(int32 InWidth, int32 InHeight)
+{
+	if (InWidth <= 0 || InHeight <= 0)
+	{
+		Empty();
+		return;
+	}
+
+	Width = InWidth;
+	Height = InHeight;
+	Cells.SetNumUninitialized(Width * Height);
+
+	for (int32 j = 0; j < Height; j++)
+	{
+		for (int32 i = 0; i < Width; i++)
+		{
+			EMazeCellFlags Flags = EMazeCellFlags::None;
+			if (i != Width - 1)
+			{
+				Flags |= EMazeCellFlags::WallPosX;
+			}
+			if (j != Height - 1)
+			{
+				Flags |= EMazeCellFlags::WallPosY;
+			}
+			Cells[ToIndex(i, j)] = static_cast<uint8>(Flags);
+		}
+	}
+}
+
+void FMazeGrid::Empty()
+{
+	Width = 0;
+	Height = 0;
+	Cells.Empty();
+}
+
+int32 FMazeGrid::GetNeighbor(int32 Index, EMazeDirection Direction) const
+{
+	const int32 X = Index % Width;
+	const int32 Y = Index / Width;
+
+	switch (Direction)
+	{
+	case EMazeDirection::EMD_PosX :
+		return X + 1 < Width ? Index + 1 : INDEX_NONE;
+	case EMazeDirection::EMD_PosY :
+		return Y + 1 < Height ? Index + Width : INDEX_NONE;
+	case EMazeDirection::EMD_NegX :
+		return X > 0 ? Index - 1 : INDEX_NONE;
+	case EMazeDirection::EMD_NegY :
+		return Y > 0 ? Index - Width : INDEX_NONE;
+	default:
+		return INDEX_NONE;
+	}
+}
+
+bool FMazeGrid::HasWall(int32 Index, EMazeDirection Direction) const
+{
+	const int32 Neighbor = GetNeighbor(Index, Direction);
+	if (Neighbor == INDEX_NONE)
+	{
+		return true;
+	}
+
+	switch (Direction)
+	{
+	case EMazeDirection::EMD_PosX :
+		return HasFlag(Index, EMazeCellFlags::WallPosX);
+	case EMazeDirection::EMD_PosY :
+		return HasFlag(Index, EMazeCellFlags::WallPosY);
+	case EMazeDirection::EMD_NegX :
+		return HasFlag(Neighbor, EMazeCellFlags::WallPosX);
+	case EMazeDirection::EMD_NegY :
+		return HasFlag(Neighbor, EMazeCellFlags::WallPosY);
+	default:
+		return true;
+	}
+}
+
+void FMazeGrid::SetWall(int32 Index, EMazeDirection Direction, bool bHasWall)
+{
+	const int32 Neighbor = GetNeighbor(Index, Direction);
+	if (Neighbor == INDEX_NONE)
+	{
+		return;
+	}
+
+	int32 Owner = Index;
+	EMazeCellFlags Flag = EMazeCellFlags::WallPosX;
+	switch (Direction)
+	{
+	case EMazeDirection::EMD_PosX :
+		break;
+	case EMazeDirection::EMD_PosY :
+		Flag = EMazeCellFlags::WallPosY;
+		break;
+	case EMazeDirection::EMD_NegX :
+		Owner = Neighbor;
+		break;
+	case EMazeDirection::EMD_NegY :
+		Owner = Neighbor;
+		Flag = EMazeCellFlags::WallPosY;
+		break;
+	default:
+		return;
+	}
+
+	if (bHasWall)
+	{
+		SetFlag(Owner, Flag);
+	}
+	else
+	{
+		ClearFlag(Owner, Flag);
+	}
+}
+
+ECellPosition FMazeGrid::GetCellPosition(int32 Index) const
+{
+	const int32 i = Index % Width;
+	const int32 j = Index / Width;
+
+	if (i == 0 && j == 0)
+	{
+		return ECellPosition::ECP_BottomLeftCorner;
+	}
+	if (i == 0 && j == (Height - 1))
+	{
+		return ECellPosition::ECP_BottomRightCorner;
+	}
+	if (i == (Width - 1) && j == 0)
+	{
+		return ECellPosition::ECP_TopLeftCorner;
+	}
+	if (i == (Width - 1) && j == (Height - 1))
+	{
+		return ECellPosition::ECP_TopRightCorner;
+	}
+	if (j == 0)
+	{
+		return ECellPosition::ECP_LeftSide;
+	}
+	if (j == (Height - 1))
+	{
+		return ECellPosition::ECP_RightSide;
+	}
+	if (i == 0)
+	{
+		return ECellPosition::ECP_BottomSide;
+	}
+	if (i == (Width - 1))
+	{
+		return ECellPosition::ECP_TopSide;
+	}
+	return ECellPosition::ECP_Normal;
+}
+
+int32 FMazeGrid::ToEdgeIndex(int32 Index, EMazeDirection Direction) const
+{
+	const int32 Neighbor = GetNeighbor(Index, Direction);
+	if (Neighbor == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+
+	switch (Direction)
+	{
+	case EMazeDirection::EMD_PosX :
+		return Index * 2;
+	case EMazeDirection::EMD_PosY :
+		return Index * 2 + 1;
+	case EMazeDirection::EMD_NegX :
+		return Neighbor * 2;
+	case EMazeDirection::EMD_NegY :
+		return Neighbor * 2 + 1;
+	default:
+		return INDEX_NONE;
+	}
+}
+
+int32 FMazeGrid::ToOuterEdgeIndex(EMazeDirection Side, int32 Position) const
+{
+	switch (Side)
+	{
+	case EMazeDirection::EMD_NegY :
+		return Position >= 0 && Position < Width ? Position : INDEX_NONE;
+	case EMazeDirection::EMD_NegX :
+		return Position >= 0 && Position < Height ? Width + Position : INDEX_NONE;
+	case EMazeDirection::EMD_PosY :
+		return Position >= 0 && Position < Width ? Width + Height + Position : INDEX_NONE;
+	case EMazeDirection::EMD_PosX :
+		return Position >= 0 && Position < Height ? 2 * Width + Height + Position : INDEX_NONE;
+	default:
+		return INDEX_NONE;
+	}
+}
+
+EMazeDirection FMazeGrid::GetOuterEdgeSide(int32 OuterEdgeIndex, int32& OutPosition) const
+{
+	if (OuterEdgeIndex < Width)
+	{
+		OutPosition = OuterEdgeIndex;
+		return EMazeDirection::EMD_NegY;
+	}
+	if (OuterEdgeIndex < Width + Height)
+	{
+		OutPosition = OuterEdgeIndex - Width;
+		return EMazeDirection::EMD_NegX;
+	}
+	if (OuterEdgeIndex < 2 * Width + Height)
+	{
+		OutPosition = OuterEdgeIndex - (Width + Height);
+		return EMazeDirection::EMD_PosY;
+	}
+	OutPosition = OuterEdgeIndex - (2 * Width + Height);
+	return EMazeDirection::EMD_PosX;
+}
+
+int32 FMazeGrid::GetOuterEdgeCell(int32 OuterEdgeIndex) const
+{
+	int32 Position;
+	switch (GetOuterEdgeSide(OuterEdgeIndex, Position))
+	{
+	case EMazeDirection::EMD_NegY :
+		return ToIndex(Position, 0);
+	case EMazeDirection::EMD_NegX :
+		return ToIndex(0, Position);
+	case EMazeDirection::EMD_PosY :
+		return ToIndex(Position, Height - 1);
+	default:
+		return ToIndex(Width - 1, Position);
+	}
+}
+
+bool FMazeGrid::IsCornerTouchingWall(int32 X, int32 Y) const
+{
+	// the corner is the +X +Y corner of cell (X - 1, Y - 1)
+	const int32 BottomLeft = ToIndex(X - 1, Y - 1);
+	return HasFlag(BottomLeft, EMazeCellFlags::Walls)
+		|| HasFlag(ToIndex(X - 1, Y), EMazeCellFlags::WallPosX)
+		|| HasFlag(ToIndex(X, Y - 1), EMazeCellFlags::WallPosY);
+}
+
+EMazeDirection FMazeGrid::GetOppositeDirection(EMazeDirection Direction)
+{
+	switch (Direction)
+	{
+	case EMazeDirection::EMD_PosX :
+		return EMazeDirection::EMD_NegX;
+	case EMazeDirection::EMD_PosY :
+		return EMazeDirection::EMD_NegY;
+	case EMazeDirection::EMD_NegX :
+		return EMazeDirection::EMD_PosX;
+	case EMazeDirection::EMD_NegY :
+		return EMazeDirection::EMD_PosY;
+	default:
+		return Direction;
+	}
+}
+
+FMazeCellSets::FMazeCellSets(int32 NumCells)
+{
+	Parents.SetNumUninitialized(NumCells);
+	for (int32 i = 0; i < NumCells; i++)
+	{
+		Parents[i] = i;
+	}
+}
+
+int32 FMazeCellSets::Find(int32 Index)
+{
+	while (Parents[Index] != Index)
+	{
+		// point every other cell on the way at its grandparent to keep the trees flat
+		Parents[Index] = Parents[Parents[Index]];
+		Index = Parents[Index];
+	}
+	return Index;
+}
+
+bool FMazeCellSets::Union(int32 A, int32 B)
+{
+	A = Find(A);
+	B = Find(B);
+	if (A == B)
+	{
+		return false;
+	}
+
+	// the lower index always stays the root, so the result only depends on the order of the unions
+	if (A < B)
+	{
+		Parents[B] = A;
+	}
+	else
+	{
+		Parents[A] = B;
+	}
+	return true;
+}
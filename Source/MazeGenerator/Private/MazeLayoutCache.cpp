@@ -0,0 +1,177 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeLayoutCache.h"
+
+#include "MazeLayoutFile.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Hash/CityHash.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+static TAutoConsoleVariable<int32> CVarMazeLayoutCacheBudgetMB(
+	TEXT("maze.LayoutCache.BudgetMB"),
+	64,
+	TEXT("Memory in MB the maze layout cache may use before it drops the least recently used layouts."));
+
+namespace MazeLayoutCache
+{
+	// bump this when a generator changes the layout it makes for the same settings, so old files on disk are not used
+	constexpr int32 KeyVersion = 2;
+}
+
+FMazeLayoutCache& FMazeLayoutCache::Get()
+{
+	static FMazeLayoutCache Cache;
+	return Cache;
+}
+
+uint64 FMazeLayoutCache::MakeKey(const FMazeGenerationSettings& Settings)
+{
+	TArray<int32, TInlineAllocator<32>> Values = {
+		MazeLayoutCache::KeyVersion,
+		Settings.MazeWidth,
+		Settings.MazeHeight,
+		Settings.Seed,
+		Settings.MazeAlgorithmStartingCell.X,
+		Settings.MazeAlgorithmStartingCell.Y,
+		static_cast<int32>(Settings.Algorithm),
+		Settings.ParallelTileSize,
+		Settings.bCreateRooms,
+		Settings.NumberOfRooms,
+		Settings.RoomWidth,
+		Settings.RoomHeight,
+		Settings.NumberOfRoomDoors,
+		Settings.bHasEntry,
+		Settings.bCustomEntry,
+		Settings.bRandomEntry,
+		Settings.EntryWallNumber,
+		Settings.EntrySide,
+		Settings.bHasExit,
+		Settings.bCustomExit,
+		Settings.bRandomExit,
+		Settings.ExitWallNumber,
+		Settings.ExitSide,
+		Settings.AdditionalOuterWallOpenings.Num(),
+	};
+	for (const FMazeOuterWallOpening& Opening : Settings.AdditionalOuterWallOpenings)
+	{
+		Values.Add(static_cast<int32>(Opening.Side));
+		Values.Add(Opening.Position);
+	}
+	return CityHash64(reinterpret_cast<const char*>(Values.GetData()), Values.Num() * sizeof(int32));
+}
+
+bool FMazeLayoutCache::Find(const FMazeGenerationSettings& Settings, FMazeLayout& OutLayout, bool bUseDisk)
+{
+	const uint64 Key = MakeKey(Settings);
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (FEntry* Entry = Entries.Find(Key))
+		{
+			Entry->LastUse = ++UseCounter;
+			OutLayout = Entry->Layout;
+			NumHits++;
+			return true;
+		}
+	}
+
+	if (bUseDisk)
+	{
+		const FString Filename = GetCacheFilename(Key);
+		FMazeLayoutFileHeader Header;
+		FMazeLayout Layout;
+		if (IFileManager::Get().FileExists(*Filename) && FMazeLayoutFile::LoadFromFile(Filename, Header, Layout)
+			&& Header.Width == Settings.MazeWidth && Header.Height == Settings.MazeHeight && Header.Seed == Settings.Seed)
+		{
+			FScopeLock ScopeLock(&Lock);
+			AddEntry(Key, Layout);
+			OutLayout = MoveTemp(Layout);
+			NumHits++;
+			return true;
+		}
+	}
+
+	NumMisses++;
+	return false;
+}
+
+void FMazeLayoutCache::Add(const FMazeGenerationSettings& Settings, const FMazeLayout& Layout, bool bUseDisk)
+{
+	const uint64 Key = MakeKey(Settings);
+	{
+		FScopeLock ScopeLock(&Lock);
+		AddEntry(Key, Layout);
+	}
+
+	if (bUseDisk)
+	{
+		FMazeLayoutFileHeader Header;
+		Header.Seed = Settings.Seed;
+		Header.Algorithm = static_cast<uint8>(Settings.Algorithm);
+		FMazeLayoutFile::SaveToFile(GetCacheFilename(Key), Layout, Header);
+	}
+}
+
+void FMazeLayoutCache::Empty()
+{
+	FScopeLock ScopeLock(&Lock);
+	Entries.Empty();
+	UsedBytes = 0;
+}
+
+int64 FMazeLayoutCache::GetUsedBytes() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return UsedBytes;
+}
+
+FString FMazeLayoutCache::GetCacheFilename(uint64 Key)
+{
+	return FPaths::ProjectSavedDir() / TEXT("MazeLayoutCache") / FString::Printf(TEXT("%016llx.mazelayout"), Key);
+}
+
+int64 FMazeLayoutCache::GetLayoutBytes(const FMazeLayout& Layout)
+{
+	return sizeof(FEntry) + Layout.Grid.Cells.GetAllocatedSize() + Layout.RoomMinCells.GetAllocatedSize() + Layout.RoomMaxCells.GetAllocatedSize()
+		+ Layout.DoorwayEdges.GetAllocatedSize() + Layout.DeadEndCells.GetAllocatedSize() + Layout.OpenOuterEdges.GetAllocatedSize();
+}
+
+void FMazeLayoutCache::AddEntry(uint64 Key, const FMazeLayout& Layout)
+{
+	const int64 BudgetBytes = static_cast<int64>(CVarMazeLayoutCacheBudgetMB.GetValueOnAnyThread()) * 1024 * 1024;
+	const int64 Bytes = GetLayoutBytes(Layout);
+	if (Bytes > BudgetBytes)
+	{
+		// a layout that could never fit would only push everything else out
+		return;
+	}
+
+	if (const FEntry* OldEntry = Entries.Find(Key))
+	{
+		UsedBytes -= OldEntry->Bytes;
+	}
+	FEntry& Entry = Entries.Add(Key);
+	Entry.Layout = Layout;
+	Entry.Bytes = Bytes;
+	Entry.LastUse = ++UseCounter;
+	UsedBytes += Bytes;
+
+	// there are only ever a few layouts in the cache, so a scan for the oldest one is cheap enough
+	while (UsedBytes > BudgetBytes)
+	{
+		uint64 OldestKey = Key;
+		uint64 OldestUse = MAX_uint64;
+		for (const TPair<uint64, FEntry>& Pair : Entries)
+		{
+			if (Pair.Value.LastUse < OldestUse)
+			{
+				OldestUse = Pair.Value.LastUse;
+				OldestKey = Pair.Key;
+			}
+		}
+		UsedBytes -= Entries.FindChecked(OldestKey).Bytes;
+		Entries.Remove(OldestKey);
+	}
+}
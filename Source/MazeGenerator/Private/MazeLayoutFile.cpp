@@ -0,0 +1,245 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeLayoutFile.h"
+
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+
+static_assert(sizeof(FMazeLayoutFileHeader) == 120, "FMazeLayoutFileHeader is written as it is, changing it needs a new version");
+
+namespace MazeLayoutFile
+{
+	// size of the version 1 header, every later header starts with it
+	constexpr int32 MinHeaderSize = 116;
+
+	// every bit of EMazeCellFlags gets a plane
+	constexpr uint8 NumFlagPlanes = 4;
+
+	int64 GetListsSize(const FMazeLayoutFileHeader& Header)
+	{
+		return sizeof(int32) * (4 * static_cast<int64>(Header.NumRooms) + Header.NumDoorways + Header.NumDeadEnds + Header.NumOpenOuterEdges);
+	}
+
+	void WriteList(uint8*& Cursor, const TArray<int32>& List)
+	{
+		FMemory::Memcpy(Cursor, List.GetData(), List.Num() * sizeof(int32));
+		Cursor += List.Num() * sizeof(int32);
+	}
+
+	void ReadList(const uint8*& Cursor, int32 Num, TArray<int32>& OutList)
+	{
+		OutList.SetNumUninitialized(Num);
+		FMemory::Memcpy(OutList.GetData(), Cursor, Num * sizeof(int32));
+		Cursor += Num * sizeof(int32);
+	}
+
+	bool IsValidList(const TArray<int32>& List, int32 Num, bool bAllowNone)
+	{
+		for (int32 Index : List)
+		{
+			if ((Index < 0 || Index >= Num) && !(bAllowNone && Index == INDEX_NONE))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool IsValidOuterEdge(const FMazeGrid& Grid, int32 OuterEdgeIndex)
+	{
+		return OuterEdgeIndex == INDEX_NONE || (OuterEdgeIndex >= 0 && OuterEdgeIndex < Grid.NumOuterEdges());
+	}
+
+	// everything after the header is used as indices into the grid, so a file cannot be trusted with any of it
+	bool IsValidLayout(const FMazeLayout& Layout)
+	{
+		const FMazeGrid& Grid = Layout.Grid;
+		for (int32 i = 0; i < Layout.RoomMinCells.Num(); i++)
+		{
+			const FIntPoint& Min = Layout.RoomMinCells[i];
+			const FIntPoint& Max = Layout.RoomMaxCells[i];
+			if (!Grid.IsValidCoordinates(Min) || !Grid.IsValidCoordinates(Max) || Min.X > Max.X || Min.Y > Max.Y)
+			{
+				return false;
+			}
+		}
+		
+		// doors that could not be carved are stored as INDEX_NONE
+		return IsValidList(Layout.DoorwayEdges, Grid.NumEdges(), true)
+			&& IsValidList(Layout.DeadEndCells, Grid.Num(), false)
+			&& IsValidList(Layout.OpenOuterEdges, Grid.NumOuterEdges(), false)
+			&& IsValidOuterEdge(Grid, Layout.EntryOuterEdge)
+			&& IsValidOuterEdge(Grid, Layout.ExitOuterEdge);
+	}
+}
+
+void FMazeLayoutFile::Write(const FMazeLayout& Layout, FMazeLayoutFileHeader Header, TArray<uint8>& OutBytes)
+{
+	const FMazeGrid& Grid = Layout.Grid;
+	Header.Magic = Magic;
+	Header.Version = CurrentVersion;
+	Header.HeaderSize = sizeof(FMazeLayoutFileHeader);
+	Header.Width = Grid.Width;
+	Header.Height = Grid.Height;
+	Header.NumFlagPlanes = MazeLayoutFile::NumFlagPlanes;
+	Header.EntryOuterEdge = Layout.EntryOuterEdge;
+	Header.ExitOuterEdge = Layout.ExitOuterEdge;
+	Header.EntryWallNumber = Layout.EntryWallNumber;
+	Header.ExitWallNumber = Layout.ExitWallNumber;
+	Header.EntryExitRandomSeed = Layout.EntryExitRandomSeed;
+	Header.NumRooms = Layout.RoomMinCells.Num();
+	Header.NumDoorways = Layout.DoorwayEdges.Num();
+	Header.NumDeadEnds = Layout.DeadEndCells.Num();
+	Header.NumOpenOuterEdges = Layout.OpenOuterEdges.Num();
+
+	const int64 PlaneSize = GetPlaneSize(Grid.Num());
+	OutBytes.Reset();
+	OutBytes.SetNumZeroed(static_cast<int32>(Header.HeaderSize + PlaneSize * Header.NumFlagPlanes + MazeLayoutFile::GetListsSize(Header)));
+
+	uint8* Cursor = OutBytes.GetData();
+	FMemory::Memcpy(Cursor, &Header, sizeof(Header));
+	Cursor += Header.HeaderSize;
+
+	for (uint8 Plane = 0; Plane < Header.NumFlagPlanes; Plane++)
+	{
+		for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+		{
+			Cursor[CellIndex >> 3] |= ((Grid.Cells[CellIndex] >> Plane) & 1) << (CellIndex & 7);
+		}
+		Cursor += PlaneSize;
+	}
+
+	// rooms are stored as MinX, MinY, MaxX, MaxY
+	for (int32 i = 0; i < Header.NumRooms; i++)
+	{
+		const int32 Room[4] = { Layout.RoomMinCells[i].X, Layout.RoomMinCells[i].Y, Layout.RoomMaxCells[i].X, Layout.RoomMaxCells[i].Y };
+		FMemory::Memcpy(Cursor, Room, sizeof(Room));
+		Cursor += sizeof(Room);
+	}
+	MazeLayoutFile::WriteList(Cursor, Layout.DoorwayEdges);
+	MazeLayoutFile::WriteList(Cursor, Layout.DeadEndCells);
+	MazeLayoutFile::WriteList(Cursor, Layout.OpenOuterEdges);
+}
+
+bool FMazeLayoutFile::Read(TConstArrayView<uint8> Bytes, FMazeLayoutFileHeader& OutHeader, FMazeLayout& OutLayout)
+{
+	if (Bytes.Num() < MazeLayoutFile::MinHeaderSize)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The maze layout file is smaller than its header"));
+		return false;
+	}
+
+	// older versions have a shorter header, the fields they do not have keep their defaults
+	FMazeLayoutFileHeader Header;
+	FMemory::Memcpy(&Header, Bytes.GetData(), MazeLayoutFile::MinHeaderSize);
+	if (Header.Magic != Magic)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The file is not a maze layout file"));
+		return false;
+	}
+	if (Header.Version > CurrentVersion || Header.HeaderSize < MazeLayoutFile::MinHeaderSize || Bytes.Num() < Header.HeaderSize)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The maze layout file has version %d, only versions up to %d can be read"), Header.Version, CurrentVersion);
+		return false;
+	}
+
+	FMemory::Memcpy(&Header, Bytes.GetData(), FMath::Min<int32>(Header.HeaderSize, sizeof(FMazeLayoutFileHeader)));
+
+	const int64 NumCells = static_cast<int64>(Header.Width) * Header.Height;
+	if (Header.Width <= 0 || Header.Height <= 0 || NumCells > MAX_int32 || Header.NumFlagPlanes > 8
+		|| Header.NumRooms < 0 || Header.NumDoorways < 0 || Header.NumDeadEnds < 0 || Header.NumOpenOuterEdges < 0
+		|| !StaticEnum<EMazeAlgorithm>()->IsValidEnumValue(Header.Algorithm))
+	{
+		UE_LOG(LogTemp, Error, TEXT("The maze layout file has an invalid header"));
+		return false;
+	}
+
+	const int64 PlaneSize = GetPlaneSize(NumCells);
+	if (Bytes.Num() < Header.HeaderSize + PlaneSize * Header.NumFlagPlanes + MazeLayoutFile::GetListsSize(Header))
+	{
+		UE_LOG(LogTemp, Error, TEXT("The maze layout file is cut short"));
+		return false;
+	}
+
+	OutLayout = FMazeLayout();
+	FMazeGrid& Grid = OutLayout.Grid;
+	Grid.Width = Header.Width;
+	Grid.Height = Header.Height;
+	Grid.Cells.SetNumZeroed(static_cast<int32>(NumCells));
+
+	const uint8* Cursor = Bytes.GetData() + Header.HeaderSize;
+	for (uint8 Plane = 0; Plane < Header.NumFlagPlanes; Plane++)
+	{
+		for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+		{
+			Grid.Cells[CellIndex] |= ((Cursor[CellIndex >> 3] >> (CellIndex & 7)) & 1) << Plane;
+		}
+		Cursor += PlaneSize;
+	}
+
+	OutLayout.RoomMinCells.SetNumUninitialized(Header.NumRooms);
+	OutLayout.RoomMaxCells.SetNumUninitialized(Header.NumRooms);
+	for (int32 i = 0; i < Header.NumRooms; i++)
+	{
+		int32 Room[4];
+		FMemory::Memcpy(Room, Cursor, sizeof(Room));
+		Cursor += sizeof(Room);
+		OutLayout.RoomMinCells[i] = FIntPoint(Room[0], Room[1]);
+		OutLayout.RoomMaxCells[i] = FIntPoint(Room[2], Room[3]);
+	}
+	MazeLayoutFile::ReadList(Cursor, Header.NumDoorways, OutLayout.DoorwayEdges);
+	MazeLayoutFile::ReadList(Cursor, Header.NumDeadEnds, OutLayout.DeadEndCells);
+	MazeLayoutFile::ReadList(Cursor, Header.NumOpenOuterEdges, OutLayout.OpenOuterEdges);
+
+	OutLayout.EntryOuterEdge = Header.EntryOuterEdge;
+	OutLayout.ExitOuterEdge = Header.ExitOuterEdge;
+	OutLayout.EntryWallNumber = Header.EntryWallNumber;
+	OutLayout.ExitWallNumber = Header.ExitWallNumber;
+	OutLayout.EntryExitRandomSeed = Header.EntryExitRandomSeed;
+	if (!MazeLayoutFile::IsValidLayout(OutLayout))
+	{
+		UE_LOG(LogTemp, Error, TEXT("The maze layout file has rooms, cells or edges outside of its grid"));
+		OutLayout = FMazeLayout();
+		return false;
+	}
+	
+	OutHeader = Header;
+	return true;
+}
+
+bool FMazeLayoutFile::SaveToFile(const FString& Filename, const FMazeLayout& Layout, const FMazeLayoutFileHeader& Header)
+{
+	TArray<uint8> Bytes;
+	Write(Layout, Header, Bytes);
+	if (!FFileHelper::SaveArrayToFile(Bytes, *Filename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not write the maze layout file %s"), *Filename);
+		return false;
+	}
+	return true;
+}
+
+bool FMazeLayoutFile::LoadFromFile(const FString& Filename, FMazeLayoutFileHeader& OutHeader, FMazeLayout& OutLayout)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*Filename));
+	if (MappedFile && MappedFile->GetFileSize() <= MAX_int32)
+	{
+		// the region has to go before the handle, so it is declared after it
+		TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+		if (MappedRegion)
+		{
+			return Read(TConstArrayView<uint8>(MappedRegion->GetMappedPtr(), static_cast<int32>(MappedRegion->GetMappedSize())), OutHeader, OutLayout);
+		}
+	}
+
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Filename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not read the maze layout file %s"), *Filename);
+		return false;
+	}
+	return Read(Bytes, OutHeader, OutLayout);
+}
@@ -0,0 +1,1090 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeLayoutGenerator.h"
+
+#include "MazeEllerGenerator.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Rooms"), STAT_MazeRooms, STATGROUP_Maze);
+DECLARE_CYCLE_STAT(TEXT("Maze Algorithm"), STAT_MazeAlgorithm, STATGROUP_Maze);
+DECLARE_CYCLE_STAT(TEXT("Entry and Exit"), STAT_MazeEntryExit, STATGROUP_Maze);
+
+FMazeLayoutGenerator::FMazeLayoutGenerator(const FMazeGenerationSettings& InSettings)
+	: Settings(InSettings)
+{
+	MazeRandomStream.Initialize(Settings.Seed);
+	RoomRandomStream.Initialize(Settings.Seed);
+}
+
+bool FMazeLayoutGenerator::Generate(FMazeLayout& OutLayout, const std::atomic<bool>* InCancelFlag)
+{
+	CancelFlag = InCancelFlag;
+	OutLayout = FMazeLayout();
+	OutLayout.Grid.Init(Settings.MazeWidth, Settings.MazeHeight);
+
+	Stats = FMazeGenerationStats();
+
+	double StageStartTime = FPlatformTime::Seconds();
+	{
+		MAZE_SCOPE_CYCLE_COUNTER(STAT_MazeRooms);
+		GenerateRooms(OutLayout);
+	}
+	Stats.RoomsMs = (FPlatformTime::Seconds() - StageStartTime) * 1000.0;
+	if (IsCancelled())
+	{
+		return false;
+	}
+
+	StageStartTime = FPlatformTime::Seconds();
+	{
+		MAZE_SCOPE_CYCLE_COUNTER(STAT_MazeAlgorithm);
+		ImplementMazeAlgorithm(OutLayout);
+	}
+	Stats.AlgorithmMs = (FPlatformTime::Seconds() - StageStartTime) * 1000.0;
+	if (IsCancelled())
+	{
+		return false;
+	}
+
+	StageStartTime = FPlatformTime::Seconds();
+	{
+		MAZE_SCOPE_CYCLE_COUNTER(STAT_MazeEntryExit);
+		OutLayout.EntryExitRandomSeed = MazeRandomStream.GetCurrentSeed();
+		CarveEntryAndExit(OutLayout);
+		CarveAdditionalOpenings(OutLayout);
+	}
+	Stats.EntryExitMs = (FPlatformTime::Seconds() - StageStartTime) * 1000.0;
+	if (IsCancelled())
+	{
+		return false;
+	}
+
+	CountLayoutStats(OutLayout);
+	Stats.ScratchBytes = PeakScratchBytes;
+	return true;
+}
+
+void FMazeLayoutGenerator::CountLayoutStats(const FMazeLayout& Layout)
+{
+	const FMazeGrid& Grid = Layout.Grid;
+	int32 InnerWalls = 0;
+	int32 CellsVisited = 0;
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		InnerWalls += Grid.HasFlag(CellIndex, EMazeCellFlags::WallPosX) + Grid.HasFlag(CellIndex, EMazeCellFlags::WallPosY);
+		CellsVisited += IsInMaze(Grid, CellIndex);
+	}
+
+	// a new grid has every inner wall
+	const int32 InitialInnerWalls = (Grid.Width - 1) * Grid.Height + Grid.Width * (Grid.Height - 1);
+	const int32 OpenOuterWalls = (Layout.EntryOuterEdge != INDEX_NONE) + (Layout.ExitOuterEdge != INDEX_NONE) + Layout.OpenOuterEdges.Num();
+	Stats.WallsCarved = InitialInnerWalls - InnerWalls + OpenOuterWalls;
+	Stats.CellsVisited = CellsVisited;
+}
+
+void FMazeLayoutGenerator::RecarveEntryAndExit(FMazeLayout& Layout)
+{
+	// the entry and exit stages only read the size of the grid, so starting the stream where Generate left it gives the same result
+	MazeRandomStream.Initialize(Layout.EntryExitRandomSeed);
+	Layout.EntryOuterEdge = INDEX_NONE;
+	Layout.ExitOuterEdge = INDEX_NONE;
+	Layout.EntryWallNumber = 0;
+	Layout.ExitWallNumber = 0;
+	Layout.OpenOuterEdges.Reset();
+
+	CarveEntryAndExit(Layout);
+	CarveAdditionalOpenings(Layout);
+}
+
+void FMazeLayoutGenerator::GenerateRooms(FMazeLayout& Layout)
+{
+	if (!Settings.bCreateRooms || Settings.NumberOfRooms <= 0)
+	{
+		return;
+	}
+
+	const int32 MazeWidth = Settings.MazeWidth;
+	const int32 MazeHeight = Settings.MazeHeight;
+	const int32 RoomWidth = Settings.RoomWidth;
+	const int32 RoomHeight = Settings.RoomHeight;
+
+	if (RoomHeight >= MazeHeight || RoomWidth >= MazeWidth)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Room height or room width is too large."));
+		return;
+	}
+
+	FMazeGrid& MazeGrid = Layout.Grid;
+	int32 XRandMin = 1;
+	int32 YRandMin = 1;
+	int32 XRandMax = (MazeWidth - 1) - RoomWidth;
+	int32 YRandMax = (MazeHeight - 1) - RoomHeight;
+
+	for (int32 i = 0; i < Settings.NumberOfRooms; i++)
+	{
+		bool bRoomsSpawned = false;
+		int32 LoopCounter = 0; // keeps track of times around loop, will cancel at 20
+
+		LOOP: while (!bRoomsSpawned)
+		{
+			LoopCounter++;
+
+			int32 RoomRandY = RoomRandomStream.RandRange(YRandMin, YRandMax);
+			int32 RoomRandX = RoomRandomStream.RandRange(XRandMin, XRandMax);
+			FIntPoint CellCoord(RoomRandX, RoomRandY);
+
+			if(((Settings.NumberOfRooms * RoomWidth * RoomHeight) > ((MazeHeight * MazeWidth) - (2 * (MazeHeight - 1) + 2 * (MazeWidth - 1)))) || (LoopCounter > 20))
+			{
+				bRoomsSpawned = true;
+			}
+
+			if (MazeGrid.IsValidCoordinates(CellCoord))
+			{
+				TArray<int32> RoomCells;
+
+				for (int32 j = CellCoord.X; j < CellCoord.X + RoomWidth; j++)
+				{
+					for (int32 k = CellCoord.Y; k < CellCoord.Y + RoomHeight; k++)
+					{
+						if (MazeGrid.IsValidCoordinates(j, k))
+						{
+							const int32 CellIndex = MazeGrid.ToIndex(j, k);
+							// if any of the cells found have been visited before, start process over
+							if (MazeGrid.HasFlag(CellIndex, EMazeCellFlags::Visited))
+							{
+								goto LOOP; // start while loop again
+							}
+							RoomCells.Add(CellIndex);
+						}
+					}
+				}
+
+				const FIntPoint RoomMin = MazeGrid.ToCoordinates(RoomCells[0]);
+				const FIntPoint RoomMax = MazeGrid.ToCoordinates(RoomCells[RoomCells.Num() - 1]);
+
+				// Mark room cells as visited and open the walls inside of the room
+				for (int32 CellIndex : RoomCells)
+				{
+					MazeGrid.SetFlag(CellIndex, EMazeCellFlags::Visited | EMazeCellFlags::Room);
+
+					const FIntPoint Cell = MazeGrid.ToCoordinates(CellIndex);
+					if (Cell.X < RoomMax.X)
+					{
+						MazeGrid.SetWall(CellIndex, EMazeDirection::EMD_PosX, false);
+					}
+					if (Cell.Y < RoomMax.Y)
+					{
+						MazeGrid.SetWall(CellIndex, EMazeDirection::EMD_PosY, false);
+					}
+				}
+
+				// carve room doors
+				for (int32 RoomDoorCounter = 0; RoomDoorCounter < Settings.NumberOfRoomDoors; RoomDoorCounter++)
+				{
+					int32 RandPosX = RoomRandomStream.RandRange(0,RoomWidth - 1);
+					int32 RandPosY = RoomRandomStream.RandRange(0,RoomHeight - 1);
+					int32 RandSide = RoomRandomStream.RandRange(0,3);
+
+					// the doorway is the wall between a cell on the room edge and the cell outside of it
+					FIntPoint InsideCell;
+					EMazeDirection DoorDirection;
+					if (RandSide == 0)
+					{
+						InsideCell = FIntPoint(RoomMin.X, RoomMin.Y + RandPosY);
+						DoorDirection = EMazeDirection::EMD_NegX;
+					}
+					else if (RandSide == 1)
+					{
+						InsideCell = FIntPoint(RoomMax.X, RoomMin.Y + RandPosY);
+						DoorDirection = EMazeDirection::EMD_PosX;
+					}
+					else if (RandSide == 2)
+					{
+						InsideCell = FIntPoint(RoomMin.X + RandPosX, RoomMin.Y);
+						DoorDirection = EMazeDirection::EMD_NegY;
+					}
+					else
+					{
+						InsideCell = FIntPoint(RoomMin.X + RandPosX, RoomMax.Y);
+						DoorDirection = EMazeDirection::EMD_PosY;
+					}
+
+					int32 DoorwayEdge = INDEX_NONE;
+					if (MazeGrid.IsValidCoordinates(InsideCell))
+					{
+						const int32 InsideIndex = MazeGrid.ToIndex(InsideCell);
+						DoorwayEdge = MazeGrid.ToEdgeIndex(InsideIndex, DoorDirection);
+						MazeGrid.SetWall(InsideIndex, DoorDirection, false);
+					}
+					Layout.DoorwayEdges.Add(DoorwayEdge);
+				}
+
+				Layout.RoomMinCells.Add(RoomMin);
+				Layout.RoomMaxCells.Add(RoomMax);
+				bRoomsSpawned = true;
+			}
+		}
+		Stats.RoomPlacementRetries += LoopCounter - 1;
+	}
+}
+
+void FMazeLayoutGenerator::ImplementMazeAlgorithm(FMazeLayout& Layout)
+{
+	FMazeGrid& MazeGrid = Layout.Grid;
+
+	FIntPoint StartingCell; // cell used to start the algorithm
+	if (MazeGrid.IsValidCoordinates(Settings.MazeAlgorithmStartingCell) && !MazeGrid.HasFlag(MazeGrid.ToIndex(Settings.MazeAlgorithmStartingCell), EMazeCellFlags::Visited))
+	{
+		StartingCell = Settings.MazeAlgorithmStartingCell;
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Maze Algorithm Starting Point is out of bounds, changing to (0, 0)"));
+		StartingCell = FIntPoint(0,0);
+	}
+
+	Layout.DeadEndCells.Empty();
+	if (!MazeGrid.IsValidCoordinates(StartingCell))
+	{
+		return;
+	}
+
+	const int32 StartIndex = MazeGrid.ToIndex(StartingCell);
+	switch (Settings.Algorithm)
+	{
+	case EMazeAlgorithm::EMA_Prim :
+		RunPrim(MazeGrid, StartIndex);
+		break;
+	case EMazeAlgorithm::EMA_Kruskal :
+		RunKruskal(MazeGrid);
+		break;
+	case EMazeAlgorithm::EMA_Wilson :
+		RunWilson(MazeGrid, StartIndex);
+		break;
+	case EMazeAlgorithm::EMA_Sidewinder :
+		RunSidewinder(MazeGrid);
+		break;
+	case EMazeAlgorithm::EMA_BinaryTree :
+		RunBinaryTree(MazeGrid);
+		break;
+	case EMazeAlgorithm::EMA_Eller :
+		RunEller(MazeGrid);
+		break;
+	case EMazeAlgorithm::EMA_ParallelTiles :
+		RunParallelTiles(MazeGrid);
+		break;
+	default:
+		// the backtracker finds its dead ends while it walks
+		RunBacktracker(Layout, StartIndex);
+		return;
+	}
+
+	if (IsCancelled())
+	{
+		return;
+	}
+
+	// the other algorithms do not walk around rooms, so join whatever parts they left apart
+	ConnectRegions(MazeGrid);
+	FindDeadEnds(Layout);
+}
+
+void FMazeLayoutGenerator::RunBacktracker(FMazeLayout& Layout, int32 StartIndex)
+{
+	FMazeGrid& MazeGrid = Layout.Grid;
+	const int32 Width = MazeGrid.Width;
+	const int32 NumCells = MazeGrid.Num();
+
+	// everything the walk needs is allocated here, the loop below does not allocate
+	// a cell is pushed only once, when it is visited, so the stack never holds more than every cell
+	TArray<int32> CellStack;
+	CellStack.SetNumUninitialized(NumCells);
+	TArray<uint8> NeighborMasks;
+	BuildNeighborMasks(MazeGrid, NeighborMasks);
+	// a dead end is recorded right after a push, so there are never more of them than cells
+	Layout.DeadEndCells.Reserve(NumCells);
+
+	// the original walk checked this cell in a different order, keep it so every seed keeps its layout
+	const int32 TopLeftCorner = Width > 1 ? Width - 1 : INDEX_NONE;
+	const int32 NeighborOffsets[4] = { 1, Width, -1, -Width }; // +X, +Y, -X, -Y, the order of EMazeDirection
+
+	int32 StackSize = 0;
+	CellStack[StackSize++] = StartIndex;
+	MazeGrid.SetFlag(StartIndex, EMazeCellFlags::Visited);
+
+	bool bEndCounter = false; // used to find all of the dead ends
+	int32 StepCounter = 0;
+	uint8 UnvisitedDirections[4];
+
+	while (StackSize > 0)
+	{
+		// only check for cancellation every so often, this loop runs a few times per cell
+		if ((++StepCounter & 4095) == 0 && IsCancelled())
+		{
+			return;
+		}
+
+		const int32 CurrentCell = CellStack[StackSize - 1];
+		const uint8 Mask = NeighborMasks[CurrentCell];
+		int32 NumUnvisited = 0;
+
+		if (CurrentCell == TopLeftCorner)
+		{
+			for (const uint8 Direction : { static_cast<uint8>(EMazeDirection::EMD_NegX), static_cast<uint8>(EMazeDirection::EMD_PosY) })
+			{
+				if ((Mask & (1 << Direction)) && !MazeGrid.HasFlag(CurrentCell + NeighborOffsets[Direction], EMazeCellFlags::Visited))
+				{
+					UnvisitedDirections[NumUnvisited++] = Direction;
+				}
+			}
+		}
+		else
+		{
+			for (uint8 Direction = 0; Direction < 4; Direction++)
+			{
+				if ((Mask & (1 << Direction)) && !MazeGrid.HasFlag(CurrentCell + NeighborOffsets[Direction], EMazeCellFlags::Visited))
+				{
+					UnvisitedDirections[NumUnvisited++] = Direction;
+				}
+			}
+		}
+
+		if (NumUnvisited > 0)
+		{
+			bEndCounter = false;
+			const uint8 Direction = UnvisitedDirections[MazeRandomStream.RandRange(0, NumUnvisited - 1)];
+			const int32 NextCell = CurrentCell + NeighborOffsets[Direction];
+
+			// open the wall between the two cells, the wall belongs to the cell on the -X or -Y side
+			switch (static_cast<EMazeDirection>(Direction))
+			{
+			case EMazeDirection::EMD_PosX :
+				MazeGrid.ClearFlag(CurrentCell, EMazeCellFlags::WallPosX);
+				break;
+			case EMazeDirection::EMD_PosY :
+				MazeGrid.ClearFlag(CurrentCell, EMazeCellFlags::WallPosY);
+				break;
+			case EMazeDirection::EMD_NegX :
+				MazeGrid.ClearFlag(NextCell, EMazeCellFlags::WallPosX);
+				break;
+			default:
+				MazeGrid.ClearFlag(NextCell, EMazeCellFlags::WallPosY);
+				break;
+			}
+
+			MazeGrid.SetFlag(NextCell, EMazeCellFlags::Visited);
+			CellStack[StackSize++] = NextCell;
+		}
+		else
+		{
+			if (!bEndCounter)
+			{
+				Layout.DeadEndCells.Add(CurrentCell);
+				bEndCounter = true;
+			}
+			StackSize--;
+		}
+	}
+
+	// the reserve above is only an upper bound, the layout keeps the dead ends around
+	TrackScratchBytes(CellStack.GetAllocatedSize() + NeighborMasks.GetAllocatedSize() + Layout.DeadEndCells.GetAllocatedSize());
+	Layout.DeadEndCells.Shrink();
+}
+
+void FMazeLayoutGenerator::BuildNeighborMasks(const FMazeGrid& Grid, TArray<uint8>& OutMasks)
+{
+	OutMasks.SetNumUninitialized(Grid.Num());
+
+	// bit N is set if the cell has a neighbor in EMazeDirection N
+	for (int32 Y = 0; Y < Grid.Height; Y++)
+	{
+		const uint8 RowMask = (Y + 1 < Grid.Height ? 1 << static_cast<uint8>(EMazeDirection::EMD_PosY) : 0)
+			| (Y > 0 ? 1 << static_cast<uint8>(EMazeDirection::EMD_NegY) : 0);
+		for (int32 X = 0; X < Grid.Width; X++)
+		{
+			OutMasks[Grid.ToIndex(X, Y)] = RowMask
+				| (X + 1 < Grid.Width ? 1 << static_cast<uint8>(EMazeDirection::EMD_PosX) : 0)
+				| (X > 0 ? 1 << static_cast<uint8>(EMazeDirection::EMD_NegX) : 0);
+		}
+	}
+}
+
+bool FMazeLayoutGenerator::IsOpenCell(const FMazeGrid& Grid, int32 CellIndex)
+{
+	return CellIndex != INDEX_NONE && !Grid.HasFlag(CellIndex, EMazeCellFlags::Room);
+}
+
+bool FMazeLayoutGenerator::IsInMaze(const FMazeGrid& Grid, int32 CellIndex)
+{
+	return Grid.HasFlag(CellIndex, EMazeCellFlags::Visited) && !Grid.HasFlag(CellIndex, EMazeCellFlags::Room);
+}
+
+int32 FMazeLayoutGenerator::FindOpenStart(const FMazeGrid& Grid, int32 StartIndex)
+{
+	if (IsOpenCell(Grid, StartIndex))
+	{
+		return StartIndex;
+	}
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		if (IsOpenCell(Grid, CellIndex))
+		{
+			return CellIndex;
+		}
+	}
+	return INDEX_NONE;
+}
+
+void FMazeLayoutGenerator::RunPrim(FMazeGrid& Grid, int32 StartIndex)
+{
+	StartIndex = FindOpenStart(Grid, StartIndex);
+	if (StartIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	TArray<int32> Frontier;
+	TBitArray<> InFrontier(false, Grid.Num());
+	int32 PeakFrontier = 0;
+
+	auto AddFrontier = [&Grid, &Frontier, &InFrontier](int32 CellIndex)
+	{
+		for (int32 Direction = 0; Direction < static_cast<int32>(EMazeDirection::EMD_MAX); Direction++)
+		{
+			const int32 Neighbor = Grid.GetNeighbor(CellIndex, static_cast<EMazeDirection>(Direction));
+			if (Neighbor != INDEX_NONE && !Grid.HasFlag(Neighbor, EMazeCellFlags::Visited) && !InFrontier[Neighbor])
+			{
+				InFrontier[Neighbor] = true;
+				Frontier.Add(Neighbor);
+			}
+		}
+	};
+
+	Grid.SetFlag(StartIndex, EMazeCellFlags::Visited);
+	AddFrontier(StartIndex);
+
+	int32 StepCounter = 0;
+	EMazeDirection InMazeDirections[4];
+	while (Frontier.Num() > 0)
+	{
+		if ((++StepCounter & 4095) == 0 && IsCancelled())
+		{
+			return;
+		}
+		PeakFrontier = FMath::Max(PeakFrontier, Frontier.Num());
+
+		const int32 FrontierIndex = MazeRandomStream.RandRange(0, Frontier.Num() - 1);
+		const int32 CellIndex = Frontier[FrontierIndex];
+		Frontier.RemoveAtSwap(FrontierIndex);
+
+		// connect the cell to a random neighbor that is already part of the maze
+		int32 NumInMaze = 0;
+		for (int32 Direction = 0; Direction < static_cast<int32>(EMazeDirection::EMD_MAX); Direction++)
+		{
+			const int32 Neighbor = Grid.GetNeighbor(CellIndex, static_cast<EMazeDirection>(Direction));
+			if (Neighbor != INDEX_NONE && IsInMaze(Grid, Neighbor))
+			{
+				InMazeDirections[NumInMaze++] = static_cast<EMazeDirection>(Direction);
+			}
+		}
+		if (NumInMaze > 0)
+		{
+			Grid.SetWall(CellIndex, InMazeDirections[MazeRandomStream.RandRange(0, NumInMaze - 1)], false);
+		}
+
+		Grid.SetFlag(CellIndex, EMazeCellFlags::Visited);
+		AddFrontier(CellIndex);
+	}
+
+	TrackScratchBytes(PeakFrontier * sizeof(int32) + InFrontier.GetAllocatedSize());
+}
+
+void FMazeLayoutGenerator::RunKruskal(FMazeGrid& Grid)
+{
+	// every inner edge between two open cells, in a random order
+	TArray<int32> Edges;
+	Edges.Reserve(Grid.NumEdges());
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		if (!IsOpenCell(Grid, CellIndex))
+		{
+			continue;
+		}
+		Grid.SetFlag(CellIndex, EMazeCellFlags::Visited);
+		
+		if (IsOpenCell(Grid, Grid.GetNeighbor(CellIndex, EMazeDirection::EMD_PosX)))
+		{
+			Edges.Add(CellIndex * 2);
+		}
+		if (IsOpenCell(Grid, Grid.GetNeighbor(CellIndex, EMazeDirection::EMD_PosY)))
+		{
+			Edges.Add(CellIndex * 2 + 1);
+		}
+	}
+	
+	for (int32 i = Edges.Num() - 1; i > 0; i--)
+	{
+		Edges.Swap(i, MazeRandomStream.RandRange(0, i));
+	}
+
+	FMazeCellSets Sets(Grid.Num());
+	for (int32 i = 0; i < Edges.Num(); i++)
+	{
+		if ((i & 4095) == 0 && IsCancelled())
+		{
+			return;
+		}
+
+		const int32 CellIndex = Edges[i] / 2;
+		const EMazeDirection Direction = Edges[i] % 2 == 0 ? EMazeDirection::EMD_PosX : EMazeDirection::EMD_PosY;
+		if (Sets.Union(CellIndex, Grid.GetNeighbor(CellIndex, Direction)))
+		{
+			Grid.SetWall(CellIndex, Direction, false);
+		}
+	}
+
+	TrackScratchBytes(Edges.GetAllocatedSize() + Sets.GetAllocatedSize());
+}
+
+void FMazeLayoutGenerator::RunWilson(FMazeGrid& Grid, int32 StartIndex)
+{
+	StartIndex = FindOpenStart(Grid, StartIndex);
+	if (StartIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// rooms can cut the open cells into regions a random walk can not leave, so every region gets its own root
+	FMazeCellSets Regions(Grid.Num());
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		if (!IsOpenCell(Grid, CellIndex))
+		{
+			continue;
+		}
+		if (IsOpenCell(Grid, Grid.GetNeighbor(CellIndex, EMazeDirection::EMD_PosX)))
+		{
+			Regions.Union(CellIndex, CellIndex + 1);
+		}
+		if (IsOpenCell(Grid, Grid.GetNeighbor(CellIndex, EMazeDirection::EMD_PosY)))
+		{
+			Regions.Union(CellIndex, CellIndex + Grid.Width);
+		}
+	}
+
+	TBitArray<> RegionHasRoot(false, Grid.Num());
+	Grid.SetFlag(StartIndex, EMazeCellFlags::Visited);
+	RegionHasRoot[Regions.Find(StartIndex)] = true;
+
+	// direction the walk last left each cell in, erasing loops for free
+	TArray<uint8> WalkDirections;
+	WalkDirections.SetNumZeroed(Grid.Num());
+	
+	EMazeDirection OpenDirections[4];
+	int32 StepCounter = 0;
+	for (int32 WalkStart = 0; WalkStart < Grid.Num(); WalkStart++)
+	{
+		if (!IsOpenCell(Grid, WalkStart) || Grid.HasFlag(WalkStart, EMazeCellFlags::Visited))
+		{
+			continue;
+		}
+
+		const int32 Region = Regions.Find(WalkStart);
+		if (!RegionHasRoot[Region])
+		{
+			RegionHasRoot[Region] = true;
+			Grid.SetFlag(WalkStart, EMazeCellFlags::Visited);
+			continue;
+		}
+
+		// random walk until the maze is hit
+		int32 CellIndex = WalkStart;
+		while (!Grid.HasFlag(CellIndex, EMazeCellFlags::Visited))
+		{
+			if ((++StepCounter & 4095) == 0 && IsCancelled())
+			{
+				return;
+			}
+
+			int32 NumOpen = 0;
+			for (int32 Direction = 0; Direction < static_cast<int32>(EMazeDirection::EMD_MAX); Direction++)
+			{
+				if (IsOpenCell(Grid, Grid.GetNeighbor(CellIndex, static_cast<EMazeDirection>(Direction))))
+				{
+					OpenDirections[NumOpen++] = static_cast<EMazeDirection>(Direction);
+				}
+			}
+			const EMazeDirection Direction = OpenDirections[MazeRandomStream.RandRange(0, NumOpen - 1)];
+			WalkDirections[CellIndex] = static_cast<uint8>(Direction);
+			CellIndex = Grid.GetNeighbor(CellIndex, Direction);
+		}
+
+		// add the loop erased walk to the maze
+		CellIndex = WalkStart;
+		while (!Grid.HasFlag(CellIndex, EMazeCellFlags::Visited))
+		{
+			const EMazeDirection Direction = static_cast<EMazeDirection>(WalkDirections[CellIndex]);
+			Grid.SetFlag(CellIndex, EMazeCellFlags::Visited);
+			Grid.SetWall(CellIndex, Direction, false);
+			CellIndex = Grid.GetNeighbor(CellIndex, Direction);
+		}
+	}
+
+	TrackScratchBytes(Regions.GetAllocatedSize() + RegionHasRoot.GetAllocatedSize() + WalkDirections.GetAllocatedSize());
+}
+
+void FMazeLayoutGenerator::RunSidewinder(FMazeGrid& Grid)
+{
+	for (int32 j = 0; j < Grid.Height; j++)
+	{
+		if (IsCancelled())
+		{
+			return;
+		}
+
+		// a run is a line of cells along X joined together, closing it opens one +Y wall somewhere in the run
+		int32 RunStart = INDEX_NONE;
+		for (int32 i = 0; i < Grid.Width; i++)
+		{
+			const int32 CellIndex = Grid.ToIndex(i, j);
+			if (!IsOpenCell(Grid, CellIndex))
+			{
+				RunStart = INDEX_NONE;
+				continue;
+			}
+			Grid.SetFlag(CellIndex, EMazeCellFlags::Visited);
+			
+			if (RunStart == INDEX_NONE)
+			{
+				RunStart = i;
+			}
+
+			const bool bCanCarveX = IsOpenCell(Grid, Grid.GetNeighbor(CellIndex, EMazeDirection::EMD_PosX));
+			const bool bLastRow = j == Grid.Height - 1;
+			const bool bCloseRun = !bCanCarveX || (!bLastRow && MazeRandomStream.RandRange(0, 1) == 0);
+			
+			if (!bCloseRun)
+			{
+				Grid.SetWall(CellIndex, EMazeDirection::EMD_PosX, false);
+				continue;
+			}
+
+			if (!bLastRow)
+			{
+				const int32 RunCell = Grid.ToIndex(MazeRandomStream.RandRange(RunStart, i), j);
+				if (IsOpenCell(Grid, Grid.GetNeighbor(RunCell, EMazeDirection::EMD_PosY)))
+				{
+					Grid.SetWall(RunCell, EMazeDirection::EMD_PosY, false);
+				}
+			}
+			RunStart = INDEX_NONE;
+		}
+	}
+}
+
+void FMazeLayoutGenerator::RunBinaryTree(FMazeGrid& Grid)
+{
+	EMazeDirection OpenDirections[2];
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		if ((CellIndex & 4095) == 0 && IsCancelled())
+		{
+			return;
+		}
+		if (!IsOpenCell(Grid, CellIndex))
+		{
+			continue;
+		}
+		Grid.SetFlag(CellIndex, EMazeCellFlags::Visited);
+
+		int32 NumOpen = 0;
+		if (IsOpenCell(Grid, Grid.GetNeighbor(CellIndex, EMazeDirection::EMD_PosX)))
+		{
+			OpenDirections[NumOpen++] = EMazeDirection::EMD_PosX;
+		}
+		if (IsOpenCell(Grid, Grid.GetNeighbor(CellIndex, EMazeDirection::EMD_PosY)))
+		{
+			OpenDirections[NumOpen++] = EMazeDirection::EMD_PosY;
+		}
+		if (NumOpen > 0)
+		{
+			Grid.SetWall(CellIndex, OpenDirections[MazeRandomStream.RandRange(0, NumOpen - 1)], false);
+		}
+	}
+}
+
+void FMazeLayoutGenerator::RunEller(FMazeGrid& Grid)
+{
+	FMazeEllerGenerator Eller(Grid.Width, Grid.Height, static_cast<int32>(MazeRandomStream.GetCurrentSeed()));
+	Eller.Generate([this, &Grid](int32 Y, TConstArrayView<uint8> RowCells)
+	{
+		for (int32 X = 0; X < RowCells.Num(); X++)
+		{
+			const int32 CellIndex = Grid.ToIndex(X, Y);
+			if (!IsOpenCell(Grid, CellIndex))
+			{
+				continue;
+			}
+			Grid.SetFlag(CellIndex, EMazeCellFlags::Visited);
+
+			const EMazeCellFlags RowFlags = static_cast<EMazeCellFlags>(RowCells[X]);
+			if (!EnumHasAnyFlags(RowFlags, EMazeCellFlags::WallPosX) && IsOpenCell(Grid, Grid.GetNeighbor(CellIndex, EMazeDirection::EMD_PosX)))
+			{
+				Grid.SetWall(CellIndex, EMazeDirection::EMD_PosX, false);
+			}
+			if (!EnumHasAnyFlags(RowFlags, EMazeCellFlags::WallPosY) && IsOpenCell(Grid, Grid.GetNeighbor(CellIndex, EMazeDirection::EMD_PosY)))
+			{
+				Grid.SetWall(CellIndex, EMazeDirection::EMD_PosY, false);
+			}
+		}
+		return !IsCancelled();
+	});
+
+	TrackScratchBytes(Eller.GetAllocatedSize());
+}
+
+void FMazeLayoutGenerator::RunParallelTiles(FMazeGrid& Grid)
+{
+	const int32 TileSize = FMath::Max(Settings.ParallelTileSize, 2);
+	const int32 TilesX = FMath::DivideAndRoundUp(Grid.Width, TileSize);
+	const int32 TilesY = FMath::DivideAndRoundUp(Grid.Height, TileSize);
+
+	ParallelFor(TilesX * TilesY, [this, &Grid, TileSize, TilesX](int32 TileIndex)
+	{
+		if (IsCancelled())
+		{
+			return;
+		}
+
+		const FIntPoint TileMin((TileIndex % TilesX) * TileSize, (TileIndex / TilesX) * TileSize);
+		const FIntPoint TileMax(FMath::Min(TileMin.X + TileSize, Grid.Width), FMath::Min(TileMin.Y + TileSize, Grid.Height));
+		TArray<int32> CellStack;
+		CarveTile(Grid, TileMin, TileMax, static_cast<int32>(HashCombine(GetTypeHash(Settings.Seed), GetTypeHash(TileIndex))), CellStack);
+	});
+
+	if (IsCancelled())
+	{
+		return;
+	}
+
+	FMazeCellSets Sets(Grid.Num());
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		if (!Grid.HasWall(CellIndex, EMazeDirection::EMD_PosX))
+		{
+			Sets.Union(CellIndex, CellIndex + 1);
+		}
+		if (!Grid.HasWall(CellIndex, EMazeDirection::EMD_PosY))
+		{
+			Sets.Union(CellIndex, CellIndex + Grid.Width);
+		}
+	}
+
+	// one random door candidate on every border between two tiles
+	TArray<int32> BorderEdges;
+	TArray<int32> Candidates;
+	for (int32 TileIndex = 0; TileIndex < TilesX * TilesY; TileIndex++)
+	{
+		const FIntPoint TileMin((TileIndex % TilesX) * TileSize, (TileIndex / TilesX) * TileSize);
+		const FIntPoint TileMax(FMath::Min(TileMin.X + TileSize, Grid.Width), FMath::Min(TileMin.Y + TileSize, Grid.Height));
+		FRandomStream BorderRandomStream(static_cast<int32>(HashCombine(GetTypeHash(Settings.Seed), GetTypeHash(-1 - TileIndex))));
+
+		// +X border
+		if (TileMax.X < Grid.Width)
+		{
+			Candidates.Reset();
+			for (int32 Y = TileMin.Y; Y < TileMax.Y; Y++)
+			{
+				const int32 CellIndex = Grid.ToIndex(TileMax.X - 1, Y);
+				if (IsOpenCell(Grid, CellIndex) && IsOpenCell(Grid, CellIndex + 1))
+				{
+					Candidates.Add(CellIndex * 2);
+				}
+			}
+			if (Candidates.Num() > 0)
+			{
+				BorderEdges.Add(Candidates[BorderRandomStream.RandRange(0, Candidates.Num() - 1)]);
+			}
+		}
+
+		// +Y border
+		if (TileMax.Y < Grid.Height)
+		{
+			Candidates.Reset();
+			for (int32 X = TileMin.X; X < TileMax.X; X++)
+			{
+				const int32 CellIndex = Grid.ToIndex(X, TileMax.Y - 1);
+				if (IsOpenCell(Grid, CellIndex) && IsOpenCell(Grid, CellIndex + Grid.Width))
+				{
+					Candidates.Add(CellIndex * 2 + 1);
+				}
+			}
+			if (Candidates.Num() > 0)
+			{
+				BorderEdges.Add(Candidates[BorderRandomStream.RandRange(0, Candidates.Num() - 1)]);
+			}
+		}
+	}
+
+	// random spanning tree over the tiles, a door is only opened if it joins two parts that are not connected yet
+	for (int32 i = BorderEdges.Num() - 1; i > 0; i--)
+	{
+		BorderEdges.Swap(i, MazeRandomStream.RandRange(0, i));
+	}
+	for (int32 EdgeIndex : BorderEdges)
+	{
+		const int32 CellIndex = EdgeIndex / 2;
+		const EMazeDirection Direction = EdgeIndex % 2 == 0 ? EMazeDirection::EMD_PosX : EMazeDirection::EMD_PosY;
+		if (Sets.Union(CellIndex, Grid.GetNeighbor(CellIndex, Direction)))
+		{
+			Grid.SetWall(CellIndex, Direction, false);
+		}
+	}
+
+	// plus the cell stack every worker thread uses while it carves a tile
+	TrackScratchBytes(Sets.GetAllocatedSize() + BorderEdges.GetAllocatedSize() + static_cast<int64>(TileSize) * TileSize * sizeof(int32));
+}
+
+void FMazeLayoutGenerator::CarveTile(FMazeGrid& Grid, FIntPoint TileMin, FIntPoint TileMax, int32 TileSeed, TArray<int32>& CellStack)
+{
+	FRandomStream TileRandomStream(TileSeed);
+	
+	// a cell is on the stack at most once, so the stack never grows past the size of the tile
+	CellStack.SetNumUninitialized((TileMax.X - TileMin.X) * (TileMax.Y - TileMin.Y));
+	auto IsInTile = [&Grid, TileMin, TileMax](int32 CellIndex)
+	{
+		// the bounds come first, the flags of a cell in another tile are being written by that tile's worker
+		const FIntPoint Cell = Grid.ToCoordinates(CellIndex);
+		if (Cell.X < TileMin.X || Cell.Y < TileMin.Y || Cell.X >= TileMax.X || Cell.Y >= TileMax.Y)
+		{
+			return false;
+		}
+		return IsOpenCell(Grid, CellIndex);
+	};
+
+	EMazeDirection UnvisitedDirections[4];
+	for (int32 Y = TileMin.Y; Y < TileMax.Y; Y++)
+	{
+		for (int32 X = TileMin.X; X < TileMax.X; X++)
+		{
+			// rooms can split a tile, so every part that is not visited yet gets its own walk
+			const int32 StartIndex = Grid.ToIndex(X, Y);
+			if (!IsOpenCell(Grid, StartIndex) || Grid.HasFlag(StartIndex, EMazeCellFlags::Visited))
+			{
+				continue;
+			}
+
+			Grid.SetFlag(StartIndex, EMazeCellFlags::Visited);
+			int32 StackSize = 0;
+			CellStack[StackSize++] = StartIndex;
+			while (StackSize > 0)
+			{
+				const int32 CellIndex = CellStack[StackSize - 1];
+				int32 NumUnvisited = 0;
+				for (int32 Direction = 0; Direction < static_cast<int32>(EMazeDirection::EMD_MAX); Direction++)
+				{
+					const int32 Neighbor = Grid.GetNeighbor(CellIndex, static_cast<EMazeDirection>(Direction));
+					if (Neighbor != INDEX_NONE && IsInTile(Neighbor) && !Grid.HasFlag(Neighbor, EMazeCellFlags::Visited))
+					{
+						UnvisitedDirections[NumUnvisited++] = static_cast<EMazeDirection>(Direction);
+					}
+				}
+
+				if (NumUnvisited == 0)
+				{
+					StackSize--;
+					continue;
+				}
+
+				const EMazeDirection Direction = UnvisitedDirections[TileRandomStream.RandRange(0, NumUnvisited - 1)];
+				const int32 Neighbor = Grid.GetNeighbor(CellIndex, Direction);
+				Grid.SetWall(CellIndex, Direction, false);
+				Grid.SetFlag(Neighbor, EMazeCellFlags::Visited);
+				CellStack[StackSize++] = Neighbor;
+			}
+		}
+	}
+}
+
+void FMazeLayoutGenerator::ConnectRegions(FMazeGrid& Grid)
+{
+	// group cells by what is already reachable, rooms included through their doors
+	FMazeCellSets Sets(Grid.Num());
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		if (!Grid.HasWall(CellIndex, EMazeDirection::EMD_PosX))
+		{
+			Sets.Union(CellIndex, CellIndex + 1);
+		}
+		if (!Grid.HasWall(CellIndex, EMazeDirection::EMD_PosY))
+		{
+			Sets.Union(CellIndex, CellIndex + Grid.Width);
+		}
+	}
+
+	// open the first wall found between two open cells of different groups until no such wall is left
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		if (!IsOpenCell(Grid, CellIndex))
+		{
+			continue;
+		}
+		for (EMazeDirection Direction : { EMazeDirection::EMD_PosX, EMazeDirection::EMD_PosY })
+		{
+			const int32 Neighbor = Grid.GetNeighbor(CellIndex, Direction);
+			if (IsOpenCell(Grid, Neighbor) && Sets.Union(CellIndex, Neighbor))
+			{
+				Grid.SetWall(CellIndex, Direction, false);
+			}
+		}
+	}
+
+	TrackScratchBytes(Sets.GetAllocatedSize());
+}
+
+void FMazeLayoutGenerator::FindDeadEnds(FMazeLayout& Layout)
+{
+	const FMazeGrid& Grid = Layout.Grid;
+	for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+	{
+		if (!IsOpenCell(Grid, CellIndex))
+		{
+			continue;
+		}
+
+		int32 NumOpen = 0;
+		for (int32 Direction = 0; Direction < static_cast<int32>(EMazeDirection::EMD_MAX); Direction++)
+		{
+			if (!Grid.HasWall(CellIndex, static_cast<EMazeDirection>(Direction)))
+			{
+				NumOpen++;
+			}
+		}
+		if (NumOpen == 1)
+		{
+			Layout.DeadEndCells.Add(CellIndex);
+		}
+	}
+}
+
+void FMazeLayoutGenerator::CarveEntryAndExit(FMazeLayout& Layout)
+{
+	const FMazeGrid& MazeGrid = Layout.Grid;
+
+	// sides 1 and 3 run along the width of the maze, sides 2 and 4 along the height
+	auto SideToDirection = [](int32 Side)
+	{
+		switch (Side)
+		{
+		case 1 :
+			return EMazeDirection::EMD_NegY;
+		case 2 :
+			return EMazeDirection::EMD_NegX;
+		case 3 :
+			return EMazeDirection::EMD_PosY;
+		default:
+			return EMazeDirection::EMD_PosX;
+		}
+	};
+
+	if (Settings.bHasEntry)
+	{
+		int32 EntryWallNumber = Settings.EntryWallNumber;
+		const int32 EntrySide = Settings.EntrySide;
+
+		if (!Settings.bCustomEntry)
+		{
+			if (Settings.bRandomEntry)
+			{
+				if (EntrySide == 1 || EntrySide == 3)
+				{
+					EntryWallNumber = MazeRandomStream.RandRange(0, Settings.MazeWidth - 1);
+				}
+				else if (EntrySide == 2 || EntrySide == 4)
+				{
+					EntryWallNumber = MazeRandomStream.RandRange(0, Settings.MazeHeight - 1);
+				}
+				else
+				{
+					EntryWallNumber = 0;
+				}
+			}
+		}
+		Layout.EntryWallNumber = EntryWallNumber;
+
+		if ((EntrySide == 1 || EntrySide == 3) && EntryWallNumber > Settings.MazeWidth - 1)
+		{
+			UE_LOG(LogTemp, Error, TEXT("EntryWallNumber is greater than MazeWidth"));
+			return;
+		}
+
+		if ((EntrySide == 2 || EntrySide == 4) && EntryWallNumber > Settings.MazeHeight - 1)
+		{
+			UE_LOG(LogTemp, Error, TEXT("EntryWallNumber is greater than MazeHeight"));
+			return;
+		}
+
+		if (EntrySide != 0)
+		{
+			Layout.EntryOuterEdge = MazeGrid.ToOuterEdgeIndex(SideToDirection(EntrySide), EntryWallNumber);
+		}
+	}
+
+	if (Settings.bHasExit)
+	{
+		int32 ExitWallNumber = Settings.ExitWallNumber;
+		const int32 ExitSide = Settings.ExitSide;
+
+		if (!Settings.bCustomExit)
+		{
+			if (Settings.bRandomExit)
+			{
+				if (ExitSide == 1 || ExitSide == 3)
+				{
+					ExitWallNumber = MazeRandomStream.RandRange(0, Settings.MazeWidth - 1);
+				}
+				else if (ExitSide == 2 || ExitSide == 4)
+				{
+					ExitWallNumber = MazeRandomStream.RandRange(0, Settings.MazeHeight - 1);
+				}
+				else
+				{
+					ExitWallNumber = 0;
+				}
+			}
+		}
+		Layout.ExitWallNumber = ExitWallNumber;
+
+		if ((ExitSide == 1 || ExitSide == 3) && ExitWallNumber > Settings.MazeWidth - 1)
+		{
+			UE_LOG(LogTemp, Error, TEXT("ExitWallNumber is greater than MazeWidth"));
+			return;
+		}
+
+		if ((ExitSide == 2 || ExitSide == 4) && ExitWallNumber > Settings.MazeHeight - 1)
+		{
+			UE_LOG(LogTemp, Error, TEXT("ExitWallNumber is greater than MazeHeight"));
+			return;
+		}
+
+		if (ExitSide != 0)
+		{
+			Layout.ExitOuterEdge = MazeGrid.ToOuterEdgeIndex(SideToDirection(ExitSide), ExitWallNumber);
+		}
+	}
+}
+
+void FMazeLayoutGenerator::CarveAdditionalOpenings(FMazeLayout& Layout)
+{
+	for (const FMazeOuterWallOpening& Opening : Settings.AdditionalOuterWallOpenings)
+	{
+		const int32 OuterEdge = Layout.Grid.ToOuterEdgeIndex(Opening.Side, Opening.Position);
+		if (OuterEdge == INDEX_NONE)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Outer wall opening at %d is not on the side of the maze"), Opening.Position);
+			continue;
+		}
+		Layout.OpenOuterEdges.AddUnique(OuterEdge);
+	}
+}
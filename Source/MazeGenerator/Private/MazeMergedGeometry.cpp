@@ -0,0 +1,263 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeMergedGeometry.h"
+
+int32 FMazeMergedChunk::NumBoxes() const
+{
+	int32 Num = 0;
+	for (const TArray<FBox>& SectionBoxes : Boxes)
+	{
+		Num += SectionBoxes.Num();
+	}
+	return Num;
+}
+
+FMazeMergedGeometryBuilder::FMazeMergedGeometryBuilder(const FMazeGrid& InGrid, TConstArrayView<int32> OpenOuterEdges, const FMazeMergedGeometrySizes& InSizes, int32 InChunkSize)
+	: Grid(InGrid)
+	, Sizes(InSizes)
+	, ChunkSize(FMath::Max(InChunkSize, 1))
+{
+	NumChunksX = FMath::DivideAndRoundUp(Grid.Width, ChunkSize);
+	NumChunksY = FMath::DivideAndRoundUp(Grid.Height, ChunkSize);
+
+	OpenOuterEdgeBits.Init(false, Grid.NumOuterEdges());
+	for (const int32 OuterEdgeIndex : OpenOuterEdges)
+	{
+		if (OpenOuterEdgeBits.IsValidIndex(OuterEdgeIndex))
+		{
+			OpenOuterEdgeBits[OuterEdgeIndex] = true;
+		}
+	}
+}
+
+int32 FMazeMergedGeometryBuilder::GetChunkOfCell(int32 CellIndex) const
+{
+	const FIntPoint Cell = Grid.ToCoordinates(CellIndex);
+	return (Cell.Y / ChunkSize) * NumChunksX + Cell.X / ChunkSize;
+}
+
+int32 FMazeMergedGeometryBuilder::GetChunkOfOuterEdge(int32 OuterEdgeIndex) const
+{
+	return GetChunkOfCell(Grid.GetOuterEdgeCell(OuterEdgeIndex));
+}
+
+bool FMazeMergedGeometryBuilder::HasOuterWall(EMazeDirection Side, int32 Position) const
+{
+	const int32 Length = Side == EMazeDirection::EMD_NegY || Side == EMazeDirection::EMD_PosY ? Grid.Width : Grid.Height;
+	return Position >= 0 && Position < Length && !OpenOuterEdgeBits[Grid.ToOuterEdgeIndex(Side, Position)];
+}
+
+FBox FMazeMergedGeometryBuilder::MakeRunAlongY(int32 X, int32 FirstY, int32 LastY, const FVector& WallSize, const FVector& CornerSize) const
+{
+	const double HalfThickness = FMath::Max(WallSize.Y, CornerSize.X) / 2;
+	const double Bottom = Sizes.Floor.Z / 2;
+	const double Top = Bottom + FMath::Max(WallSize.Z, CornerSize.Z);
+	return FBox(FVector(CornerX(X) - HalfThickness, CornerY(FirstY) - CornerSize.Y / 2, Bottom),
+		FVector(CornerX(X) + HalfThickness, CornerY(LastY) + CornerSize.Y / 2, Top));
+}
+
+FBox FMazeMergedGeometryBuilder::MakeRunAlongX(int32 Y, int32 FirstX, int32 LastX, const FVector& WallSize, const FVector& CornerSize) const
+{
+	const double HalfThickness = FMath::Max(WallSize.Y, CornerSize.Y) / 2;
+	const double Bottom = Sizes.Floor.Z / 2;
+	const double Top = Bottom + FMath::Max(WallSize.Z, CornerSize.Z);
+	return FBox(FVector(CornerX(FirstX) - CornerSize.X / 2, CornerY(Y) - HalfThickness, Bottom),
+		FVector(CornerX(LastX) + CornerSize.X / 2, CornerY(Y) + HalfThickness, Top));
+}
+
+FBox FMazeMergedGeometryBuilder::MakeCorner(int32 X, int32 Y, const FVector& CornerSize) const
+{
+	const double Bottom = Sizes.Floor.Z / 2;
+	return FBox(FVector(CornerX(X) - CornerSize.X / 2, CornerY(Y) - CornerSize.Y / 2, Bottom),
+		FVector(CornerX(X) + CornerSize.X / 2, CornerY(Y) + CornerSize.Y / 2, Bottom + CornerSize.Z));
+}
+
+void FMazeMergedGeometryBuilder::BuildChunk(int32 ChunkIndex, FMazeMergedChunk& OutChunk) const
+{
+	for (TArray<FBox>& SectionBoxes : OutChunk.Boxes)
+	{
+		SectionBoxes.Reset();
+	}
+	if (Grid.Num() == 0 || ChunkIndex < 0 || ChunkIndex >= NumChunks())
+	{
+		return;
+	}
+
+	const int32 MinX = (ChunkIndex % NumChunksX) * ChunkSize;
+	const int32 MinY = (ChunkIndex / NumChunksX) * ChunkSize;
+	const int32 EndX = FMath::Min(MinX + ChunkSize, Grid.Width);
+	const int32 EndY = FMath::Min(MinY + ChunkSize, Grid.Height);
+
+	TArray<FBox>& FloorBoxes = OutChunk.Boxes[static_cast<int32>(EMazeMergedSection::EMMS_Floor)];
+	TArray<FBox>& InnerWallBoxes = OutChunk.Boxes[static_cast<int32>(EMazeMergedSection::EMMS_InnerWall)];
+	TArray<FBox>& OuterWallBoxes = OutChunk.Boxes[static_cast<int32>(EMazeMergedSection::EMMS_OuterWall)];
+	TArray<FBox>& CornerBoxes = OutChunk.Boxes[static_cast<int32>(EMazeMergedSection::EMMS_Corner)];
+
+	FloorBoxes.Add(FBox(FVector(CornerX(MinX), CornerY(MinY), -Sizes.Floor.Z / 2), FVector(CornerX(EndX), CornerY(EndY), Sizes.Floor.Z / 2)));
+
+	// +X walls of a column of cells all sit on the same corner line, so they are merged along Y
+	for (int32 i = MinX; i < FMath::Min(EndX, Grid.Width - 1); i++)
+	{
+		int32 RunStart = INDEX_NONE;
+		for (int32 j = MinY; j <= EndY; j++)
+		{
+			const bool bWall = j < EndY && Grid.HasFlag(Grid.ToIndex(i, j), EMazeCellFlags::WallPosX);
+			if (bWall && RunStart == INDEX_NONE)
+			{
+				RunStart = j;
+			}
+			else if (!bWall && RunStart != INDEX_NONE)
+			{
+				InnerWallBoxes.Add(MakeRunAlongY(i + 1, RunStart, j, Sizes.InnerWall, Sizes.InnerCorner));
+				RunStart = INDEX_NONE;
+			}
+		}
+	}
+
+	// and +Y walls of a row of cells are merged along X
+	for (int32 j = MinY; j < FMath::Min(EndY, Grid.Height - 1); j++)
+	{
+		int32 RunStart = INDEX_NONE;
+		for (int32 i = MinX; i <= EndX; i++)
+		{
+			const bool bWall = i < EndX && Grid.HasFlag(Grid.ToIndex(i, j), EMazeCellFlags::WallPosY);
+			if (bWall && RunStart == INDEX_NONE)
+			{
+				RunStart = i;
+			}
+			else if (!bWall && RunStart != INDEX_NONE)
+			{
+				InnerWallBoxes.Add(MakeRunAlongX(j + 1, RunStart, i, Sizes.InnerWall, Sizes.InnerCorner));
+				RunStart = INDEX_NONE;
+			}
+		}
+	}
+
+	// outer walls are merged along each side of the grid the chunk touches, open edges split the runs
+	auto AddOuterRuns = [&](EMazeDirection Side, int32 First, int32 End)
+	{
+		int32 RunStart = INDEX_NONE;
+		for (int32 Position = First; Position <= End; Position++)
+		{
+			const bool bWall = Position < End && HasOuterWall(Side, Position);
+			if (bWall && RunStart == INDEX_NONE)
+			{
+				RunStart = Position;
+			}
+			else if (!bWall && RunStart != INDEX_NONE)
+			{
+				switch (Side)
+				{
+				case EMazeDirection::EMD_NegY :
+					OuterWallBoxes.Add(MakeRunAlongX(0, RunStart, Position, Sizes.OuterWall, Sizes.OuterCorner));
+					break;
+				case EMazeDirection::EMD_PosY :
+					OuterWallBoxes.Add(MakeRunAlongX(Grid.Height, RunStart, Position, Sizes.OuterWall, Sizes.OuterCorner));
+					break;
+				case EMazeDirection::EMD_NegX :
+					OuterWallBoxes.Add(MakeRunAlongY(0, RunStart, Position, Sizes.OuterWall, Sizes.OuterCorner));
+					break;
+				default:
+					OuterWallBoxes.Add(MakeRunAlongY(Grid.Width, RunStart, Position, Sizes.OuterWall, Sizes.OuterCorner));
+					break;
+				}
+				RunStart = INDEX_NONE;
+			}
+		}
+	};
+	if (MinY == 0)
+	{
+		AddOuterRuns(EMazeDirection::EMD_NegY, MinX, EndX);
+	}
+	if (EndY == Grid.Height)
+	{
+		AddOuterRuns(EMazeDirection::EMD_PosY, MinX, EndX);
+	}
+	if (MinX == 0)
+	{
+		AddOuterRuns(EMazeDirection::EMD_NegX, MinY, EndY);
+	}
+	if (EndX == Grid.Width)
+	{
+		AddOuterRuns(EMazeDirection::EMD_PosX, MinY, EndY);
+	}
+
+	// an outer corner only needs a box of its own when both outer walls next to it are open,
+	// it belongs to the chunk of the cell it touches with the lowest coordinates
+	const int32 LastCornerX = EndX == Grid.Width ? Grid.Width : EndX - 1;
+	const int32 LastCornerY = EndY == Grid.Height ? Grid.Height : EndY - 1;
+	for (int32 Y = MinY; Y <= LastCornerY; Y++)
+	{
+		for (int32 X = MinX; X <= LastCornerX; X++)
+		{
+			if (!Grid.IsOuterCorner(X, Y))
+			{
+				// only the first and last row have outer corners in between
+				if (Y != 0 && Y != Grid.Height)
+				{
+					X = FMath::Max(X, LastCornerX - 1);
+				}
+				continue;
+			}
+
+			const bool bCovered = (Y == 0 && (HasOuterWall(EMazeDirection::EMD_NegY, X - 1) || HasOuterWall(EMazeDirection::EMD_NegY, X)))
+				|| (Y == Grid.Height && (HasOuterWall(EMazeDirection::EMD_PosY, X - 1) || HasOuterWall(EMazeDirection::EMD_PosY, X)))
+				|| (X == 0 && (HasOuterWall(EMazeDirection::EMD_NegX, Y - 1) || HasOuterWall(EMazeDirection::EMD_NegX, Y)))
+				|| (X == Grid.Width && (HasOuterWall(EMazeDirection::EMD_PosX, Y - 1) || HasOuterWall(EMazeDirection::EMD_PosX, Y)));
+			if (!bCovered)
+			{
+				CornerBoxes.Add(MakeCorner(X, Y, Sizes.OuterCorner));
+			}
+		}
+	}
+}
+
+void FMazeMergedGeometryBuilder::AppendBox(const FBox& Box, TArray<FVector>& Vertices, TArray<int32>& Triangles, TArray<FVector>& Normals, TArray<FVector2D>& UVs)
+{
+	const FVector Center = Box.GetCenter();
+	const FVector Extent = Box.GetExtent();
+
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		const int32 AxisU = (Axis + 1) % 3;
+		const int32 AxisV = (Axis + 2) % 3;
+		for (const double Sign : { 1.0, -1.0 })
+		{
+			FVector Normal = FVector::ZeroVector;
+			Normal[Axis] = Sign;
+			FVector U = FVector::ZeroVector;
+			U[AxisU] = Extent[AxisU];
+			FVector V = FVector::ZeroVector;
+			V[AxisV] = Extent[AxisV];
+
+			// front faces are wound clockwise seen from outside the box
+			if (FVector::DotProduct(FVector::CrossProduct(U, V), Normal) > 0)
+			{
+				Swap(U, V);
+			}
+
+			const int32 FirstVertex = Vertices.Num();
+			const FVector FaceCenter = Center + Normal * Extent[Axis];
+			for (const FVector& Vertex : { FaceCenter - U - V, FaceCenter + U - V, FaceCenter + U + V, FaceCenter - U + V })
+			{
+				Vertices.Add(Vertex);
+				Normals.Add(Normal);
+				UVs.Add(FVector2D(Vertex[AxisU], Vertex[AxisV]) / 100);
+			}
+			Triangles.Append({ FirstVertex, FirstVertex + 1, FirstVertex + 2, FirstVertex, FirstVertex + 2, FirstVertex + 3 });
+		}
+	}
+}
+
+void FMazeMergedGeometryBuilder::GetBoxCorners(const FBox& Box, TArray<FVector>& OutVertices)
+{
+	OutVertices.Reset(8);
+	for (int32 Corner = 0; Corner < 8; Corner++)
+	{
+		OutVertices.Add(FVector(
+			(Corner & 1) ? Box.Max.X : Box.Min.X,
+			(Corner & 2) ? Box.Max.Y : Box.Min.Y,
+			(Corner & 4) ? Box.Max.Z : Box.Min.Z));
+	}
+}
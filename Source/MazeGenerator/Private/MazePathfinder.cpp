@@ -0,0 +1,256 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazePathfinder.h"
+
+void FMazeSearchBuffers::Init(int32 NumCells)
+{
+	Stamps.SetNumZeroed(NumCells);
+	Values.SetNumUninitialized(NumCells);
+	Queue.SetNumUninitialized(NumCells);
+	Stamp = 0;
+}
+
+void FMazeSearchBuffers::Reset()
+{
+	Stamps.Empty();
+	Values.Empty();
+	Queue.Empty();
+	Stamp = 0;
+}
+
+void FMazeSearchBuffers::BeginSearch()
+{
+	if (++Stamp == 0)
+	{
+		// the stamp wrapped around, so old stamps could look like the current search
+		FMemory::Memzero(Stamps.GetData(), Stamps.Num() * sizeof(uint32));
+		Stamp = 1;
+	}
+}
+
+void FMazePathfinder::Init(const FMazeGrid& Grid, int32 InMaxCachedPaths)
+{
+	Reset();
+	NumCells = Grid.Num();
+	MaxCachedPaths = FMath::Max(InMaxCachedPaths, 0);
+	if (NumCells == 0)
+	{
+		return;
+	}
+
+	Search.Init(NumCells);
+
+	// root the spanning tree at cell 0, it is dropped again if the maze turns out not to be a tree
+	TreeParents.SetNumUninitialized(NumCells);
+	TreeDepths.Init(INDEX_NONE, NumCells);
+	TreeParents[0] = INDEX_NONE;
+	TreeDepths[0] = 0;
+	Search.Queue[0] = 0;
+	int32 QueueEnd = 1;
+	for (int32 QueueStart = 0; QueueStart < QueueEnd; QueueStart++)
+	{
+		const int32 Cell = Search.Queue[QueueStart];
+		int32 Neighbors[4];
+		const int32 NumNeighbors = GetOpenNeighbors(Grid, Cell, Neighbors);
+		for (int32 i = 0; i < NumNeighbors; i++)
+		{
+			if (TreeDepths[Neighbors[i]] == INDEX_NONE)
+			{
+				TreeParents[Neighbors[i]] = Cell;
+				TreeDepths[Neighbors[i]] = TreeDepths[Cell] + 1;
+				Search.Queue[QueueEnd++] = Neighbors[i];
+			}
+		}
+	}
+
+	if (!IsTree(Grid, QueueEnd))
+	{
+		TreeParents.Empty();
+		TreeDepths.Empty();
+	}
+}
+
+void FMazePathfinder::Reset()
+{
+	NumCells = 0;
+	TreeParents.Empty();
+	TreeDepths.Empty();
+	Search.Reset();
+	CachedPaths.Empty();
+	UseCounter = 0;
+}
+
+bool FMazePathfinder::FindPath(const FMazeGrid& Grid, int32 FromCell, int32 ToCell, TArray<int32>& OutCells)
+{
+	OutCells.Reset();
+	if (!IsInitialized() || Grid.Num() != NumCells || !Grid.IsValidIndex(FromCell) || !Grid.IsValidIndex(ToCell))
+	{
+		return false;
+	}
+
+	// a path read backwards is the path in the other direction
+	if (FCachedPath* Cached = CachedPaths.Find(MakeKey(FromCell, ToCell)))
+	{
+		Cached->LastUse = ++UseCounter;
+		OutCells = Cached->Cells;
+		NumCacheHits++;
+		return true;
+	}
+	if (FCachedPath* Cached = CachedPaths.Find(MakeKey(ToCell, FromCell)))
+	{
+		Cached->LastUse = ++UseCounter;
+		OutCells.Reserve(Cached->Cells.Num());
+		for (int32 i = Cached->Cells.Num() - 1; i >= 0; i--)
+		{
+			OutCells.Add(Cached->Cells[i]);
+		}
+		NumCacheHits++;
+		return true;
+	}
+	NumCacheMisses++;
+
+	if (IsPerfect())
+	{
+		FindTreePath(FromCell, ToCell, OutCells);
+	}
+	else if (!FindSearchPath(Grid, FromCell, ToCell, OutCells))
+	{
+		return false;
+	}
+
+	AddCachedPath(MakeKey(FromCell, ToCell), OutCells);
+	return true;
+}
+
+int32 FMazePathfinder::GetOpenNeighbors(const FMazeGrid& Grid, int32 Cell, int32 OutNeighbors[4])
+{
+	const int32 X = Cell % Grid.Width;
+	const int32 Y = Cell / Grid.Width;
+	int32 NumNeighbors = 0;
+	if (X + 1 < Grid.Width && !Grid.HasFlag(Cell, EMazeCellFlags::WallPosX))
+	{
+		OutNeighbors[NumNeighbors++] = Cell + 1;
+	}
+	if (Y + 1 < Grid.Height && !Grid.HasFlag(Cell, EMazeCellFlags::WallPosY))
+	{
+		OutNeighbors[NumNeighbors++] = Cell + Grid.Width;
+	}
+	if (X > 0 && !Grid.HasFlag(Cell - 1, EMazeCellFlags::WallPosX))
+	{
+		OutNeighbors[NumNeighbors++] = Cell - 1;
+	}
+	if (Y > 0 && !Grid.HasFlag(Cell - Grid.Width, EMazeCellFlags::WallPosY))
+	{
+		OutNeighbors[NumNeighbors++] = Cell - Grid.Width;
+	}
+	return NumNeighbors;
+}
+
+bool FMazePathfinder::IsTree(const FMazeGrid& Grid, int32 NumReachedCells)
+{
+	if (NumReachedCells != Grid.Num())
+	{
+		return false;
+	}
+
+	// only the +X and +Y edge of every cell, so each open edge is counted once
+	int32 NumOpenEdges = 0;
+	for (int32 Cell = 0; Cell < Grid.Num(); Cell++)
+	{
+		const int32 X = Cell % Grid.Width;
+		const int32 Y = Cell / Grid.Width;
+		NumOpenEdges += X + 1 < Grid.Width && !Grid.HasFlag(Cell, EMazeCellFlags::WallPosX);
+		NumOpenEdges += Y + 1 < Grid.Height && !Grid.HasFlag(Cell, EMazeCellFlags::WallPosY);
+	}
+	return NumOpenEdges == Grid.Num() - 1;
+}
+
+void FMazePathfinder::FindTreePath(int32 FromCell, int32 ToCell, TArray<int32>& OutCells) const
+{
+	// climb from the deeper cell until both meet at their lowest common ancestor,
+	// the cells above ToCell are collected separately because they are walked in the wrong direction
+	TArray<int32, TInlineAllocator<256>> ToSide;
+	int32 A = FromCell;
+	int32 B = ToCell;
+	while (A != B)
+	{
+		if (TreeDepths[A] >= TreeDepths[B])
+		{
+			OutCells.Add(A);
+			A = TreeParents[A];
+		}
+		else
+		{
+			ToSide.Add(B);
+			B = TreeParents[B];
+		}
+	}
+	OutCells.Add(A);
+	for (int32 i = ToSide.Num() - 1; i >= 0; i--)
+	{
+		OutCells.Add(ToSide[i]);
+	}
+}
+
+bool FMazePathfinder::FindSearchPath(const FMazeGrid& Grid, int32 FromCell, int32 ToCell, TArray<int32>& OutCells)
+{
+	Search.BeginSearch();
+
+	// searched backwards from ToCell, so the parents lead from FromCell to ToCell
+	Search.MarkReached(ToCell, INDEX_NONE);
+	Search.Queue[0] = ToCell;
+	int32 QueueEnd = 1;
+	for (int32 QueueStart = 0; QueueStart < QueueEnd && !Search.IsReached(FromCell); QueueStart++)
+	{
+		const int32 Cell = Search.Queue[QueueStart];
+		int32 Neighbors[4];
+		const int32 NumNeighbors = GetOpenNeighbors(Grid, Cell, Neighbors);
+		for (int32 i = 0; i < NumNeighbors; i++)
+		{
+			if (!Search.IsReached(Neighbors[i]))
+			{
+				Search.MarkReached(Neighbors[i], Cell);
+				Search.Queue[QueueEnd++] = Neighbors[i];
+			}
+		}
+	}
+
+	if (!Search.IsReached(FromCell))
+	{
+		return false;
+	}
+	for (int32 Cell = FromCell; Cell != INDEX_NONE; Cell = Search.Values[Cell])
+	{
+		OutCells.Add(Cell);
+	}
+	return true;
+}
+
+void FMazePathfinder::AddCachedPath(uint64 Key, const TArray<int32>& Cells)
+{
+	if (MaxCachedPaths == 0)
+	{
+		return;
+	}
+
+	// an eviction walks all MaxCachedPaths entries (256 by default), far less than the search over the grid that found the path
+	if (CachedPaths.Num() >= MaxCachedPaths)
+	{
+		uint64 OldestKey = Key;
+		uint64 OldestUse = MAX_uint64;
+		for (const TPair<uint64, FCachedPath>& Pair : CachedPaths)
+		{
+			if (Pair.Value.LastUse < OldestUse)
+			{
+				OldestUse = Pair.Value.LastUse;
+				OldestKey = Pair.Key;
+			}
+		}
+		CachedPaths.Remove(OldestKey);
+	}
+
+	FCachedPath& Cached = CachedPaths.Add(Key);
+	Cached.Cells = Cells;
+	Cached.LastUse = ++UseCounter;
+}
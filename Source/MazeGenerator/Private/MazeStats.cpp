@@ -0,0 +1,6 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeStats.h"
+
+UE_TRACE_CHANNEL_DEFINE(MazeChannel);
@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeVisibility.h"
+
+#include "Async/ParallelFor.h"
+
+namespace MazeVisibility
+{
+	// the center, corners and side centers of a cell, pulled in a little so a line along a wall does not graze it
+	static const FVector2D SampleOffsets[] = {
+		FVector2D(0.0, 0.0),
+		FVector2D(-0.45, -0.45),
+		FVector2D(0.45, -0.45),
+		FVector2D(-0.45, 0.45),
+		FVector2D(0.45, 0.45),
+		FVector2D(0.0, -0.45),
+		FVector2D(0.0, 0.45),
+		FVector2D(-0.45, 0.0),
+		FVector2D(0.45, 0.0),
+	};
+}
+
+void FMazeVisibility::Build(const FMazeGrid& Grid, int32 InRadius)
+{
+	Reset();
+	if (Grid.Num() == 0 || InRadius <= 0)
+	{
+		return;
+	}
+
+	const int32 InWindowSize = 2 * InRadius + 1;
+	const int32 InWordsPerCell = FMath::DivideAndRoundUp(InWindowSize * InWindowSize, 64);
+	const int64 NumWords = static_cast<int64>(Grid.Num()) * InWordsPerCell;
+	if (NumWords > MAX_int32 || NumWords * static_cast<int64>(sizeof(uint64)) > MaxAllocatedBytes)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Maze visibility of %d cells with a radius of %d would take %.1f MB, the limit is %.1f MB"),
+			Grid.Num(), InRadius, NumWords * sizeof(uint64) / (1024.0 * 1024.0), MaxAllocatedBytes / (1024.0 * 1024.0));
+		return;
+	}
+
+	Width = Grid.Width;
+	Height = Grid.Height;
+	Radius = InRadius;
+	WindowSize = InWindowSize;
+	WordsPerCell = InWordsPerCell;
+	Bits.SetNumZeroed(static_cast<int32>(NumWords));
+
+	// every cell only writes its own window
+	ParallelFor(Grid.Num(), [this, &Grid](int32 CellIndex)
+	{
+		BuildCell(Grid, CellIndex, GetCellBits(CellIndex));
+	});
+}
+
+void FMazeVisibility::Reset()
+{
+	Bits.Empty();
+	Width = 0;
+	Height = 0;
+	Radius = 0;
+	WindowSize = 0;
+	WordsPerCell = 0;
+}
+
+bool FMazeVisibility::IsVisible(int32 FromCell, int32 ToCell) const
+{
+	if (!IsBuilt() || FromCell < 0 || FromCell >= Num() || ToCell < 0 || ToCell >= Num())
+	{
+		return false;
+	}
+
+	const int32 OffsetX = ToCell % Width - FromCell % Width;
+	const int32 OffsetY = ToCell / Width - FromCell / Width;
+	if (FMath::Abs(OffsetX) > Radius || FMath::Abs(OffsetY) > Radius)
+	{
+		return false;
+	}
+	return TestBit(GetCellBits(FromCell), GetWindowBit(OffsetX, OffsetY));
+}
+
+void FMazeVisibility::GetVisibleCells(int32 FromCell, TArray<int32>& OutCells) const
+{
+	OutCells.Reset();
+	if (!IsBuilt() || FromCell < 0 || FromCell >= Num())
+	{
+		return;
+	}
+
+	const int32 FromX = FromCell % Width;
+	const int32 FromY = FromCell / Width;
+	const uint64* CellBits = GetCellBits(FromCell);
+	for (int32 Word = 0; Word < WordsPerCell; Word++)
+	{
+		for (uint64 WordBits = CellBits[Word]; WordBits != 0; WordBits &= WordBits - 1)
+		{
+			const int32 Bit = Word * 64 + static_cast<int32>(FMath::CountTrailingZeros64(WordBits));
+			OutCells.Add((FromY + Bit / WindowSize - Radius) * Width + FromX + Bit % WindowSize - Radius);
+		}
+	}
+}
+
+void FMazeVisibility::BuildCell(const FMazeGrid& Grid, int32 CellIndex, uint64* CellBits) const
+{
+	const int32 SourceX = CellIndex % Width;
+	const int32 SourceY = CellIndex / Width;
+	SetBit(CellBits, GetWindowBit(0, 0));
+
+	for (int32 Distance = 1; Distance <= 2 * Radius; Distance++)
+	{
+		for (int32 OffsetY = -FMath::Min(Distance, Radius); OffsetY <= FMath::Min(Distance, Radius); OffsetY++)
+		{
+			const int32 RemainingX = Distance - FMath::Abs(OffsetY);
+			if (RemainingX > Radius)
+			{
+				continue;
+			}
+
+			// both cells at this distance in the row, or the single one on the column through the source
+			for (int32 OffsetX = -RemainingX; OffsetX <= RemainingX; OffsetX += FMath::Max(2 * RemainingX, 1))
+			{
+				const int32 X = SourceX + OffsetX;
+				const int32 Y = SourceY + OffsetY;
+				if (!Grid.IsValidCoordinates(X, Y) || TestBit(CellBits, GetWindowBit(OffsetX, OffsetY)))
+				{
+					continue;
+				}
+
+				// a line reaching this cell comes in through the side facing the source
+				const int32 StepX = OffsetX > 0 ? -1 : 1;
+				const int32 StepY = OffsetY > 0 ? -1 : 1;
+				const bool bFromX = OffsetX != 0
+					&& TestBit(CellBits, GetWindowBit(OffsetX + StepX, OffsetY))
+					&& !Grid.HasFlag(Grid.ToIndex(FMath::Min(X, X + StepX), Y), EMazeCellFlags::WallPosX);
+				const bool bFromY = OffsetY != 0
+					&& TestBit(CellBits, GetWindowBit(OffsetX, OffsetY + StepY))
+					&& !Grid.HasFlag(Grid.ToIndex(X, FMath::Min(Y, Y + StepY)), EMazeCellFlags::WallPosY);
+				if (!bFromX && !bFromY)
+				{
+					continue;
+				}
+
+				for (const FVector2D& SourceOffset : MazeVisibility::SampleOffsets)
+				{
+					bool bVisible = false;
+					for (const FVector2D& TargetOffset : MazeVisibility::SampleOffsets)
+					{
+						const FVector2D From(SourceX + SourceOffset.X, SourceY + SourceOffset.Y);
+						const FVector2D To(X + TargetOffset.X, Y + TargetOffset.Y);
+						if (TraceLine(Grid, SourceX, SourceY, From, To, CellBits))
+						{
+							bVisible = true;
+							break;
+						}
+					}
+					if (bVisible)
+					{
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+bool FMazeVisibility::TraceLine(const FMazeGrid& Grid, int32 SourceX, int32 SourceY, const FVector2D& From, const FVector2D& To, uint64* CellBits) const
+{
+	// cell (X, Y) covers [X - 0.5, X + 0.5) in cell space, shifted here so it covers [X, X + 1)
+	const double StartX = From.X + 0.5;
+	const double StartY = From.Y + 0.5;
+	const double DeltaX = To.X - From.X;
+	const double DeltaY = To.Y - From.Y;
+	int32 X = FMath::FloorToInt32(StartX);
+	int32 Y = FMath::FloorToInt32(StartY);
+	const int32 EndX = FMath::FloorToInt32(To.X + 0.5);
+	const int32 EndY = FMath::FloorToInt32(To.Y + 0.5);
+	const int32 StepX = DeltaX > 0 ? 1 : -1;
+	const int32 StepY = DeltaY > 0 ? 1 : -1;
+
+	// line parameter at the next vertical and horizontal grid line
+	const double TDeltaX = DeltaX != 0 ? 1.0 / FMath::Abs(DeltaX) : TNumericLimits<double>::Max();
+	const double TDeltaY = DeltaY != 0 ? 1.0 / FMath::Abs(DeltaY) : TNumericLimits<double>::Max();
+	double TMaxX = DeltaX != 0 ? ((StepX > 0 ? X + 1 : X) - StartX) / DeltaX : TNumericLimits<double>::Max();
+	double TMaxY = DeltaY != 0 ? ((StepY > 0 ? Y + 1 : Y) - StartY) / DeltaY : TNumericLimits<double>::Max();
+
+	auto IsOpenX = [&Grid](int32 CellX, int32 CellY, int32 Step)
+	{
+		return !Grid.HasFlag(Grid.ToIndex(Step > 0 ? CellX : CellX - 1, CellY), EMazeCellFlags::WallPosX);
+	};
+	auto IsOpenY = [&Grid](int32 CellX, int32 CellY, int32 Step)
+	{
+		return !Grid.HasFlag(Grid.ToIndex(CellX, Step > 0 ? CellY : CellY - 1), EMazeCellFlags::WallPosY);
+	};
+
+	for (int32 Steps = FMath::Abs(EndX - X) + FMath::Abs(EndY - Y); Steps > 0 && (X != EndX || Y != EndY); Steps--)
+	{
+		SetBit(CellBits, GetWindowBit(X - SourceX, Y - SourceY));
+		if (FMath::Abs(TMaxX - TMaxY) < UE_KINDA_SMALL_NUMBER)
+		{
+			if (!(IsOpenX(X, Y, StepX) && IsOpenY(X + StepX, Y, StepY)) && !(IsOpenY(X, Y, StepY) && IsOpenX(X, Y + StepY, StepX)))
+			{
+				return false;
+			}
+			X += StepX;
+			Y += StepY;
+			TMaxX += TDeltaX;
+			TMaxY += TDeltaY;
+			Steps--;
+		}
+		else if (TMaxX < TMaxY)
+		{
+			if (!IsOpenX(X, Y, StepX))
+			{
+				return false;
+			}
+			X += StepX;
+			TMaxX += TDeltaX;
+		}
+		else
+		{
+			if (!IsOpenY(X, Y, StepY))
+			{
+				return false;
+			}
+			Y += StepY;
+			TMaxY += TDeltaY;
+		}
+	}
+
+	if (X != EndX || Y != EndY)
+	{
+		return false;
+	}
+	SetBit(CellBits, GetWindowBit(X - SourceX, Y - SourceY));
+	return true;
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeVisibilityComponent.h"
+
+#include "MazeBase.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Kismet/GameplayStatics.h"
+
+// Sets default values for this component's properties
+UMazeVisibilityComponent::UMazeVisibilityComponent()
+{
+	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
+	// off to improve performance if you don't need them.
+	PrimaryComponentTick.bCanEverTick = true;
+
+	PlayerIndex = 0;
+	bLogPieceCounts = false;
+}
+
+// Called when the game starts
+void UMazeVisibilityComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!Maze)
+	{
+		Maze = Cast<AMazeBase>(GetOwner());
+	}
+}
+
+void UMazeVisibilityComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (IsValid(Maze))
+	{
+		Maze->ClearPieceCulling();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 UMazeVisibilityComponent::GetVisiblePieceCount() const
+{
+	return IsValid(Maze) ? Maze->GetVisiblePieceCount() : 0;
+}
+
+int32 UMazeVisibilityComponent::GetCulledPieceCount() const
+{
+	return IsValid(Maze) ? Maze->GetCulledPieceCount() : 0;
+}
+
+// Called every frame
+void UMazeVisibilityComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const APlayerCameraManager* CameraManager = UGameplayStatics::GetPlayerCameraManager(this, PlayerIndex);
+	if (!IsValid(Maze) || !CameraManager)
+	{
+		return;
+	}
+
+	Maze->UpdatePieceCulling(CameraManager->GetCameraLocation());
+
+	if (bLogPieceCounts && (Maze->GetVisiblePieceCount() != LastVisiblePieceCount || Maze->GetCulledPieceCount() != LastCulledPieceCount))
+	{
+		LastVisiblePieceCount = Maze->GetVisiblePieceCount();
+		LastCulledPieceCount = Maze->GetCulledPieceCount();
+		UE_LOG(LogTemp, Log, TEXT("Maze visibility: %d pieces visible, %d culled"), LastVisiblePieceCount, LastCulledPieceCount);
+	}
+}
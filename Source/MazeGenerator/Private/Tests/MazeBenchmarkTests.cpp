@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeBenchmarkCommandlet.h"
+#include "Dom/JsonObject.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MazeBenchmarkTests
+{
+	// the smallest suite that still runs every algorithm with every backend
+	const TCHAR* SuiteParams = TEXT("-Suite -Sizes=10 -Iterations=1");
+
+	int32 RunCommandlet(const FString& Params)
+	{
+		UMazeBenchmarkCommandlet* Commandlet = NewObject<UMazeBenchmarkCommandlet>();
+		return Commandlet->Main(Params);
+	}
+
+	TSharedPtr<FJsonObject> ReadJson(const FString& Filename)
+	{
+		FString Json;
+		TSharedPtr<FJsonObject> Object;
+		if (!FFileHelper::LoadFileToString(Json, *Filename) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Object))
+		{
+			return nullptr;
+		}
+		return Object;
+	}
+
+	bool WriteJson(const TSharedRef<FJsonObject>& Object, const FString& Filename)
+	{
+		FString Json;
+		return FJsonSerializer::Serialize(Object, TJsonWriterFactory<>::Create(&Json)) && FFileHelper::SaveStringToFile(Json, *Filename);
+	}
+
+	int32 NumValues(const UEnum* Enum)
+	{
+		// the last entry of a UENUM is the generated _MAX
+		return Enum->NumEnums() - 1;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMazeBenchmarkAlgorithmsTest, "Maze.Benchmark.Algorithms",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FMazeBenchmarkAlgorithmsTest::RunTest(const FString& Parameters)
+{
+	TestEqual(TEXT("The algorithm benchmark succeeds"), MazeBenchmarkTests::RunCommandlet(TEXT("-Width=64 -Height=64 -Iterations=1")), 0);
+
+	AddExpectedError(TEXT("Width, Height and Iterations have to be greater than 0"), EAutomationExpectedErrorFlags::Contains, 1);
+	TestEqual(TEXT("The algorithm benchmark rejects an empty maze"), MazeBenchmarkTests::RunCommandlet(TEXT("-Width=0")), 1);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMazeBenchmarkSuiteTest, "Maze.Benchmark.Suite",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FMazeBenchmarkSuiteTest::RunTest(const FString& Parameters)
+{
+	const FString OutputFile = FPaths::AutomationTransientDir() / TEXT("MazeBenchmarkSuite.json");
+	if (!TestEqual(TEXT("The suite succeeds"), MazeBenchmarkTests::RunCommandlet(FString::Printf(TEXT("%s -Output=\"%s\""), MazeBenchmarkTests::SuiteParams, *OutputFile)), 0))
+	{
+		return false;
+	}
+
+	const TSharedPtr<FJsonObject> Output = MazeBenchmarkTests::ReadJson(OutputFile);
+	const TArray<TSharedPtr<FJsonValue>>* Runs = nullptr;
+	if (!TestTrue(TEXT("The suite wrote its runs"), Output.IsValid() && Output->TryGetArrayField(TEXT("runs"), Runs)))
+	{
+		return false;
+	}
+
+	// a bare layout and one run per backend for every algorithm
+	const int32 NumAlgorithms = MazeBenchmarkTests::NumValues(StaticEnum<EMazeAlgorithm>());
+	const int32 NumBackends = MazeBenchmarkTests::NumValues(StaticEnum<EMazeRenderBackend>());
+	TestEqual(TEXT("Number of runs"), Runs->Num(), NumAlgorithms * (1 + NumBackends));
+
+	// the bare layout of an algorithm runs first, every backend has to spawn that same layout
+	TMap<FString, int32> LayoutCellsVisited;
+	for (const TSharedPtr<FJsonValue>& Run : *Runs)
+	{
+		const TSharedPtr<FJsonObject>& RunObject = Run->AsObject();
+		const FString Name = RunObject->GetStringField(TEXT("name"));
+		TestFalse(FString::Printf(TEXT("%s is not skipped at 10 x 10 cells"), *Name), RunObject->GetBoolField(TEXT("skipped")));
+		TestFalse(FString::Printf(TEXT("%s was constructed"), *Name), RunObject->GetBoolField(TEXT("failed")));
+
+		const int32 CellsVisited = static_cast<int32>(RunObject->GetNumberField(TEXT("cells_visited")));
+		TestTrue(FString::Printf(TEXT("%s visited the cells outside of rooms"), *Name), CellsVisited > 0 && CellsVisited <= 100);
+		const int32& LayoutCells = LayoutCellsVisited.FindOrAdd(RunObject->GetStringField(TEXT("algorithm")), CellsVisited);
+		TestEqual(FString::Printf(TEXT("%s visited as many cells as its bare layout"), *Name), CellsVisited, LayoutCells);
+
+		const TSharedPtr<FJsonObject>* Stages = nullptr;
+		TestTrue(FString::Printf(TEXT("%s has stage times"), *Name), RunObject->TryGetObjectField(TEXT("stages_ms"), Stages) && (*Stages)->HasField(TEXT("algorithm")));
+		if (RunObject->GetStringField(TEXT("backend")) != TEXT("Layout"))
+		{
+			TestTrue(FString::Printf(TEXT("%s created components"), *Name), RunObject->GetNumberField(TEXT("components_created")) > 0);
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMazeBenchmarkBaselineTest, "Maze.Benchmark.Baseline",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FMazeBenchmarkBaselineTest::RunTest(const FString& Parameters)
+{
+	const FString BaselineFile = FPaths::AutomationTransientDir() / TEXT("MazeBenchmarkBaseline.json");
+	const FString OutputFile = FPaths::AutomationTransientDir() / TEXT("MazeBenchmarkCompare.json");
+	if (!TestEqual(TEXT("The baseline suite succeeds"), MazeBenchmarkTests::RunCommandlet(FString::Printf(TEXT("%s -Output=\"%s\""), MazeBenchmarkTests::SuiteParams, *BaselineFile)), 0))
+	{
+		return false;
+	}
+
+	// timings of a second run are never exactly the same, so only a large slowdown would count here
+	TestEqual(TEXT("A run compared against itself succeeds"), MazeBenchmarkTests::RunCommandlet(FString::Printf(TEXT("%s -Output=\"%s\" -Baseline=\"%s\" -Tolerance=100 -MinDeltaMs=1000"),
+		MazeBenchmarkTests::SuiteParams, *OutputFile, *BaselineFile)), 0);
+
+	// a baseline where every run took no time makes every run a regression, allocations are not counted outside of a commandlet
+	const TSharedPtr<FJsonObject> Baseline = MazeBenchmarkTests::ReadJson(BaselineFile);
+	const TArray<TSharedPtr<FJsonValue>>* BaselineRuns = nullptr;
+	if (!TestTrue(TEXT("The baseline was written"), Baseline.IsValid() && Baseline->TryGetArrayField(TEXT("runs"), BaselineRuns)))
+	{
+		return false;
+	}
+	for (const TSharedPtr<FJsonValue>& Run : *BaselineRuns)
+	{
+		Run->AsObject()->SetNumberField(TEXT("total_ms"), 0);
+	}
+	if (!TestTrue(TEXT("The changed baseline was written"), MazeBenchmarkTests::WriteJson(Baseline.ToSharedRef(), BaselineFile)))
+	{
+		return false;
+	}
+
+	AddExpectedError(TEXT("Regression in"), EAutomationExpectedErrorFlags::Contains, 0);
+	AddExpectedError(TEXT("metrics regressed against"), EAutomationExpectedErrorFlags::Contains, 1);
+	TestEqual(TEXT("A regression fails the suite"), MazeBenchmarkTests::RunCommandlet(FString::Printf(TEXT("%s -Output=\"%s\" -Baseline=\"%s\" -MinDeltaMs=0"),
+		MazeBenchmarkTests::SuiteParams, *OutputFile, *BaselineFile)), 1);
+
+	const TSharedPtr<FJsonObject> Output = MazeBenchmarkTests::ReadJson(OutputFile);
+	const TArray<TSharedPtr<FJsonValue>>* Regressions = nullptr;
+	TestTrue(TEXT("The regressions are written to the output"), Output.IsValid() && Output->TryGetArrayField(TEXT("regressions"), Regressions) && Regressions->Num() > 0);
+	return true;
+}
+
+#endif
@@ -0,0 +1,257 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeLayoutFile.h"
+#include "MazeLayoutGenerator.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MazeLayoutTests
+{
+	TArray<EMazeAlgorithm> GetAlgorithms()
+	{
+		const UEnum* AlgorithmEnum = StaticEnum<EMazeAlgorithm>();
+		TArray<EMazeAlgorithm> Algorithms;
+		// the last entry of a UENUM is the generated _MAX
+		for (int32 i = 0; i < AlgorithmEnum->NumEnums() - 1; i++)
+		{
+			Algorithms.Add(static_cast<EMazeAlgorithm>(AlgorithmEnum->GetValueByIndex(i)));
+		}
+		return Algorithms;
+	}
+
+	FString GetAlgorithmName(EMazeAlgorithm Algorithm)
+	{
+		return StaticEnum<EMazeAlgorithm>()->GetNameStringByValue(static_cast<int64>(Algorithm));
+	}
+
+	FMazeGenerationSettings MakeSettings(EMazeAlgorithm Algorithm, int32 Seed, bool bCreateRooms)
+	{
+		FMazeGenerationSettings Settings;
+		Settings.MazeWidth = 41;
+		Settings.MazeHeight = 29;
+		Settings.Seed = Seed;
+		Settings.Algorithm = Algorithm;
+		// small tiles, so the parallel algorithm has borders to join
+		Settings.ParallelTileSize = 8;
+		Settings.bCreateRooms = bCreateRooms;
+		Settings.NumberOfRooms = 4;
+		Settings.RoomWidth = 3;
+		Settings.RoomHeight = 3;
+		Settings.NumberOfRoomDoors = 2;
+		Settings.bHasEntry = true;
+		Settings.bRandomEntry = true;
+		Settings.bHasExit = true;
+		Settings.bRandomExit = true;
+		return Settings;
+	}
+
+	bool IsSameLayout(const FMazeLayout& A, const FMazeLayout& B)
+	{
+		return A.Grid.Width == B.Grid.Width && A.Grid.Height == B.Grid.Height && A.Grid.Cells == B.Grid.Cells
+			&& A.RoomMinCells == B.RoomMinCells && A.RoomMaxCells == B.RoomMaxCells
+			&& A.DoorwayEdges == B.DoorwayEdges && A.DeadEndCells == B.DeadEndCells && A.OpenOuterEdges == B.OpenOuterEdges
+			&& A.EntryOuterEdge == B.EntryOuterEdge && A.ExitOuterEdge == B.ExitOuterEdge
+			&& A.EntryWallNumber == B.EntryWallNumber && A.ExitWallNumber == B.ExitWallNumber
+			&& A.EntryExitRandomSeed == B.EntryExitRandomSeed;
+	}
+
+	/// <summary>
+	/// Marks every cell that can be walked to from StartIndex through open walls, rooms included.
+	/// </summary>
+	void FindReachable(const FMazeGrid& Grid, int32 StartIndex, TArray<bool>& OutReached)
+	{
+		OutReached.Init(false, Grid.Num());
+		TArray<int32> Queue;
+		Queue.Reserve(Grid.Num());
+		Queue.Add(StartIndex);
+		OutReached[StartIndex] = true;
+		for (int32 i = 0; i < Queue.Num(); i++)
+		{
+			for (int32 Direction = 0; Direction < static_cast<int32>(EMazeDirection::EMD_MAX); Direction++)
+			{
+				if (Grid.HasWall(Queue[i], static_cast<EMazeDirection>(Direction)))
+				{
+					continue;
+				}
+				const int32 Neighbor = Grid.GetNeighbor(Queue[i], static_cast<EMazeDirection>(Direction));
+				if (!OutReached[Neighbor])
+				{
+					OutReached[Neighbor] = true;
+					Queue.Add(Neighbor);
+				}
+			}
+		}
+	}
+
+	int32 CountOpenInnerEdges(const FMazeGrid& Grid)
+	{
+		int32 NumOpen = 0;
+		for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+		{
+			// edges on the outside of the grid always report a wall, so entry and exit are not counted
+			NumOpen += !Grid.HasWall(CellIndex, EMazeDirection::EMD_PosX);
+			NumOpen += !Grid.HasWall(CellIndex, EMazeDirection::EMD_PosY);
+		}
+		return NumOpen;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMazeLayoutDeterministicTest, "Maze.Layout.Deterministic",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FMazeLayoutDeterministicTest::RunTest(const FString& Parameters)
+{
+	for (EMazeAlgorithm Algorithm : MazeLayoutTests::GetAlgorithms())
+	{
+		const FString Name = MazeLayoutTests::GetAlgorithmName(Algorithm);
+		const FMazeGenerationSettings Settings = MazeLayoutTests::MakeSettings(Algorithm, 1234, true);
+		FMazeLayout First;
+		FMazeLayout Second;
+		FMazeLayoutGenerator(Settings).Generate(First);
+		FMazeLayoutGenerator(Settings).Generate(Second);
+		TestTrue(FString::Printf(TEXT("%s gives the same layout for the same seed"), *Name), MazeLayoutTests::IsSameLayout(First, Second));
+
+		FMazeLayout OtherSeed;
+		FMazeLayoutGenerator(MazeLayoutTests::MakeSettings(Algorithm, 4321, true)).Generate(OtherSeed);
+		TestFalse(FString::Printf(TEXT("%s gives another layout for another seed"), *Name), First.Grid.Cells == OtherSeed.Grid.Cells);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMazeLayoutPerfectTest, "Maze.Layout.Perfect",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FMazeLayoutPerfectTest::RunTest(const FString& Parameters)
+{
+	for (EMazeAlgorithm Algorithm : MazeLayoutTests::GetAlgorithms())
+	{
+		const FString Name = MazeLayoutTests::GetAlgorithmName(Algorithm);
+		FMazeLayout Layout;
+		FMazeLayoutGenerator(MazeLayoutTests::MakeSettings(Algorithm, 99, false)).Generate(Layout);
+		const FMazeGrid& Grid = Layout.Grid;
+
+		// a spanning tree over every cell: connected and exactly one open wall less than there are cells
+		TArray<bool> Reached;
+		MazeLayoutTests::FindReachable(Grid, 0, Reached);
+		TestEqual(FString::Printf(TEXT("%s reaches every cell"), *Name), Reached.FilterByPredicate([](bool bReached) { return bReached; }).Num(), Grid.Num());
+		TestEqual(FString::Printf(TEXT("%s has no loops"), *Name), MazeLayoutTests::CountOpenInnerEdges(Grid), Grid.Num() - 1);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMazeLayoutConnectedTest, "Maze.Layout.ConnectedOutsideRooms",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FMazeLayoutConnectedTest::RunTest(const FString& Parameters)
+{
+	for (EMazeAlgorithm Algorithm : MazeLayoutTests::GetAlgorithms())
+	{
+		const FString Name = MazeLayoutTests::GetAlgorithmName(Algorithm);
+		FMazeLayout Layout;
+		FMazeLayoutGenerator(MazeLayoutTests::MakeSettings(Algorithm, 7, true)).Generate(Layout);
+		const FMazeGrid& Grid = Layout.Grid;
+		TestTrue(FString::Printf(TEXT("%s placed rooms"), *Name), Layout.RoomMinCells.Num() > 0);
+
+		const int32 StartIndex = Grid.Cells.IndexOfByPredicate([](uint8 Flags) { return (Flags & static_cast<uint8>(EMazeCellFlags::Room)) == 0; });
+		if (!TestTrue(FString::Printf(TEXT("%s left cells outside of the rooms"), *Name), StartIndex != INDEX_NONE))
+		{
+			continue;
+		}
+
+		TArray<bool> Reached;
+		MazeLayoutTests::FindReachable(Grid, StartIndex, Reached);
+		int32 NumUnreached = 0;
+		for (int32 CellIndex = 0; CellIndex < Grid.Num(); CellIndex++)
+		{
+			if (!Grid.HasFlag(CellIndex, EMazeCellFlags::Room) && !Reached[CellIndex])
+			{
+				NumUnreached++;
+			}
+		}
+		TestEqual(FString::Printf(TEXT("%s cells outside of rooms that cannot be reached"), *Name), NumUnreached, 0);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMazeLayoutFileRoundTripTest, "Maze.Layout.FileRoundTrip",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FMazeLayoutFileRoundTripTest::RunTest(const FString& Parameters)
+{
+	FMazeLayout Layout;
+	FMazeLayoutGenerator(MazeLayoutTests::MakeSettings(EMazeAlgorithm::EMA_Backtracker, 55, true)).Generate(Layout);
+	FMazeLayoutFileHeader Header;
+	Header.Seed = 55;
+	Header.Algorithm = static_cast<uint8>(EMazeAlgorithm::EMA_Backtracker);
+
+	const FString Filename = FPaths::AutomationTransientDir() / TEXT("MazeLayoutRoundTrip.mazelayout");
+	if (!TestTrue(TEXT("The layout file was saved"), FMazeLayoutFile::SaveToFile(Filename, Layout, Header)))
+	{
+		return false;
+	}
+
+	FMazeLayoutFileHeader LoadedHeader;
+	FMazeLayout Loaded;
+	if (!TestTrue(TEXT("The layout file was loaded"), FMazeLayoutFile::LoadFromFile(Filename, LoadedHeader, Loaded)))
+	{
+		return false;
+	}
+	TestTrue(TEXT("The loaded layout matches the saved one"), MazeLayoutTests::IsSameLayout(Layout, Loaded));
+	TestEqual(TEXT("The loaded seed"), LoadedHeader.Seed, Header.Seed);
+
+	// the format writes the same bytes for the same layout
+	TArray<uint8> Bytes;
+	TArray<uint8> LoadedBytes;
+	FMazeLayoutFile::Write(Layout, Header, Bytes);
+	FMazeLayoutFile::Write(Loaded, LoadedHeader, LoadedBytes);
+	TestTrue(TEXT("The loaded layout writes the same bytes"), Bytes == LoadedBytes);
+
+	Bytes.SetNum(Bytes.Num() - 1);
+	AddExpectedError(TEXT("The maze layout file is cut short"), EAutomationExpectedErrorFlags::Contains, 1);
+	TestFalse(TEXT("A file that is cut short is rejected"), FMazeLayoutFile::Read(Bytes, LoadedHeader, Loaded));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMazeLayoutFileValidationTest, "Maze.Layout.FileRejectsOutOfRange",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FMazeLayoutFileValidationTest::RunTest(const FString& Parameters)
+{
+	FMazeLayout Layout;
+	FMazeLayoutGenerator(MazeLayoutTests::MakeSettings(EMazeAlgorithm::EMA_Backtracker, 3, true)).Generate(Layout);
+	if (!TestTrue(TEXT("The layout has rooms"), Layout.RoomMinCells.Num() > 0))
+	{
+		return false;
+	}
+
+	// every rejected file logs why
+	AddExpectedError(TEXT("The maze layout file has"), EAutomationExpectedErrorFlags::Contains, 0);
+	
+	const FMazeGrid& Grid = Layout.Grid;
+	auto TestCorrupted = [this, &Layout](const TCHAR* What, TFunctionRef<void(FMazeLayout&, FMazeLayoutFileHeader&)> Corrupt)
+	{
+		FMazeLayout Corrupted = Layout;
+		FMazeLayoutFileHeader Header;
+		Corrupt(Corrupted, Header);
+		TArray<uint8> Bytes;
+		FMazeLayoutFile::Write(Corrupted, Header, Bytes);
+
+		FMazeLayoutFileHeader ReadHeader;
+		FMazeLayout ReadLayout;
+		TestFalse(What, FMazeLayoutFile::Read(Bytes, ReadHeader, ReadLayout));
+	};
+
+	TestCorrupted(TEXT("An unknown algorithm is rejected"), [](FMazeLayout&, FMazeLayoutFileHeader& Header) { Header.Algorithm = MAX_uint8; });
+	TestCorrupted(TEXT("A room outside of the grid is rejected"), [&Grid](FMazeLayout& Corrupted, FMazeLayoutFileHeader&) { Corrupted.RoomMaxCells[0].X = Grid.Width; });
+	TestCorrupted(TEXT("A room with negative cells is rejected"), [](FMazeLayout& Corrupted, FMazeLayoutFileHeader&) { Corrupted.RoomMinCells[0].Y = -1; });
+	TestCorrupted(TEXT("A doorway outside of the grid is rejected"), [&Grid](FMazeLayout& Corrupted, FMazeLayoutFileHeader&) { Corrupted.DoorwayEdges.Add(Grid.NumEdges()); });
+	TestCorrupted(TEXT("A dead end outside of the grid is rejected"), [&Grid](FMazeLayout& Corrupted, FMazeLayoutFileHeader&) { Corrupted.DeadEndCells.Add(Grid.Num()); });
+	TestCorrupted(TEXT("An open outer edge outside of the grid is rejected"), [](FMazeLayout& Corrupted, FMazeLayoutFileHeader&) { Corrupted.OpenOuterEdges.Add(INDEX_NONE); });
+	TestCorrupted(TEXT("An entry outside of the grid is rejected"), [&Grid](FMazeLayout& Corrupted, FMazeLayoutFileHeader&) { Corrupted.EntryOuterEdge = Grid.NumOuterEdges(); });
+	return true;
+}
+
+#endif
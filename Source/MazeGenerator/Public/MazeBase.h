@@ -4,140 +4,936 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "MazeGrid.h"
+#include "MazeLayoutGenerator.h"
+#include "MazeMergedGeometry.h"
+#include "MazeCellIndex.h"
+#include "MazeFlowField.h"
+#include "MazePathfinder.h"
+#include "MazeStats.h"
+#include "MazeVisibility.h"
 #include "MazeBase.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnMazeConstructionCompleted);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnMazeMaterializationProgress, float, Progress);
 
-UENUM()
-enum class ECellPosition : uint8
+USTRUCT(BlueprintType)
+struct FMazeCellData
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FTransform MazeCellTransform;
+
+	UPROPERTY(BlueprintReadOnly)
+	FIntPoint MazeCellCoordinates;
+
+	UPROPERTY(BlueprintReadOnly)
+	ECellPosition CellPosition = ECellPosition::ECP_Normal;
+
+	bool bAlgorithmHasVisited = false;
+	
+};
+
+// Forward declaring
+class UStaticMeshComponent;
+class UStaticMesh;
+class USceneComponent;
+class UHierarchicalInstancedStaticMeshComponent;
+class UProceduralMeshComponent;
+
+UENUM(BlueprintType, meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor="false"))
+enum class EMazePieceType : uint8
+{
+	EMPT_Floor,
+	EMPT_InnerWall,
+	EMPT_OuterWall,
+	EMPT_InnerCorner,
+	EMPT_OuterCorner,
+
+	EMPT_MAX UMETA(Hidden)
+};
+
+UENUM(BlueprintType)
+enum class EMazeRenderBackend : uint8
 {
-	ECP_Normal,
-	ECP_LeftSide,
-	ECP_RightSide,
-	ECP_TopSide,
-	ECP_BottomSide,
-	ECP_BottomRightCorner,
-	ECP_BottomLeftCorner,
-	ECP_TopRightCorner,
-	ECP_TopLeftCorner,
-
-	ECP_MAX
+	EMRB_ChildActors UMETA(DisplayName="Child Actors"),
+	EMRB_InstancedMeshes UMETA(DisplayName="Instanced Static Meshes"),
+	EMRB_MergedGeometry UMETA(DisplayName="Merged Geometry"),
 };
 
-USTRUCT(BlueprintType)
-struct FMazeCellData
-{
-	GENERATED_BODY()
+/// <summary>
+/// Targets AMazeBase keeps a flow field for.
+/// </summary>
+UENUM(BlueprintType)
+enum class EMazeFlowFieldTarget : uint8
+{
+	EMFT_Exit UMETA(DisplayName="Exit"),
+	EMFT_Room UMETA(DisplayName="Room"),
+	EMFT_MovingTarget UMETA(DisplayName="Moving Target"),
+};
+
+/// <summary>
+/// Stages of spawning a solved layout, in the order they run.
+/// </summary>
+enum class EMazeMaterializationStage : uint8
+{
+	EMMS_Floors,
+	EMMS_Corners,
+	EMMS_Walls,
+	EMMS_Carve,
+	
+	EMMS_Done
+};
+
+/// <summary>
+/// What a property edit changes, so an edit in the editor only redoes the part of the maze it affects.
+/// </summary>
+enum class EMazeEditFlags : uint8
+{
+	None = 0,
+	Topology = 1 << 0,
+	EntryExit = 1 << 1,
+	Sizes = 1 << 2,
+	Visuals = 1 << 3,
+	Collision = 1 << 4,
+	LOD = 1 << 5,
+};
+ENUM_CLASS_FLAGS(EMazeEditFlags);
+
+/// <summary>
+/// Spawned pieces of one piece type. A piece is either a child actor component or an instance of InstancedMesh,
+/// indexed by the FMazeGrid cell, edge, outer edge or corner index of the piece.
+/// </summary>
+USTRUCT()
+struct FMazePieceTable
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<UChildActorComponent>> Components;
+
+	/// <summary>
+	/// Instance index of each piece in InstancedMesh, INDEX_NONE when the piece is not instanced.
+	/// </summary>
+	UPROPERTY()
+	TArray<int32> Instances;
+
+	/// <summary>
+	/// Piece index of each instance, used to fix up Instances when a removal moves the last instance.
+	/// </summary>
+	UPROPERTY()
+	TArray<int32> InstancePieces;
+
+	UPROPERTY()
+	TObjectPtr<UHierarchicalInstancedStaticMeshComponent> InstancedMesh;
+
+	/// <summary>
+	/// Hidden child actor components that are not used by a piece right now and can be handed out again.
+	/// </summary>
+	UPROPERTY()
+	TArray<TObjectPtr<UChildActorComponent>> Pool;
+
+	int32 PoolHits = 0;
+	int32 PoolMisses = 0;
+
+	TArray<int32> PendingPieces;
+	TArray<FTransform> PendingTransforms;
+
+	/// <summary>
+	/// Forgets every piece and sizes the table for NumPieces. Does not destroy or pool child actor components.
+	/// </summary>
+	void Reset(int32 NumPieces);
+};
+
+/// <summary>
+/// Shared between AMazeBase and the worker task of one RegenerateMazeAsync call, so either side can see a cancellation.
+/// </summary>
+struct FMazeAsyncGeneration
+{
+	std::atomic<bool> bCancelled{ false };
+};
+
+UCLASS()
+class MAZEGENERATOR_API AMazeBase : public AActor
+{
+	GENERATED_BODY()
+	
+public:	
+	// Sets default values for this actor's properties
+	AMazeBase();
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
+	TObjectPtr<USceneComponent> CenterSceneComp;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
+	TObjectPtr<USceneComponent> FloorSceneComp;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
+	TObjectPtr<USceneComponent> InnerWallSceneComp;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
+	TObjectPtr<USceneComponent> OuterWallSceneComp;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
+	TObjectPtr<USceneComponent> InnerCornerSceneComp;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
+	TObjectPtr<USceneComponent> OuterCornerSceneComp;
+	
+	UPROPERTY(BlueprintReadOnly, Category="Maze Components")
+	TArray<TObjectPtr<UChildActorComponent>> FloorContainer;
+
+	UPROPERTY(BlueprintReadOnly, Category="Maze Components")
+	TArray<TObjectPtr<UChildActorComponent>> InnerWallContainer;
+
+	UPROPERTY(BlueprintReadOnly, Category="Maze Components")
+	TArray<TObjectPtr<UChildActorComponent>> OuterWallContainer;
+
+	UPROPERTY(BlueprintReadOnly, Category="Maze Components")
+	TArray<TObjectPtr<UChildActorComponent>> InnerCornerContainer;
+
+	UPROPERTY(BlueprintReadOnly, Category="Maze Components")
+	TArray<TObjectPtr<UChildActorComponent>> OuterCornerContainer;
+
+	/// <summary>
+	/// Spawned pieces of every EMazePieceType, indexed by the piece type.
+	/// </summary>
+	UPROPERTY()
+	TArray<FMazePieceTable> PieceTables;
+
+	/// <summary>
+	/// Procedural mesh of every chunk of the merged geometry backend, indexed by the FMazeMergedGeometryBuilder chunk index.
+	/// </summary>
+	UPROPERTY()
+	TArray<TObjectPtr<UProceduralMeshComponent>> MergedChunkMeshes;
+
+	/// <summary>
+	/// Collision only procedural mesh of every chunk when bMergedCollision is set, indexed like MergedChunkMeshes.
+	/// </summary>
+	UPROPERTY()
+	TArray<TObjectPtr<UProceduralMeshComponent>> CollisionChunkMeshes;
+
+	/// <summary>
+	/// Simplified procedural mesh of every block of LODProxyBlockSize cells when bBuildLODProxies is set, indexed by the block index.
+	/// </summary>
+	UPROPERTY()
+	TArray<TObjectPtr<UProceduralMeshComponent>> LODProxyMeshes;
+
+	
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void OnConstruction(const FTransform& Transform) override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	/// <summary>
+	/// Returns what an edit of PropertyName changes. OutPieceTypes gets a bit per EMazePieceType for visual edits.
+	/// </summary>
+	static EMazeEditFlags ClassifyPropertyEdit(FName PropertyName, int32& OutPieceTypes);
+
+	/// <summary>
+	/// Applies the edits collected since the last construction. Topology edits regenerate the maze when bGenerateInConstructionScript is set,
+	/// every other edit only updates the pieces it touches.
+	/// </summary>
+	void ApplyPendingEdits();
+
+	/// <summary>
+	/// Carves the entry, exit and openings again and only spawns or removes the outer walls that changed.
+	/// </summary>
+	void ApplyEntryExitEdit();
+
+	/// <summary>
+	/// Moves every spawned piece to the transform of the current piece sizes.
+	/// </summary>
+	void ApplySizeEdit();
+
+	/// <summary>
+	/// Swaps the class of the child actor pieces of PieceTypes in place. Piece types that switch between child actors
+	/// and instances are spawned again.
+	/// </summary>
+	void ApplyVisualEdit(int32 PieceTypes);
+
+	/// <summary>
+	/// Turns the collision of the pieces on or off and builds or clears the merged collision.
+	/// </summary>
+	void ApplyCollisionEdit();
+
+	/// <summary>
+	/// Removes every piece of a type and spawns it again with the current render backend.
+	/// </summary>
+	void RespawnPieces(EMazePieceType Type);
+
+	UFUNCTION()
+	void ClearMaze();
+
+	/// <summary>
+	/// Reads the piece sizes from the size meshes when bUseMeshSizes is set. Returns false if a mesh is missing.
+	/// </summary>
+	bool UpdatePieceSizes();
+
+	void SpawnFloor(int32 CellIndex);
+
+	/// <summary>
+	/// Spawns the inner walls on the +X and +Y side of a cell and the outer walls around it.
+	/// </summary>
+	void SpawnCellWalls(int32 CellIndex);
+
+	void SpawnCorner(int32 CornerIndex);
+
+	UChildActorComponent* CreateChildActorInstance(FTransform Transform,
+		UClass* Class,
+		TObjectPtr<USceneComponent> ParentSceneComponent,
+		FName ComponentName,
+		TArray<TObjectPtr<UChildActorComponent>>* Container);
+
+	FMazePieceTable& GetPieceTable(EMazePieceType Type);
+
+	void InitializePieceTables();
+
+	UClass* GetPieceClass(EMazePieceType Type) const;
+
+	UStaticMesh* GetPieceMesh(EMazePieceType Type) const;
+
+	USceneComponent* GetPieceSceneComponent(EMazePieceType Type) const;
+
+	TArray<TObjectPtr<UChildActorComponent>>* GetPieceContainer(EMazePieceType Type);
+
+	/// <summary>
+	/// True if pieces of this type are rendered as instances instead of child actors.
+	/// </summary>
+	bool UsesInstancedMesh(EMazePieceType Type) const;
+
+	UHierarchicalInstancedStaticMeshComponent* GetOrCreateInstancedMesh(EMazePieceType Type);
+
+	/// <summary>
+	/// True if pieces of this type are drawn by the merged chunk meshes instead of being spawned.
+	/// Corners are part of the merged wall runs, so they are only merged together with their walls.
+	/// </summary>
+	bool UsesMergedGeometry(EMazePieceType Type) const;
+
+	/// <summary>
+	/// Outer edges without a wall, entry and exit included.
+	/// </summary>
+	TArray<int32> GetOpenOuterEdges() const;
+
+	FMazeMergedGeometrySizes GetMergedGeometrySizes() const;
+
+	FMazeMergedGeometryBuilder MakeMergedGeometryBuilder() const;
+
+	UProceduralMeshComponent* GetOrCreateMergedChunkMesh(int32 ChunkIndex);
+
+	/// <summary>
+	/// Builds the merged geometry of every chunk again, or clears it when no piece type uses the merged backend.
+	/// </summary>
+	void RebuildMergedGeometry();
+
+	/// <summary>
+	/// Builds the mesh sections of only these chunks again, for edits that touch a few cells or outer edges.
+	/// </summary>
+	void RebuildMergedChunks(const TArray<int32>& Chunks);
+
+	/// <summary>
+	/// Clears the sections of the chunk meshes. The components are kept for the next generation.
+	/// </summary>
+	void ClearMergedGeometry();
+
+	/// <summary>
+	/// Memory of the grid, the piece tables and the piece containers in bytes.
+	/// </summary>
+	SIZE_T GetPieceDataAllocatedSize() const;
+
+	/// <summary>
+	/// Turns off the collision of a child actor piece when the merged collision stands in for it.
+	/// </summary>
+	void ApplyPieceCollision(UChildActorComponent* Component) const;
+
+	UProceduralMeshComponent* GetOrCreateCollisionChunkMesh(int32 ChunkIndex);
+
+	void RebuildMergedCollision();
+
+	/// <summary>
+	/// Builds the collision boxes of these chunks on a worker task. The bodies are created back on the game thread
+	/// and cooked asynchronously. A newer build replaces one that is still running and also takes over its chunks.
+	/// </summary>
+	void RebuildMergedCollisionChunks(const TArray<int32>& Chunks);
+
+	/// <summary>
+	/// Hands the convex boxes built by RebuildMergedCollisionChunks to the chunk meshes. Runs on the game thread.
+	/// </summary>
+	void ApplyMergedCollision(const TArray<int32>& Chunks, const TArray<TArray<TArray<FVector>>>& ChunkConvexes, int32 NumChunks, double StartTime);
+
+	/// <summary>
+	/// Cancels a running collision build and clears the collision of the chunk meshes. The components are kept.
+	/// </summary>
+	void ClearMergedCollision();
+
+	/// <summary>
+	/// Precomputes the visible sets of the current grid on a worker task, see FMazeVisibility. A newer build cancels a running one.
+	/// </summary>
+	void RebuildVisibility();
+
+	/// <summary>
+	/// Cancels a running visibility build, forgets the visible sets and shows every culled piece.
+	/// </summary>
+	void ClearVisibility();
+
+	/// <summary>
+	/// Builds the proxy mesh of every block again from the merged boxes of its cells, or clears them when bBuildLODProxies is off.
+	/// </summary>
+	void RebuildLODProxies();
+
+	/// <summary>
+	/// Clears the sections of the proxy meshes. The components are kept for the next generation.
+	/// </summary>
+	void ClearLODProxies();
+
+	UProceduralMeshComponent* GetOrCreateLODProxyMesh(int32 BlockIndex);
+
+	/// <summary>
+	/// Max draw distance of a full detail primitive whose bounds are centered within ExtraRadius of its pieces, 0 without proxies.
+	/// Pieces stay drawn up to half a block further than the proxies start, so there is no gap while both switch.
+	/// </summary>
+	float GetPieceDrawDistance(double ExtraRadius = 0.0) const;
+
+	/// <summary>
+	/// Sets the draw distance of every primitive of a child actor piece.
+	/// </summary>
+	void ApplyPieceDrawDistance(UChildActorComponent* Component) const;
+
+	/// <summary>
+	/// Applies the draw distances to the spawned pieces, instanced meshes and merged chunks and builds the proxies again.
+	/// </summary>
+	void ApplyLODEdit();
+
+	/// <summary>
+	/// Returns true if a cell touching the piece is in VisibleCellMask.
+	/// </summary>
+	bool IsPieceInVisibleCell(EMazePieceType Type, int32 PieceIndex) const;
+
+	/// <summary>
+	/// Spawns a piece with the current render backend. Instanced pieces are queued until FlushPendingInstances.
+	/// </summary>
+	void SpawnPiece(EMazePieceType Type, int32 PieceIndex, const FTransform& Transform);
+
+	/// <summary>
+	/// Takes a child actor component from the pool of the piece type, or creates one when the pool is empty.
+	/// </summary>
+	UChildActorComponent* AcquirePiece(EMazePieceType Type, const FTransform& Transform);
+
+	/// <summary>
+	/// Hides a child actor component and puts it back in the pool of the piece type, or destroys it when the pool is full.
+	/// </summary>
+	void ReleasePiece(EMazePieceType Type, UChildActorComponent* Component);
+
+	static void SetPooledPieceHidden(UChildActorComponent* Component, bool bHidden);
+
+	/// <summary>
+	/// Refills the piece containers from the piece tables, so they only hold the pieces in use.
+	/// </summary>
+	void RebuildPieceContainers();
+
+	void FlushPendingInstances(EMazePieceType Type);
+
+	void FlushAllPendingInstances();
+
+	/// <summary>
+	/// Releases the child actor to the pool or removes the instance of a piece.
+	/// </summary>
+	void RemovePiece(EMazePieceType Type, int32 PieceIndex);
+
+	UFUNCTION()
+	void GenerateAndSetRandomSeed();
+
+	/// <summary>
+	/// Copies every property the layout depends on, so the layout can be solved without touching the actor.
+	/// </summary>
+	FMazeGenerationSettings MakeGenerationSettings() const;
+
+	/// <summary>
+	/// The layout cache is only used for seeds the user controls, a freshly generated random seed would never be hit again
+	/// and only push other layouts out of the cache.
+	/// </summary>
+	FORCEINLINE bool ShouldUseLayoutCache() const { return bUseLayoutCache && (bUseCustomSeed || !bGenerateRandomSeed); }
+
+	/// <summary>
+	/// Takes the layout from FMazeLayoutCache when bUseLayoutCache is set, otherwise runs FMazeLayoutGenerator and caches the result.
+	/// Static so the worker task of RegenerateMazeAsync can call it. Returns false if CancelFlag was raised.
+	/// </summary>
+	static bool SolveLayout(const FMazeGenerationSettings& Settings, bool bUseCache, bool bPersistCache,
+		FMazeLayout& OutLayout, FMazeGenerationStats& OutStats, const std::atomic<bool>* CancelFlag = nullptr);
+
+	/// <summary>
+	/// Keeps only the first entry side and exit side that are checked.
+	/// </summary>
+	void NormalizeEntryAndExitSides();
+
+	/// <summary>
+	/// Starts spawning the pieces of a solved layout. Runs on the game thread.
+	/// In a game world with a frame budget the spawning is spread over the next ticks, otherwise it finishes right away.
+	/// LayoutStats starts the GenerationStats of this materialization.
+	/// </summary>
+	void MaterializeLayout(FMazeLayout&& Layout, double StartTime, const FMazeGenerationStats& LayoutStats = FMazeGenerationStats());
+
+	/// <summary>
+	/// Spawns pieces until every stage is done or EndTime (in FPlatformTime::Seconds) is reached. Returns true when done.
+	/// </summary>
+	bool ContinueMaterialization(double EndTime);
+
+	/// <summary>
+	/// Turns tick back off and broadcasts OnMazeConstructionCompleted.
+	/// </summary>
+	void FinishMaterialization();
+
+	/// <summary>
+	/// Takes over the grid of a solved layout and fills in the room, dead end, doorway and entry/exit data from it.
+	/// </summary>
+	void ApplyLayout(FMazeLayout&& Layout);
+
+	/// <summary>
+	/// Destroys the pieces of a fully spawned maze that the layout carved away. Used when bSpawnOnlyRemainingPieces is off.
+	/// </summary>
+	void RemoveCarvedPieces(const FMazeLayout& Layout);
+
+	/// <summary>
+	/// Copies the current maze back into a layout, the opposite of ApplyLayout.
+	/// </summary>
+	FMazeLayout MakeLayoutFromMaze() const;
+
+	/// <summary>
+	/// Transform of a cell relative to the maze, computed from its index in MazeGrid.
+	/// </summary>
+	FTransform GetCellTransform(int32 CellIndex) const;
+
+	/// <summary>
+	/// Transform of an inner wall relative to the maze, computed from its FMazeGrid edge index.
+	/// </summary>
+	FTransform GetInnerWallTransform(int32 EdgeIndex) const;
+
+	/// <summary>
+	/// Transform of an outer wall relative to the maze, computed from its FMazeGrid outer edge index.
+	/// </summary>
+	FTransform GetOuterWallTransform(int32 OuterEdgeIndex) const;
+
+	/// <summary>
+	/// Transform of an inner or outer corner relative to the maze, computed from its FMazeGrid corner index.
+	/// </summary>
+	FTransform GetCornerTransform(int32 CornerIndex) const;
+
+	bool IsOuterWallOpen(int32 OuterEdgeIndex) const;
+
+	FTransform GetPieceTransform(EMazePieceType Type, int32 PieceIndex) const;
+
+	/// <summary>
+	/// Recomputes the world space room, doorway, dead end and entry/exit data from the stored layout indices.
+	/// </summary>
+	void UpdateLayoutTransforms();
+
+	/// <summary>
+	/// Edits made in the editor since the last OnConstruction.
+	/// </summary>
+	EMazeEditFlags PendingEdits = EMazeEditFlags::None;
+
+	int32 PendingEditPieceTypes = 0;
+
+	/// <summary>
+	/// Bit per EMazePieceType that the merged chunk meshes were last built with.
+	/// </summary>
+	int32 MergedPieceTypes = 0;
+
+	/// <summary>
+	/// Collision build started by RebuildMergedCollisionChunks that has not been applied yet, and the chunks it builds.
+	/// </summary>
+	TSharedPtr<FMazeAsyncGeneration, ESPMode::ThreadSafe> PendingCollisionBuild;
+
+	TArray<int32> PendingCollisionChunks;
+
+	/// <summary>
+	/// Chunk size and grid size PendingCollisionChunks are numbered for.
+	/// </summary>
+	int32 PendingCollisionChunkSize = 0;
+
+	FIntPoint PendingCollisionGridSize = FIntPoint::ZeroValue;
+
+	/// <summary>
+	/// Collision boxes of every chunk in CollisionChunkMeshes.
+	/// </summary>
+	TArray<int32> CollisionChunkPrimitives;
+
+	float MergedCollisionBodyCreationMs = 0.f;
+
+	FMazeVisibility Visibility;
+
+	TSharedPtr<FMazeAsyncGeneration, ESPMode::ThreadSafe> PendingVisibilityBuild;
+
+	float VisibilityBuildMs = 0.f;
+
+	/// <summary>
+	/// Cell the pieces were last culled for, INDEX_NONE when they have to be checked again because the view left the maze or the pieces changed.
+	/// </summary>
+	int32 PieceCullingCell = INDEX_NONE;
+
+	bool bPieceCullingActive = false;
+
+	int32 LODProxyCount = 0;
+
+	/// <summary>
+	/// Cells seen from PieceCullingCell.
+	/// </summary>
+	TBitArray<> VisibleCellMask;
+
+	int32 VisiblePieceCount = 0;
+
+	int32 CulledPieceCount = 0;
+
+	/// <summary>
+	/// Answers FindPath. Set up on the first query after the maze changed.
+	/// </summary>
+	FMazePathfinder Pathfinder;
+
+	/// <summary>
+	/// Returns the cell under a world location, or INDEX_NONE if the location is outside the maze.
+	/// </summary>
+	int32 GetCellIndexAtLocation(const FVector& WorldLocation) const;
+
+	FMazeFlowField ExitFlowField;
+
+	/// <summary>
+	/// Flow field to the center cell of every room, in the order of RoomMinCells.
+	/// </summary>
+	TArray<FMazeFlowField> RoomFlowFields;
+
+	FMazeFlowField MovingTargetFlowField;
+
+	/// <summary>
+	/// Builds the exit and room flow fields from the current layout.
+	/// </summary>
+	void BuildFlowFields();
+
+	void ResetFlowFields();
+
+	const FMazeFlowField* GetFlowField(EMazeFlowFieldTarget Target, int32 RoomIndex) const;
+
+	/// <summary>
+	/// Tag of every cell and the cells of every tag by block, built with the layout.
+	/// </summary>
+	FMazeCellIndex CellTagIndex;
+
+	/// <summary>
+	/// Random stream of GetRandomTaggedCell, seeded with the layout so the picks repeat for the same seed.
+	/// </summary>
+	FRandomStream CellTagRandomStream;
+
+	void BuildCellTagIndex();
+
+	/// <summary>
+	/// Location relative to the maze where the center of cell (X, Y) is at (X, Y), as used by FMazeCellIndex.
+	/// </summary>
+	FVector2D GetCellSpaceLocation(const FVector& WorldLocation) const;
+
+	FVector GetCellWorldLocation(int32 CellIndex) const;
+
+	/// <summary>
+	/// Generation started by RegenerateMazeAsync that has not been materialized yet.
+	/// </summary>
+	TSharedPtr<FMazeAsyncGeneration, ESPMode::ThreadSafe> PendingGeneration;
+
+	EMazeMaterializationStage MaterializationStage = EMazeMaterializationStage::EMMS_Done;
+
+	/// <summary>
+	/// Next cell or corner of the current materialization stage.
+	/// </summary>
+	int32 MaterializationIndex = 0;
+
+	double MaterializationStartTime = 0.0;
+
+	/// <summary>
+	/// Set when the last materialization could not spawn any pieces, e.g. because a mesh size was missing.
+	/// </summary>
+	bool bConstructionFailed = false;
+
+	/// <summary>
+	/// Stats of the last generation. The layout fields come from SolveLayout, the rest is filled in while the pieces are spawned.
+	/// </summary>
+	FMazeGenerationStats GenerationStats;
+
+	/// <summary>
+	/// Solved layout waiting for the carve stage when bSpawnOnlyRemainingPieces is off.
+	/// </summary>
+	FMazeLayout CarvedLayout;
+	
+public:
+
+	/// <summary>
+	/// Generates and spawns the maze right away on the game thread.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze")
+	void RegenerateMaze();
+
+	/// <summary>
+	/// Solves the maze layout on a worker task and only spawns the pieces on the game thread once it is done.
+	/// OnMazeConstructionCompleted is broadcast when the maze is ready. Calling this again cancels the previous request.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze")
+	void RegenerateMazeAsync();
 
-	UPROPERTY(BlueprintReadOnly)
-	FTransform MazeCellTransform;
+	/// <summary>
+	/// Stops a pending RegenerateMazeAsync. The current maze is left as it is.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze")
+	void CancelAsyncGeneration();
 
-	UPROPERTY(BlueprintReadOnly)
-	FIntPoint MazeCellCoordinates;
+	UFUNCTION(BlueprintCallable, Category="Maze")
+	FORCEINLINE bool IsGeneratingAsync() const { return PendingGeneration.IsValid(); }
 
-	UPROPERTY(BlueprintReadOnly)
-	ECellPosition CellPosition;
+	UFUNCTION(BlueprintCallable, Category="Maze")
+	FORCEINLINE bool IsMaterializing() const { return MaterializationStage != EMazeMaterializationStage::EMMS_Done; }
 
-	bool bAlgorithmHasVisited;
-	
-};
+	/// <summary>
+	/// True when the last OnMazeConstructionCompleted was broadcast for a maze that could not be spawned.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze")
+	FORCEINLINE bool HasConstructionFailed() const { return bConstructionFailed; }
 
-// Forward declaring
-class UStaticMeshComponent;
-class UStaticMesh;
-class USceneComponent;
+	/// <summary>
+	/// Fraction of the current materialization that is done, 1 when nothing is being spawned.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze")
+	float GetMaterializationProgress() const;
 
-UCLASS()
-class MAZEGENERATOR_API AMazeBase : public AActor
-{
-	GENERATED_BODY()
-	
-public:	
-	// Sets default values for this actor's properties
-	AMazeBase();
+	/// <summary>
+	/// Builds the cell data for a single cell from the maze grid.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Cells")
+	FMazeCellData GetMazeCellData(FIntPoint CellCoordinates) const;
 
-	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
-	TObjectPtr<USceneComponent> CenterSceneComp;
+	UFUNCTION(BlueprintCallable, Category="Maze|Cells")
+	TArray<FMazeCellData> GetAllMazeCellData() const;
 
-	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
-	TObjectPtr<USceneComponent> FloorSceneComp;
+	/// <summary>
+	/// Writes the cell under a world location to OutCell, returns false if the location is outside the maze.
+	/// WorldToCell, CellToWorld, GetOpenDirections and IsWallBetween are plain arithmetic on the grid and the actor transform,
+	/// so they can be called from any thread while the maze is not regenerated or moved.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Cells")
+	bool WorldToCell(FVector WorldLocation, FIntPoint& OutCell) const;
 
-	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
-	TObjectPtr<USceneComponent> InnerWallSceneComp;
+	/// <summary>
+	/// World location of the center of a cell's floor.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Cells")
+	FVector CellToWorld(FIntPoint Cell) const;
 
-	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
-	TObjectPtr<USceneComponent> OuterWallSceneComp;
+	/// <summary>
+	/// Bit N is set if the cell is open towards the next cell in EMazeDirection N. Openings in the outer walls are not included.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Cells")
+	UPARAM(meta=(Bitmask, BitmaskEnum="/Script/MazeGenerator.EMazeDirection")) int32 GetOpenDirections(FIntPoint Cell) const;
 
-	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
-	TObjectPtr<USceneComponent> InnerCornerSceneComp;
+	/// <summary>
+	/// Returns true if two cells are not next to each other or there is a wall between them.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Cells")
+	bool IsWallBetween(FIntPoint CellA, FIntPoint CellB) const;
 
-	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category="Maze Components")
-	TObjectPtr<USceneComponent> OuterCornerSceneComp;
-	
-	UPROPERTY(BlueprintReadOnly, Category="Maze Components")
-	TArray<TObjectPtr<UChildActorComponent>> FloorContainer;
+	/// <summary>
+	/// Returns true if FromCell can see ToCell through the open edges of the maze. False while the visibility is not built.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Visibility")
+	bool IsCellVisibleFrom(FIntPoint FromCell, FIntPoint ToCell) const;
 
-	UPROPERTY(BlueprintReadOnly, Category="Maze Components")
-	TArray<TObjectPtr<UChildActorComponent>> InnerWallContainer;
+	/// <summary>
+	/// Hides the child actor pieces and merged chunks that cannot be seen from the cell under ViewLocation and shows the others.
+	/// Only checks the pieces again when the view enters another cell or the pieces changed, see UMazeVisibilityComponent.
+	/// Everything is shown while the visibility is not built or the view is outside the maze.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Visibility")
+	void UpdatePieceCulling(FVector ViewLocation);
 
-	UPROPERTY(BlueprintReadOnly, Category="Maze Components")
-	TArray<TObjectPtr<UChildActorComponent>> OuterWallContainer;
+	/// <summary>
+	/// Shows every piece hidden by UpdatePieceCulling.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Visibility")
+	void ClearPieceCulling();
 
-	UPROPERTY(BlueprintReadOnly, Category="Maze Components")
-	TArray<TObjectPtr<UChildActorComponent>> InnerCornerContainer;
+	/// <summary>
+	/// Finds the shortest path between two cells through the open edges of the maze, both cells included.
+	/// Recent paths are cached until the maze changes. Returns false if there is no finished maze or no path.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Path")
+	bool FindPath(FIntPoint FromCell, FIntPoint ToCell, TArray<FIntPoint>& OutCells);
 
-	UPROPERTY(BlueprintReadOnly, Category="Maze Components")
-	TArray<TObjectPtr<UChildActorComponent>> OuterCornerContainer;
+	/// <summary>
+	/// FindPath between the cells under two world locations. OutLocations holds the world location of the floor of every cell on the path.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Path")
+	bool FindPathWorld(FVector FromLocation, FVector ToLocation, TArray<FVector>& OutLocations);
 
-	
+	/// <summary>
+	/// Direction of the next step from Cell towards a flow field target. RoomIndex picks the room for EMFT_Room.
+	/// Returns EMD_MAX at the target, for cells that cannot reach it and when the flow field is not built.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Flow Fields")
+	EMazeDirection GetFlowDirection(EMazeFlowFieldTarget Target, FIntPoint Cell, int32 RoomIndex = 0) const;
 
-protected:
-	// Called when the game starts or when spawned
-	virtual void BeginPlay() override;
+	/// <summary>
+	/// GetFlowDirection for the cell under a world location, as a world space unit vector. Zero where there is no direction.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Flow Fields")
+	FVector GetFlowDirectionAtLocation(EMazeFlowFieldTarget Target, FVector WorldLocation, int32 RoomIndex = 0) const;
 
-	virtual void OnConstruction(const FTransform& Transform) override;
+	/// <summary>
+	/// Moves the target of the EMFT_MovingTarget flow field to the cell under a world location. Cheap to call every tick,
+	/// the flow field only changes when the location enters another cell.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Flow Fields")
+	void SetFlowFieldTarget(FVector WorldLocation);
 
-	UFUNCTION()
-	void ClearMaze();
+	UFUNCTION(BlueprintCallable, Category="Maze|Flow Fields")
+	void SetFlowFieldTargetCell(FIntPoint Cell);
 
-	UFUNCTION()
-	void GenerateFloors();
+	/// <summary>
+	/// Returns whether a cell is a dead end, corridor, junction, room or the entry or exit. EMCT_MAX outside of a finished maze.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Cells")
+	EMazeCellTag GetCellTag(FIntPoint Cell) const;
 
-	UFUNCTION()
-	void GenerateWalls();
+	UFUNCTION(BlueprintCallable, Category="Maze|Cells")
+	int32 GetTaggedCellCount(EMazeCellTag Tag) const;
 
-	UFUNCTION()
-	void GenerateCorners();
+	/// <summary>
+	/// Writes the world location of the Count cells with Tag closest to a world location, closest first.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Cells")
+	void FindNearestTaggedCells(EMazeCellTag Tag, FVector WorldLocation, int32 Count, TArray<FVector>& OutLocations) const;
 
-	void CreateChildActorInstance(FTransform Transform,
-		UClass* Class,
-		TObjectPtr<USceneComponent> ParentSceneComponent,
-		FName ComponentName,
-		TArray<TObjectPtr<UChildActorComponent>>* Container);
+	/// <summary>
+	/// Writes the world location of every cell with Tag at most MaxSteps cells away from the cell under a world location,
+	/// walking through the open edges of the maze, nearest first.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Cells")
+	void FindTaggedCellsWithinSteps(EMazeCellTag Tag, FVector WorldLocation, int32 MaxSteps, TArray<FVector>& OutLocations);
 
-	UFUNCTION()
-	void InitializeRandomStreamSeeds();
+	/// <summary>
+	/// Picks a random cell with Tag further than ExcludedRadius from ExcludedLocation, for example the player.
+	/// Returns false if every cell with Tag is inside the radius.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Cells")
+	bool GetRandomTaggedCell(EMazeCellTag Tag, FVector ExcludedLocation, float ExcludedRadius, FVector& OutLocation);
 
-	UFUNCTION()
-	void GenerateAndSetRandomSeed();
+	/// <summary>
+	/// Writes the current layout to a maze layout file, see FMazeLayoutFile. Returns false if there is no finished maze to save.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Layout")
+	bool SaveLayoutToFile(const FString& Filename) const;
 
-	UFUNCTION()
-	void RegenerateMaze();
+	/// <summary>
+	/// Reads a maze layout file and spawns it without running the maze algorithm.
+	/// The size, seed, algorithm and entry/exit of the maze are set from the file, the piece sizes stay as they are.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Layout")
+	bool LoadLayoutFromFile(const FString& Filename);
 
-	UFUNCTION()
-	void GenerateRooms();
+	/// <summary>
+	/// Stage timings and counts of the last generation, final once OnMazeConstructionCompleted was broadcast.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	FORCEINLINE FMazeGenerationStats GetGenerationStats() const { return GenerationStats; }
 
-	UFUNCTION()
-	void ImplementMazeAlgorithm();
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	int32 GetSpawnedChildActorCount() const;
 
-	UFUNCTION()
-	void CarveEntryAndExit();
-	
-public:
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	int32 GetSpawnedInstanceCount() const;
+
+	/// <summary>
+	/// Mesh sections with geometry in the merged chunk meshes, each one is a draw call.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	int32 GetMergedSectionCount() const;
+
+	/// <summary>
+	/// Box primitives in the merged collision of the maze.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	int32 GetMergedCollisionPrimitiveCount() const;
+
+	/// <summary>
+	/// Milliseconds the game thread spent creating the bodies of the last merged collision build. Cooking runs asynchronously.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	FORCEINLINE float GetMergedCollisionBodyCreationMs() const { return MergedCollisionBodyCreationMs; }
+
+	/// <summary>
+	/// Milliseconds the worker task spent on the last visibility precompute.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	FORCEINLINE float GetVisibilityBuildMs() const { return VisibilityBuildMs; }
+
+	/// <summary>
+	/// Child actor pieces and merged chunks shown by the last UpdatePieceCulling. Instanced pieces are never culled and count as visible.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	FORCEINLINE int32 GetVisiblePieceCount() const { return VisiblePieceCount; }
+
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	FORCEINLINE int32 GetCulledPieceCount() const { return CulledPieceCount; }
+
+	/// <summary>
+	/// Blocks with a proxy mesh, each one is drawn instead of the pieces of its block beyond LODProxyDistance.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	FORCEINLINE int32 GetLODProxyCount() const { return LODProxyCount; }
+
+	/// <summary>
+	/// Path queries answered from the path cache since the maze changed.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	int32 GetPathCacheHitCount() const;
+
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	int32 GetPathCacheMissCount() const;
+
+	/// <summary>
+	/// Hidden child actor pieces waiting in the pools of every piece type.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	int32 GetPooledPieceCount() const;
 
+	/// <summary>
+	/// Child actor pieces that were taken from a pool instead of being created, since the maze was spawned.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	int32 GetPiecePoolHitCount() const;
+
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	int32 GetPiecePoolMissCount() const;
+
+	/// <summary>
+	/// Destroys pooled pieces until every piece type has at most MaxPiecesPerType of them.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Pooling")
+	void TrimPiecePools(int32 MaxPiecesPerType);
+
+	/// <summary>
+	/// Broadcast once every generation is over, also when it failed. Check HasConstructionFailed to tell them apart.
+	/// </summary>
 	UPROPERTY(BlueprintAssignable, Category="Maze")
 	FOnMazeConstructionCompleted OnMazeConstructionCompleted;
 
+	/// <summary>
+	/// Broadcast after every tick of a frame budgeted materialization with the fraction that is done.
+	/// </summary>
+	UPROPERTY(BlueprintAssignable, Category="Maze")
+	FOnMazeMaterializationProgress OnMazeMaterializationProgress;
+
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties",
 		meta = (ExposeOnSpawn="true", ToolTip="This sets how many cells the maze will have width wise."))
 	int32 MazeWidth;
@@ -159,6 +955,75 @@ public:
 		meta = (EditCondition="bGenerateInConstructionScript", ToolTip="Click to regenerate the maze in the construction script"))
 	bool bRegenerateMazeInConstructionScript;
 
+	/// <summary>
+	/// When true the rooms, maze algorithm and entry/exit are solved on the maze grid before anything is spawned,
+	/// so only the walls and corners that are left get created. Inner corners that no wall touches are skipped.
+	/// When false every wall and corner is spawned first and the carved ones are destroyed afterwards.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties",
+		meta = (ExposeOnSpawn="true"))
+	bool bSpawnOnlyRemainingPieces;
+
+	/// <summary>
+	/// Milliseconds per frame spent spawning pieces in a game world. The rest is spawned on the next ticks.
+	/// 0 spawns the whole maze in the frame it was generated.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties",
+		meta = (ClampMin="0", Units="ms", ExposeOnSpawn="true"))
+	float MaterializationFrameBudgetMs;
+
+	/// <summary>
+	/// Hides child actor pieces and keeps them for the next generation instead of destroying them,
+	/// so regenerating a maze of the same size does not create new objects.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Pooling",
+		meta = (ExposeOnSpawn="true"))
+	bool bPoolPieces;
+
+	/// <summary>
+	/// Pieces created at once when a pool runs empty. The ones that are not needed yet wait hidden in the pool.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Pooling",
+		meta = (ClampMin="1", EditCondition="bPoolPieces", ExposeOnSpawn="true"))
+	int32 PiecePoolGrowSize;
+
+	/// <summary>
+	/// Most hidden pieces kept per piece type. Pieces released to a full pool are destroyed.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Pooling",
+		meta = (ClampMin="0", EditCondition="bPoolPieces", ExposeOnSpawn="true"))
+	int32 PiecePoolMaxSize;
+
+	/// <summary>
+	/// Reuses the solved layout of an earlier generation with the same size, seed, algorithm, rooms and entry/exit,
+	/// so regenerating only spawns the pieces again. Skipped while bGenerateRandomSeed picks a new seed every time. See FMazeLayoutCache.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Cache",
+		meta = (ExposeOnSpawn="true"))
+	bool bUseLayoutCache;
+
+	/// <summary>
+	/// Also keeps cached layouts in the Saved directory of the project, so they are still there after a restart.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Cache",
+		meta = (EditCondition="bUseLayoutCache", ExposeOnSpawn="true"))
+	bool bPersistLayoutCache;
+
+	/// <summary>
+	/// Most paths FindPath keeps around. The least recently used path is dropped for a new one.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Path",
+		meta = (ClampMin="0", ExposeOnSpawn="true"))
+	int32 MaxCachedPaths;
+
+	/// <summary>
+	/// Builds a flow field to the exit and one to the center of every room when the maze is spawned, see GetFlowDirection.
+	/// The moving target flow field is built by the first SetFlowFieldTarget either way.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Path",
+		meta = (ExposeOnSpawn="true"))
+	bool bBuildFlowFields;
+
 
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category="Maze|Properties|Seed",
 		meta = (ExposeOnSpawn="true"))
@@ -182,6 +1047,21 @@ public:
 		meta = (ExposeOnSpawn="true"))
 	FIntPoint MazeAlgorithmStartingCell;
 
+	/// <summary>
+	/// Algorithm used to carve the maze. The recursive backtracker gives long winding corridors,
+	/// Prim, Kruskal and Wilson give shorter branching ones, Sidewinder and Binary Tree are the fastest but have a visible bias.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Algorithm",
+		meta = (ExposeOnSpawn="true"))
+	EMazeAlgorithm Algorithm;
+
+	/// <summary>
+	/// Width and height in cells of the tiles the Parallel Tiles algorithm carves at the same time.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Algorithm",
+		meta = (ClampMin="2", EditCondition="Algorithm == EMazeAlgorithm::EMA_ParallelTiles", ExposeOnSpawn="true"))
+	int32 ParallelTileSize;
+
 
 	// make these arrays in the future
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Actors",
@@ -204,6 +1084,73 @@ public:
 			meta = (ExposeOnSpawn="true"))
 	TSubclassOf<AActor> OuterCornerActorClass;
 
+	/// <summary>
+	/// Child actors spawn one actor per piece. Instanced static meshes draw every piece of a type with one
+	/// hierarchical instanced mesh component, using the meshes set in the mesh sizes.
+	/// Merged geometry joins collinear walls and the floor into boxes of a few procedural mesh sections per chunk,
+	/// textured with the first material of the mesh sizes.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Actors",
+			meta = (ExposeOnSpawn="true"))
+	EMazeRenderBackend RenderBackend;
+
+	/// <summary>
+	/// Piece types that keep using child actors with the instanced or merged backend, for pieces that need actor logic.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Actors",
+			meta = (Bitmask, BitmaskEnum="/Script/MazeGenerator.EMazePieceType", EditCondition="RenderBackend != EMazeRenderBackend::EMRB_ChildActors", ExposeOnSpawn="true"))
+	int32 ChildActorPieceTypes;
+
+	/// <summary>
+	/// Width and height in cells of a chunk of the merged geometry and merged collision. Changing an entry or exit only builds its chunk again.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Actors",
+			meta = (ClampMin="1", ExposeOnSpawn="true"))
+	int32 MergedChunkSize;
+
+	/// <summary>
+	/// Gives the maze one box per straight wall run and per chunk of floor instead of a body per piece,
+	/// built off the game thread in chunks of MergedChunkSize cells. Collision is turned off on the pieces.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Collision",
+			meta = (ExposeOnSpawn="true"))
+	bool bMergedCollision;
+
+	/// <summary>
+	/// Precomputes which cells every cell can see when the maze is spawned, on a worker task.
+	/// A UMazeVisibilityComponent uses it to hide the pieces the camera cannot see.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Visibility",
+			meta = (ExposeOnSpawn="true"))
+	bool bBuildVisibility;
+
+	/// <summary>
+	/// Cells further away than this along X or Y always count as hidden. Every cell takes (2 * VisibilityRadius + 1)^2 bits,
+	/// about 80 bytes at the default of 12, which is 320 MB for a 2000 x 2000 maze. Builds above 1 GB are refused.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Visibility",
+			meta = (ClampMin="1", ClampMax="64", EditCondition="bBuildVisibility", ExposeOnSpawn="true"))
+	int32 VisibilityRadius;
+
+	/// <summary>
+	/// Builds one simplified mesh per block of LODProxyBlockSize x LODProxyBlockSize cells, a box per wall run and one floor box,
+	/// textured with the first material of the mesh sizes. Beyond LODProxyDistance the block draws its proxy instead of its pieces.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|LOD",
+			meta = (ExposeOnSpawn="true"))
+	bool bBuildLODProxies;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|LOD",
+			meta = (ClampMin="2", EditCondition="bBuildLODProxies", ExposeOnSpawn="true"))
+	int32 LODProxyBlockSize;
+
+	/// <summary>
+	/// Distance from the camera to the center of a block at which its proxy is drawn instead of its pieces.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|LOD",
+			meta = (ClampMin="0", Units="cm", EditCondition="bBuildLODProxies", ExposeOnSpawn="true"))
+	float LODProxyDistance;
+
 	
 	
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Rooms",
@@ -293,6 +1240,14 @@ public:
 	bool bExitSide4;
 
 
+	/// <summary>
+	/// Outer walls that are left open on top of the entry and exit, used to connect mazes that sit next to each other.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Openings",
+		meta = (ExposeOnSpawn="true"))
+	TArray<FMazeOuterWallOpening> AdditionalOuterWallOpenings;
+
+
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Properties|Sizes")
 	bool bUseMeshSizes;
 
@@ -338,13 +1293,7 @@ public:
 	
 
 	UPROPERTY()
-	TMap<FIntPoint, FMazeCellData> MazeData;
-
-	UPROPERTY()
-	FRandomStream MazeRandomStream;
-
-	UPROPERTY()
-	FRandomStream RoomRandomStream;
+	FMazeGrid MazeGrid;
 
 	UPROPERTY()
 	TArray<FVector> RoomCenters;
@@ -355,12 +1304,39 @@ public:
 	UPROPERTY()
 	TArray<FTransform> RemovedRoomDoorwayTransforms;
 
+	/// <summary>
+	/// Layout data behind RoomCenters, DeadEnds and RemovedRoomDoorwayTransforms, kept so the layout can be saved again.
+	/// </summary>
+	UPROPERTY()
+	TArray<FIntPoint> RoomMinCells;
+
+	UPROPERTY()
+	TArray<FIntPoint> RoomMaxCells;
+
+	UPROPERTY()
+	TArray<int32> DoorwayEdgeIndices;
+
+	UPROPERTY()
+	TArray<int32> DeadEndCellIndices;
+
 	UPROPERTY()
 	FTransform EntryWallTransform;
 
 	UPROPERTY()
 	FTransform ExitWallTransform;
 
+	UPROPERTY()
+	int32 EntryOuterEdgeIndex;
+
+	UPROPERTY()
+	int32 ExitOuterEdgeIndex;
+
+	UPROPERTY()
+	TArray<int32> OpenOuterEdgeIndices;
+
+	UPROPERTY()
+	int32 EntryExitRandomSeed;
+
 	UPROPERTY()
 	int32 ConstructorCounter;
 
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MazeBase.h"
+#include "MazeLayoutGenerator.h"
+#include "MazeBenchmarkCommandlet.generated.h"
+
+class FJsonObject;
+class FJsonValue;
+
+/// <summary>
+/// Measurements of one suite run, taken from the fastest of its iterations.
+/// </summary>
+struct FMazeBenchmarkResult
+{
+	/// <summary>
+	/// Size, algorithm and backend, the key a run is matched with in the baseline.
+	/// </summary>
+	FString Name;
+
+	int32 Width = 0;
+
+	int32 Height = 0;
+
+	FString Algorithm;
+
+	FString Backend;
+
+	/// <summary>
+	/// Set for runs over the cell limit of their backend, which have no measurements.
+	/// </summary>
+	bool bSkipped = false;
+
+	/// <summary>
+	/// Set for backend runs whose maze could not be constructed, which fail the suite.
+	/// </summary>
+	bool bFailed = false;
+
+	/// <summary>
+	/// Stats of the generator for a bare layout, or of the maze for a backend run.
+	/// </summary>
+	FMazeGenerationStats Stats;
+
+	double TotalMs = 0.0;
+
+	uint64 Allocations = 0;
+
+	uint64 AllocatedBytes = 0;
+
+	int32 ObjectsCreated = 0;
+
+	/// <summary>
+	/// Growth of the physical memory of the process during the run. Memory the allocator already had can hide part of it.
+	/// </summary>
+	int64 UsedPhysicalDeltaBytes = 0;
+
+	/// <summary>
+	/// Milliseconds of every stage the run went through, in the order the stages ran.
+	/// </summary>
+	TArray<TPair<FString, double>> GetStageMs() const;
+
+	TSharedRef<FJsonObject> ToJson() const;
+};
+
+/// <summary>
+/// Times maze generation without a world or any spawned pieces.
+/// Run with -run=MazeBenchmark, optionally with -Width=, -Height=, -Seed= and -Iterations=.
+/// Add -Tiles to compare the parallel tiles algorithm against the backtracker at 1k x 1k and 4k x 4k cells.
+/// Add -Suite to generate every size of -Sizes= (10,100,500,2000 by default) with every algorithm, first as a bare layout
+/// and then spawned into a world with every render backend. Runs headless with -nullrhi. Records the time of every stage,
+/// the allocations, created UObjects, memory and FMazeGenerationStats counters of every run and writes them to -Output= as JSON. With -Baseline= the results
+/// are compared against an earlier output file, and the commandlet fails if a stage, the total or the allocation count grew by
+/// more than -Tolerance= (0.15 by default) and by more than -MinDeltaMs= (1 by default) or -MinDeltaAllocations= (1000 by default).
+/// Allocations are only counted when the suite runs as a commandlet, since counting them means wrapping GMalloc for a while.
+/// -MaxChildActorCells= and -MaxInstancedCells= skip backend runs of larger mazes. A maze that cannot be constructed fails it too.
+/// The Maze.Benchmark automation tests run a small suite and check its output.
+/// </summary>
+UCLASS()
+class MAZEGENERATOR_API UMazeBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMazeBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/// <summary>
+	/// Generates the same layout with every EMazeAlgorithm and logs cells per second and peak memory for each.
+	/// </summary>
+	void BenchmarkAlgorithms(int32 Width, int32 Height, int32 Seed, int32 Iterations);
+
+	void BenchmarkParallelTiles(int32 Seed, int32 Iterations);
+
+	/// <summary>
+	/// Best time of Iterations runs in seconds. Writes the largest memory use of the runs to OutPeakBytes.
+	/// </summary>
+	static double TimeGeneration(const FMazeGenerationSettings& Settings, int32 Iterations, int64& OutPeakBytes);
+
+	int32 RunSuite(const FString& Params, int32 Seed, int32 Iterations);
+
+	/// <summary>
+	/// Settings of a suite maze, with a room per 400 cells and a random entry and exit so every layout stage has work to do.
+	/// </summary>
+	static FMazeGenerationSettings MakeSuiteSettings(int32 Size, int32 Seed, EMazeAlgorithm Algorithm);
+
+	static FMazeBenchmarkResult MeasureLayout(const FMazeGenerationSettings& Settings, int32 Iterations);
+
+	/// <summary>
+	/// Spawns a maze actor into World and regenerates it with the settings and backend, using PieceMesh for every piece.
+	/// The actor is destroyed and garbage collected after every iteration.
+	/// </summary>
+	static FMazeBenchmarkResult MeasureBackend(UWorld* World, const FMazeGenerationSettings& Settings, EMazeRenderBackend Backend, UStaticMesh* PieceMesh, int32 Iterations);
+
+	/// <summary>
+	/// Logs every metric of Results that regressed against the runs of the same name in BaselineFile and adds it to OutRegressions.
+	/// Allocations are only compared if both Results and the baseline counted them. Returns false if the baseline could not be read.
+	/// </summary>
+	static bool CompareWithBaseline(const TArray<FMazeBenchmarkResult>& Results, bool bAllocationsCounted, const FString& BaselineFile,
+		double Tolerance, double MinDeltaMs, double MinDeltaAllocations, TArray<TSharedPtr<FJsonValue>>& OutRegressions);
+};
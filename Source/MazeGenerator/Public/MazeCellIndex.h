@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+#include "MazePathfinder.h"
+#include "MazeCellIndex.generated.h"
+
+/// <summary>
+/// What a cell of a finished maze is, by the number of open sides it has.
+/// </summary>
+UENUM(BlueprintType)
+enum class EMazeCellTag : uint8
+{
+	EMCT_DeadEnd UMETA(DisplayName="Dead End"),
+	EMCT_Corridor UMETA(DisplayName="Corridor"),
+	EMCT_Junction UMETA(DisplayName="Junction"),
+	EMCT_Room UMETA(DisplayName="Room"),
+	EMCT_EntryExit UMETA(DisplayName="Entry or Exit"),
+
+	EMCT_MAX UMETA(Hidden)
+};
+
+/// <summary>
+/// Tag of every cell of an FMazeGrid, one byte per cell, and the cells of every tag grouped by square blocks of BucketSize cells,
+/// so spawn queries only look at the blocks around a location instead of every dead end or junction of the maze.
+/// Locations are in cell space, where the center of cell (X, Y) is at (X, Y). Distances are scaled by the cell size passed to Build.
+/// </summary>
+class MAZEGENERATOR_API FMazeCellIndex
+{
+public:
+	static constexpr int32 BucketSize = 8;
+
+	/// <summary>
+	/// Tags every cell of Grid. Room cells are tagged EMCT_Room and EntryExitCells EMCT_EntryExit,
+	/// every other cell is a dead end, a corridor or a junction when it has one, two or more open sides.
+	/// </summary>
+	void Build(const FMazeGrid& Grid, TConstArrayView<int32> EntryExitCells, const FVector2D& InCellSize);
+
+	void Reset();
+
+	FORCEINLINE bool IsBuilt() const { return Tags.Num() > 0; }
+
+	FORCEINLINE EMazeCellTag GetTag(int32 CellIndex) const
+	{
+		return Tags.IsValidIndex(CellIndex) ? static_cast<EMazeCellTag>(Tags[CellIndex]) : EMazeCellTag::EMCT_MAX;
+	}
+
+	/// <summary>
+	/// Every cell with Tag, in block order.
+	/// </summary>
+	TConstArrayView<int32> GetCells(EMazeCellTag Tag) const;
+
+	/// <summary>
+	/// Writes up to Count cells with Tag closest to Location, closest first.
+	/// Searches the rings of blocks around Location until no block left can hold a closer cell.
+	/// </summary>
+	void FindNearest(EMazeCellTag Tag, const FVector2D& Location, int32 Count, TArray<int32>& OutCells) const;
+
+	/// <summary>
+	/// Writes the cells with Tag that are at most MaxSteps steps through open edges away from StartCell, in the order of their distance.
+	/// Only visits the cells within MaxSteps. Grid has to be the grid passed to Build.
+	/// </summary>
+	void FindWithinSteps(const FMazeGrid& Grid, EMazeCellTag Tag, int32 StartCell, int32 MaxSteps, TArray<int32>& OutCells);
+
+	/// <summary>
+	/// Returns a uniformly random cell with Tag that is further than Radius from Location, or INDEX_NONE if there is none.
+	/// Only the blocks overlapping the excluded circle are looked at.
+	/// </summary>
+	int32 GetRandomCell(EMazeCellTag Tag, const FVector2D& Location, float Radius, const FRandomStream& RandomStream) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	FORCEINLINE double GetDistanceSquared(int32 CellIndex, const FVector2D& Location) const
+	{
+		const double DX = (CellIndex % Width - Location.X) * CellSize.X;
+		const double DY = (CellIndex / Width - Location.Y) * CellSize.Y;
+		return DX * DX + DY * DY;
+	}
+
+	FORCEINLINE int32 GetBucket(int32 BucketX, int32 BucketY) const { return BucketY * NumBucketsX + BucketX; }
+
+	TArray<uint8> Tags;
+
+	/// <summary>
+	/// Cells of every tag sorted by block, the cells of block B are [BucketStarts[B], BucketStarts[B + 1]).
+	/// </summary>
+	TArray<int32> TaggedCells[static_cast<int32>(EMazeCellTag::EMCT_MAX)];
+
+	TArray<int32> BucketStarts[static_cast<int32>(EMazeCellTag::EMCT_MAX)];
+
+	int32 Width = 0;
+
+	int32 Height = 0;
+
+	int32 NumBucketsX = 0;
+
+	int32 NumBucketsY = 0;
+
+	FVector2D CellSize = FVector2D(1.0, 1.0);
+
+	/// <summary>
+	/// Buffers of FindWithinSteps, its values are the steps from the start cell.
+	/// </summary>
+	FMazeSearchBuffers Search;
+};
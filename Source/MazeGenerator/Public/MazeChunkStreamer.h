@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "MazeChunkStreamer.generated.h"
+
+class AMazeBase;
+
+/// <summary>
+/// Streams an endless maze made of fixed size AMazeBase chunks around a tracked actor.
+/// Every chunk is generated from Seed and its chunk coordinates, so a chunk looks the same every time it is loaded.
+/// Each chunk is a connected maze on its own and every border between two chunks gets the same openings from both sides,
+/// so the whole maze stays connected no matter which chunks are loaded.
+/// </summary>
+UCLASS()
+class MAZEGENERATOR_API AMazeChunkStreamer : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	AMazeChunkStreamer();
+
+	/// <summary>
+	/// Maze class spawned for every chunk. Its pieces, sizes and rooms are used as they are,
+	/// the size, seed, entry, exit and openings are set by the streamer.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Streaming",
+		meta = (ExposeOnSpawn="true"))
+	TSubclassOf<AMazeBase> ChunkClass;
+
+	/// <summary>
+	/// Actor the chunks are streamed around. Uses the first player pawn when not set.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Streaming",
+		meta = (ExposeOnSpawn="true"))
+	TObjectPtr<AActor> TrackedActor;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Streaming",
+		meta = (ClampMin="1", ExposeOnSpawn="true"))
+	int32 ChunkWidth;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Streaming",
+		meta = (ClampMin="1", ExposeOnSpawn="true"))
+	int32 ChunkHeight;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Streaming",
+		meta = (ExposeOnSpawn="true"))
+	int32 Seed;
+
+	/// <summary>
+	/// Chunks up to this many chunks away from the tracked actor are loaded.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Streaming",
+		meta = (ClampMin="0", ExposeOnSpawn="true"))
+	int32 StreamingRadius;
+
+	/// <summary>
+	/// Extra chunks a loaded chunk is kept for before it is unloaded, so walking along a border does not reload it.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Streaming",
+		meta = (ClampMin="0", ExposeOnSpawn="true"))
+	int32 UnloadHysteresis;
+
+	/// <summary>
+	/// Openings carved in every border between two chunks.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Streaming",
+		meta = (ClampMin="1", ExposeOnSpawn="true"))
+	int32 OpeningsPerBorder;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Streaming",
+		meta = (ClampMin="1", ExposeOnSpawn="true"))
+	int32 MaxChunkLoadsPerTick;
+
+	/// <summary>
+	/// Solves the chunk layouts on a worker task with RegenerateMazeAsync.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Streaming",
+		meta = (ExposeOnSpawn="true"))
+	bool bGenerateChunksAsync;
+
+	/// <summary>
+	/// Chunk the world location is in.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Streaming")
+	FIntPoint WorldToChunk(const FVector& WorldLocation) const;
+
+	UFUNCTION(BlueprintCallable, Category="Maze|Streaming")
+	FVector GetChunkLocation(FIntPoint ChunkCoordinates) const;
+
+	UFUNCTION(BlueprintCallable, Category="Maze|Streaming")
+	AMazeBase* GetLoadedChunk(FIntPoint ChunkCoordinates) const;
+
+	UFUNCTION(BlueprintCallable, Category="Maze|Streaming")
+	FORCEINLINE int32 GetLoadedChunkCount() const { return LoadedChunks.Num(); }
+
+	/// <summary>
+	/// Loads and unloads chunks around the tracked actor right away instead of waiting for the next tick.
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category="Maze|Streaming")
+	void UpdateStreaming();
+
+	UFUNCTION(BlueprintCallable, Category="Maze|Streaming")
+	void UnloadAllChunks();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/// <summary>
+	/// Seed of a single chunk, mixed from Seed and the chunk coordinates.
+	/// </summary>
+	int32 GetChunkSeed(FIntPoint ChunkCoordinates) const;
+
+	/// <summary>
+	/// Cell positions of the openings in the border on the +X side (bAlongX) or +Y side of a chunk.
+	/// The chunk on the other side of the border asks for the same border and gets the same positions.
+	/// </summary>
+	TArray<int32> GetBorderOpenings(FIntPoint ChunkCoordinates, bool bAlongX) const;
+
+	/// <summary>
+	/// Size of one cell of ChunkClass, read from its default object.
+	/// </summary>
+	FVector GetCellSize() const;
+
+	AMazeBase* LoadChunk(FIntPoint ChunkCoordinates);
+
+	void UnloadChunk(FIntPoint ChunkCoordinates);
+
+	UPROPERTY()
+	TMap<FIntPoint, TObjectPtr<AMazeBase>> LoadedChunks;
+
+public:
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+};
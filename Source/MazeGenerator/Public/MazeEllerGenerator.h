@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+/// <summary>
+/// Generates a perfect maze one row at a time with Eller's algorithm. Only the set membership of the current row is kept,
+/// so memory use depends on the width of the maze and not on its height.
+/// Rows use the same EMazeCellFlags as FMazeGrid, with the +Y walls of a row leading into the next row.
+/// </summary>
+class MAZEGENERATOR_API FMazeEllerGenerator
+{
+public:
+	/// <summary>
+	/// Receives every finished row in order, Y going from 0 to Height - 1. Return false to stop early.
+	/// </summary>
+	using FRowConsumer = TFunctionRef<bool(int32 Y, TConstArrayView<uint8> RowCells)>;
+
+	FMazeEllerGenerator(int32 InWidth, int32 InHeight, int32 Seed);
+
+	FORCEINLINE bool HasNextRow() const { return NextRow < Height; }
+
+	FORCEINLINE int32 GetNextRowIndex() const { return NextRow; }
+
+	/// <summary>
+	/// Generates the next row. The returned view is only valid until the next call.
+	/// </summary>
+	TConstArrayView<uint8> GenerateNextRow();
+
+	/// <summary>
+	/// Generates every remaining row and hands them to Consumer. Returns false if Consumer stopped early.
+	/// </summary>
+	bool Generate(FRowConsumer Consumer);
+
+	/// <summary>
+	/// Memory held by the generator, in bytes. Does not change with the height of the maze.
+	/// </summary>
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	int32 FindSet(int32 Set);
+
+	int32 Width = 0;
+
+	int32 Height = 0;
+
+	int32 NextRow = 0;
+
+	FRandomStream RandomStream;
+
+	/// <summary>
+	/// Set of every cell in the row being generated, INDEX_NONE for cells that are not connected to the row before.
+	/// </summary>
+	TArray<int32> RowSets;
+
+	/// <summary>
+	/// Merged sets of the current row. Sets carried over from the last row use 0 to Width - 1, new sets use Width and up.
+	/// </summary>
+	TArray<int32> SetParents;
+
+	TArray<int32> SetCellsLeft;
+
+	TBitArray<> SetHasOpening;
+
+	TArray<int32> SetRemap;
+
+	TArray<uint8> RowCells;
+};
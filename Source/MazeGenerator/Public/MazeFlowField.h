@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+/// <summary>
+/// Direction of the next step from every cell of an FMazeGrid towards one target cell, one byte per cell,
+/// so any number of agents can look up where to go in constant time.
+/// The target cell and cells that cannot reach it store EMD_MAX.
+/// </summary>
+class MAZEGENERATOR_API FMazeFlowField
+{
+public:
+	/// <summary>
+	/// Runs a breadth first search out from TargetCell over the open edges of Grid.
+	/// </summary>
+	void Build(const FMazeGrid& Grid, int32 InTargetCell);
+
+	/// <summary>
+	/// Points the field at a new target cell. In a perfect maze every cell keeps its direction except the ones on the path
+	/// between the old and the new target, which are turned around, so following a moving target costs the length of its move.
+	/// Mazes with loops are built again. Grid has to be the grid passed to Build.
+	/// </summary>
+	void Retarget(const FMazeGrid& Grid, int32 NewTargetCell);
+
+	void Reset();
+
+	FORCEINLINE bool IsBuilt() const { return Directions.Num() > 0; }
+
+	FORCEINLINE int32 GetTargetCell() const { return TargetCell; }
+
+	FORCEINLINE EMazeDirection GetDirection(int32 CellIndex) const
+	{
+		return Directions.IsValidIndex(CellIndex) ? static_cast<EMazeDirection>(Directions[CellIndex]) : EMazeDirection::EMD_MAX;
+	}
+
+	FORCEINLINE SIZE_T GetAllocatedSize() const { return Directions.GetAllocatedSize() + Queue.GetAllocatedSize(); }
+
+private:
+	TArray<uint8> Directions;
+
+	/// <summary>
+	/// Search queue of Build, kept so rebuilding for a moving target does not allocate.
+	/// </summary>
+	TArray<int32> Queue;
+
+	int32 TargetCell = INDEX_NONE;
+
+	int32 Width = 0;
+
+	/// <summary>
+	/// True if the last Build reached every cell over exactly NumCells - 1 open edges.
+	/// </summary>
+	bool bTree = false;
+};
@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.generated.h"
+
+UENUM()
+enum class ECellPosition : uint8
+{
+	ECP_Normal,
+	ECP_LeftSide,
+	ECP_RightSide,
+	ECP_TopSide,
+	ECP_BottomSide,
+	ECP_BottomRightCorner,
+	ECP_BottomLeftCorner,
+	ECP_TopRightCorner,
+	ECP_TopLeftCorner,
+
+	ECP_MAX
+};
+
+UENUM(BlueprintType)
+enum class EMazeDirection : uint8
+{
+	EMD_PosX,
+	EMD_PosY,
+	EMD_NegX,
+	EMD_NegY,
+
+	EMD_MAX UMETA(Hidden)
+};
+
+/// <summary>
+/// Bits stored per cell in FMazeGrid. A cell only owns the walls on its +X and +Y sides,
+/// the -X and -Y walls belong to the neighboring cell.
+/// </summary>
+enum class EMazeCellFlags : uint8
+{
+	None = 0,
+	WallPosX = 1 << 0,
+	WallPosY = 1 << 1,
+	Visited = 1 << 2,
+	Room = 1 << 3,
+
+	Walls = WallPosX | WallPosY,
+};
+ENUM_CLASS_FLAGS(EMazeCellFlags);
+
+/// <summary>
+/// Dense maze layout. Cells are stored row-major (Y * Width + X) with one byte of EMazeCellFlags each.
+/// This is the authoritative layout of a maze, everything spawned in the world is derived from it.
+/// </summary>
+USTRUCT()
+struct MAZEGENERATOR_API FMazeGrid
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Width = 0;
+
+	UPROPERTY()
+	int32 Height = 0;
+
+	UPROPERTY()
+	TArray<uint8> Cells;
+
+	/// <summary>
+	/// Resizes the grid and puts a wall on every inner edge. All cells start unvisited.
+	/// </summary>
+	void Init(int32 InWidth, int32 InHeight);
+
+	void Empty();
+
+	FORCEINLINE int32 Num() const { return Cells.Num(); }
+
+	FORCEINLINE bool IsValidCoordinates(int32 X, int32 Y) const { return X >= 0 && Y >= 0 && X < Width && Y < Height; }
+
+	FORCEINLINE bool IsValidCoordinates(const FIntPoint& Coordinates) const { return IsValidCoordinates(Coordinates.X, Coordinates.Y); }
+
+	FORCEINLINE bool IsValidIndex(int32 Index) const { return Cells.IsValidIndex(Index); }
+
+	FORCEINLINE int32 ToIndex(int32 X, int32 Y) const { return Y * Width + X; }
+
+	FORCEINLINE int32 ToIndex(const FIntPoint& Coordinates) const { return ToIndex(Coordinates.X, Coordinates.Y); }
+
+	FORCEINLINE FIntPoint ToCoordinates(int32 Index) const { return FIntPoint(Index % Width, Index / Width); }
+
+	FORCEINLINE bool HasFlag(int32 Index, EMazeCellFlags Flag) const { return EnumHasAnyFlags(static_cast<EMazeCellFlags>(Cells[Index]), Flag); }
+
+	FORCEINLINE void SetFlag(int32 Index, EMazeCellFlags Flag) { Cells[Index] |= static_cast<uint8>(Flag); }
+
+	FORCEINLINE void ClearFlag(int32 Index, EMazeCellFlags Flag) { Cells[Index] &= ~static_cast<uint8>(Flag); }
+
+	/// <summary>
+	/// Returns the index of the cell next to Index in Direction, or INDEX_NONE if that is outside the grid.
+	/// </summary>
+	int32 GetNeighbor(int32 Index, EMazeDirection Direction) const;
+
+	/// <summary>
+	/// Edges on the outside of the grid always report a wall.
+	/// </summary>
+	bool HasWall(int32 Index, EMazeDirection Direction) const;
+
+	/// <summary>
+	/// Adds or removes the wall between Index and its neighbor in Direction. Does nothing on the outside of the grid.
+	/// </summary>
+	void SetWall(int32 Index, EMazeDirection Direction, bool bHasWall);
+
+	ECellPosition GetCellPosition(int32 Index) const;
+
+	/// <summary>
+	/// Inner edges are numbered CellIndex * 2 for the +X wall and CellIndex * 2 + 1 for the +Y wall of a cell.
+	/// Indices on the outside of the grid are never used.
+	/// </summary>
+	FORCEINLINE int32 NumEdges() const { return Cells.Num() * 2; }
+
+	/// <summary>
+	/// Returns the inner edge between Index and its neighbor in Direction, or INDEX_NONE if that is outside the grid.
+	/// </summary>
+	int32 ToEdgeIndex(int32 Index, EMazeDirection Direction) const;
+
+	/// <summary>
+	/// Outer edges are numbered along the -Y side, the -X side, the +Y side and then the +X side,
+	/// which matches the entry and exit sides 1 to 4.
+	/// </summary>
+	FORCEINLINE int32 NumOuterEdges() const { return Cells.Num() > 0 ? 2 * (Width + Height) : 0; }
+
+	/// <summary>
+	/// Returns the outer edge on Side at Position, which is the X coordinate for the Y sides and the Y coordinate for the X sides.
+	/// </summary>
+	int32 ToOuterEdgeIndex(EMazeDirection Side, int32 Position) const;
+
+	/// <summary>
+	/// Returns the side of an outer edge and writes the cell coordinate along that side to OutPosition.
+	/// </summary>
+	EMazeDirection GetOuterEdgeSide(int32 OuterEdgeIndex, int32& OutPosition) const;
+
+	/// <summary>
+	/// Returns the cell inside the grid that an outer edge belongs to.
+	/// </summary>
+	int32 GetOuterEdgeCell(int32 OuterEdgeIndex) const;
+
+	/// <summary>
+	/// Corners sit between cells, so there are (Width + 1) * (Height + 1) of them. Corner (X, Y) is at the -X -Y corner of cell (X, Y).
+	/// </summary>
+	FORCEINLINE int32 NumCorners() const { return Cells.Num() > 0 ? (Width + 1) * (Height + 1) : 0; }
+
+	FORCEINLINE int32 ToCornerIndex(int32 X, int32 Y) const { return Y * (Width + 1) + X; }
+
+	FORCEINLINE FIntPoint CornerToCoordinates(int32 CornerIndex) const { return FIntPoint(CornerIndex % (Width + 1), CornerIndex / (Width + 1)); }
+
+	FORCEINLINE bool IsOuterCorner(int32 X, int32 Y) const { return X == 0 || Y == 0 || X == Width || Y == Height; }
+
+	/// <summary>
+	/// Returns true if any of the four inner walls meeting at an inner corner is still standing.
+	/// </summary>
+	bool IsCornerTouchingWall(int32 X, int32 Y) const;
+
+	static EMazeDirection GetOppositeDirection(EMazeDirection Direction);
+};
+
+/// <summary>
+/// Disjoint sets of cell indices, used by the generators to track which cells are already connected.
+/// </summary>
+struct MAZEGENERATOR_API FMazeCellSets
+{
+	explicit FMazeCellSets(int32 NumCells);
+
+	int32 Find(int32 Index);
+
+	/// <summary>
+	/// Joins the sets of A and B. Returns false if they already were the same set.
+	/// </summary>
+	bool Union(int32 A, int32 B);
+
+	FORCEINLINE SIZE_T GetAllocatedSize() const { return Parents.GetAllocatedSize(); }
+
+private:
+	TArray<int32> Parents;
+};
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "MazeLayoutGenerator.h"
+
+/// <summary>
+/// Solved layouts keyed by a hash of every FMazeGenerationSettings field, shared by every maze in the process.
+/// The least recently used layouts are dropped once the cache holds more than maze.LayoutCache.BudgetMB.
+/// Layouts can also be written to Saved/MazeLayoutCache, so they survive an editor restart. Safe to use from any thread.
+/// </summary>
+class MAZEGENERATOR_API FMazeLayoutCache
+{
+public:
+	static FMazeLayoutCache& Get();
+
+	/// <summary>
+	/// Hash of every setting that changes the solved layout.
+	/// </summary>
+	static uint64 MakeKey(const FMazeGenerationSettings& Settings);
+
+	/// <summary>
+	/// Copies the cached layout for Settings to OutLayout. Looks in the Saved directory too when bUseDisk is set.
+	/// </summary>
+	bool Find(const FMazeGenerationSettings& Settings, FMazeLayout& OutLayout, bool bUseDisk);
+
+	/// <summary>
+	/// Caches a copy of Layout for Settings and writes it to the Saved directory when bUseDisk is set.
+	/// </summary>
+	void Add(const FMazeGenerationSettings& Settings, const FMazeLayout& Layout, bool bUseDisk);
+
+	/// <summary>
+	/// Drops every layout held in memory. Files in the Saved directory are kept.
+	/// </summary>
+	void Empty();
+
+	int64 GetUsedBytes() const;
+
+	FORCEINLINE int32 GetNumHits() const { return NumHits; }
+
+	FORCEINLINE int32 GetNumMisses() const { return NumMisses; }
+
+private:
+	struct FEntry
+	{
+		FMazeLayout Layout;
+		int64 Bytes = 0;
+		uint64 LastUse = 0;
+	};
+
+	static FString GetCacheFilename(uint64 Key);
+
+	static int64 GetLayoutBytes(const FMazeLayout& Layout);
+
+	/// <summary>
+	/// Adds an entry and drops the least recently used ones until the cache fits its budget again. Lock has to be held.
+	/// </summary>
+	void AddEntry(uint64 Key, const FMazeLayout& Layout);
+
+	mutable FCriticalSection Lock;
+
+	TMap<uint64, FEntry> Entries;
+
+	int64 UsedBytes = 0;
+
+	uint64 UseCounter = 0;
+
+	std::atomic<int32> NumHits{ 0 };
+
+	std::atomic<int32> NumMisses{ 0 };
+};
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeLayoutGenerator.h"
+
+/// <summary>
+/// Fixed size header at the start of a maze layout file. Everything in the file is little endian.
+/// Readers skip HeaderSize bytes to reach the planes, so later versions can add fields at the end of the header.
+/// </summary>
+struct FMazeLayoutFileHeader
+{
+	uint32 Magic = 0;
+	uint16 Version = 0;
+	uint16 HeaderSize = 0;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 Seed = 0;
+	uint8 Algorithm = 0;
+
+	/// <summary>
+	/// Bit planes stored after the header, plane N holds bit N of the EMazeCellFlags of every cell.
+	/// </summary>
+	uint8 NumFlagPlanes = 0;
+	uint8 Padding[2] = { 0, 0 };
+
+	/// <summary>
+	/// Piece sizes of the maze that saved the layout.
+	/// </summary>
+	FVector3f FloorSize = FVector3f::ZeroVector;
+	FVector3f InnerWallSize = FVector3f::ZeroVector;
+	FVector3f OuterWallSize = FVector3f::ZeroVector;
+	FVector3f InnerCornerSize = FVector3f::ZeroVector;
+	FVector3f OuterCornerSize = FVector3f::ZeroVector;
+
+	int32 EntryOuterEdge = INDEX_NONE;
+	int32 ExitOuterEdge = INDEX_NONE;
+	int32 EntryWallNumber = 0;
+	int32 ExitWallNumber = 0;
+
+	/// <summary>
+	/// Lengths of the lists stored after the planes, in this order.
+	/// </summary>
+	int32 NumRooms = 0;
+	int32 NumDoorways = 0;
+	int32 NumDeadEnds = 0;
+	int32 NumOpenOuterEdges = 0;
+
+	/// <summary>
+	/// FMazeLayout::EntryExitRandomSeed, added in version 2.
+	/// </summary>
+	int32 EntryExitRandomSeed = 0;
+};
+
+/// <summary>
+/// Versioned binary format for a solved FMazeLayout.
+/// The header is followed by one bit per cell for every flag plane, each plane padded to 8 bytes, then the room min and max cells
+/// as X, Y pairs, the doorway edges, the dead end cells and the open outer edges as int32 lists.
+/// The same layout always writes the same bytes, so files can be compared directly.
+/// </summary>
+class MAZEGENERATOR_API FMazeLayoutFile
+{
+public:
+	static constexpr uint32 Magic = 0x4C5A414D; // "MAZL"
+	static constexpr uint16 CurrentVersion = 2;
+
+	/// <summary>
+	/// Fills in the magic, version, size and list lengths of Header from Layout and writes both to OutBytes.
+	/// </summary>
+	static void Write(const FMazeLayout& Layout, FMazeLayoutFileHeader Header, TArray<uint8>& OutBytes);
+
+	/// <summary>
+	/// Reads a layout written by Write. Returns false if the bytes are not a layout file, are from a newer version, are cut short
+	/// or hold an algorithm, room, cell or edge that does not fit the grid.
+	/// </summary>
+	static bool Read(TConstArrayView<uint8> Bytes, FMazeLayoutFileHeader& OutHeader, FMazeLayout& OutLayout);
+
+	static bool SaveToFile(const FString& Filename, const FMazeLayout& Layout, const FMazeLayoutFileHeader& Header);
+
+	/// <summary>
+	/// Memory maps the file and reads the layout straight out of the mapping, so every page of the file is only read once.
+	/// Falls back to reading the whole file when the platform cannot map it.
+	/// </summary>
+	static bool LoadFromFile(const FString& Filename, FMazeLayoutFileHeader& OutHeader, FMazeLayout& OutLayout);
+
+	/// <summary>
+	/// Bytes of one flag plane for a grid with NumCells cells.
+	/// </summary>
+	static FORCEINLINE int64 GetPlaneSize(int64 NumCells) { return Align((NumCells + 7) / 8, 8); }
+};
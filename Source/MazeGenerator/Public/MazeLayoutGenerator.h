@@ -0,0 +1,299 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <atomic>
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+#include "MazeStats.h"
+#include "MazeLayoutGenerator.generated.h"
+
+UENUM(BlueprintType)
+enum class EMazeAlgorithm : uint8
+{
+	EMA_Backtracker UMETA(DisplayName="Recursive Backtracker"),
+	EMA_Prim UMETA(DisplayName="Prim"),
+	EMA_Kruskal UMETA(DisplayName="Kruskal"),
+	EMA_Wilson UMETA(DisplayName="Wilson"),
+	EMA_Sidewinder UMETA(DisplayName="Sidewinder"),
+	EMA_BinaryTree UMETA(DisplayName="Binary Tree"),
+	EMA_Eller UMETA(DisplayName="Eller"),
+	EMA_ParallelTiles UMETA(DisplayName="Parallel Tiles"),
+};
+
+/// <summary>
+/// An outer wall that is left open on top of the entry and exit. Position is the X coordinate of the cell
+/// for the Y sides and the Y coordinate of the cell for the X sides.
+/// </summary>
+USTRUCT(BlueprintType)
+struct MAZEGENERATOR_API FMazeOuterWallOpening
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze")
+	EMazeDirection Side = EMazeDirection::EMD_NegX;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze")
+	int32 Position = 0;
+};
+
+/// <summary>
+/// Copy of every AMazeBase property that changes the layout of a maze, so the layout can be solved away from the actor.
+/// Entry and exit sides are 1 to 4, or 0 when no side is picked.
+/// </summary>
+USTRUCT()
+struct MAZEGENERATOR_API FMazeGenerationSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 MazeWidth = 0;
+
+	UPROPERTY()
+	int32 MazeHeight = 0;
+
+	UPROPERTY()
+	int32 Seed = 0;
+
+	UPROPERTY()
+	FIntPoint MazeAlgorithmStartingCell = FIntPoint::ZeroValue;
+
+	UPROPERTY()
+	EMazeAlgorithm Algorithm = EMazeAlgorithm::EMA_Backtracker;
+
+	UPROPERTY()
+	int32 ParallelTileSize = 64;
+
+	UPROPERTY()
+	bool bCreateRooms = false;
+
+	UPROPERTY()
+	int32 NumberOfRooms = 0;
+
+	UPROPERTY()
+	int32 RoomWidth = 0;
+
+	UPROPERTY()
+	int32 RoomHeight = 0;
+
+	UPROPERTY()
+	int32 NumberOfRoomDoors = 0;
+
+	UPROPERTY()
+	bool bHasEntry = false;
+
+	UPROPERTY()
+	bool bCustomEntry = false;
+
+	UPROPERTY()
+	bool bRandomEntry = false;
+
+	UPROPERTY()
+	int32 EntryWallNumber = 0;
+
+	UPROPERTY()
+	int32 EntrySide = 0;
+
+	UPROPERTY()
+	bool bHasExit = false;
+
+	UPROPERTY()
+	bool bCustomExit = false;
+
+	UPROPERTY()
+	bool bRandomExit = false;
+
+	UPROPERTY()
+	int32 ExitWallNumber = 0;
+
+	UPROPERTY()
+	int32 ExitSide = 0;
+
+	UPROPERTY()
+	TArray<FMazeOuterWallOpening> AdditionalOuterWallOpenings;
+};
+
+/// <summary>
+/// A solved maze. Holds the grid plus everything the stages found that is not stored per cell.
+/// </summary>
+USTRUCT()
+struct MAZEGENERATOR_API FMazeLayout
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FMazeGrid Grid;
+
+	/// <summary>
+	/// First and last cell of every room, the room covers every cell in between.
+	/// </summary>
+	UPROPERTY()
+	TArray<FIntPoint> RoomMinCells;
+
+	UPROPERTY()
+	TArray<FIntPoint> RoomMaxCells;
+
+	/// <summary>
+	/// Inner edge of every room door in the order they were carved, INDEX_NONE for doors that could not be carved.
+	/// </summary>
+	UPROPERTY()
+	TArray<int32> DoorwayEdges;
+
+	/// <summary>
+	/// Dead end cells in the order the maze algorithm found them.
+	/// </summary>
+	UPROPERTY()
+	TArray<int32> DeadEndCells;
+
+	UPROPERTY()
+	int32 EntryOuterEdge = INDEX_NONE;
+
+	UPROPERTY()
+	int32 ExitOuterEdge = INDEX_NONE;
+
+	/// <summary>
+	/// Outer edges of the additional outer wall openings.
+	/// </summary>
+	UPROPERTY()
+	TArray<int32> OpenOuterEdges;
+
+	/// <summary>
+	/// Entry and exit wall numbers after random picks.
+	/// </summary>
+	UPROPERTY()
+	int32 EntryWallNumber = 0;
+
+	UPROPERTY()
+	int32 ExitWallNumber = 0;
+
+	/// <summary>
+	/// State of the maze random stream when the entry and exit were carved, used to carve them again after an edit.
+	/// </summary>
+	UPROPERTY()
+	int32 EntryExitRandomSeed = 0;
+};
+
+/// <summary>
+/// Solves a maze layout from FMazeGenerationSettings without touching any UObject, so it can run on any thread.
+/// </summary>
+class MAZEGENERATOR_API FMazeLayoutGenerator
+{
+public:
+	explicit FMazeLayoutGenerator(const FMazeGenerationSettings& InSettings);
+
+	/// <summary>
+	/// Runs the room, maze algorithm, entry/exit and opening stages. Returns false if CancelFlag was raised before it finished.
+	/// </summary>
+	bool Generate(FMazeLayout& OutLayout, const std::atomic<bool>* CancelFlag = nullptr);
+
+	void GenerateRooms(FMazeLayout& Layout);
+
+	/// <summary>
+	/// Carves the maze with Settings.Algorithm. Every algorithm except the backtracker is followed by a pass that
+	/// joins the parts rooms cut apart, and the dead ends are found afterwards.
+	/// </summary>
+	void ImplementMazeAlgorithm(FMazeLayout& Layout);
+
+	void CarveEntryAndExit(FMazeLayout& Layout);
+
+	void CarveAdditionalOpenings(FMazeLayout& Layout);
+
+	/// <summary>
+	/// Clears the entry, exit and openings of a solved layout and carves them again from Settings,
+	/// giving the same result as a full Generate with these settings.
+	/// </summary>
+	void RecarveEntryAndExit(FMazeLayout& Layout);
+
+	/// <summary>
+	/// Largest amount of temporary memory the maze algorithm needed on top of the grid, in bytes.
+	/// </summary>
+	FORCEINLINE int64 GetPeakScratchBytes() const { return PeakScratchBytes; }
+
+	/// <summary>
+	/// Layout stage timings and counts of the last Generate. The materialization fields are left at 0.
+	/// </summary>
+	FORCEINLINE const FMazeGenerationStats& GetStats() const { return Stats; }
+
+private:
+	/// <summary>
+	/// Depth first walk over an index stack. Picks between the unvisited neighbors with one draw from the maze stream.
+	/// </summary>
+	void RunBacktracker(FMazeLayout& Layout, int32 StartIndex);
+
+	/// <summary>
+	/// One byte per cell with bit N set if the cell has a neighbor in EMazeDirection N.
+	/// </summary>
+	static void BuildNeighborMasks(const FMazeGrid& Grid, TArray<uint8>& OutMasks);
+
+	void RunPrim(FMazeGrid& Grid, int32 StartIndex);
+
+	void RunKruskal(FMazeGrid& Grid);
+
+	void RunWilson(FMazeGrid& Grid, int32 StartIndex);
+
+	void RunSidewinder(FMazeGrid& Grid);
+
+	void RunBinaryTree(FMazeGrid& Grid);
+
+	/// <summary>
+	/// Streams FMazeEllerGenerator rows into the grid, leaving the walls of room cells alone.
+	/// </summary>
+	void RunEller(FMazeGrid& Grid);
+
+	/// <summary>
+	/// Splits the grid into tiles of ParallelTileSize cells, runs a backtracker inside every tile in parallel
+	/// and then joins the tiles with a random spanning tree over the tile borders.
+	/// Every tile has its own seed, so the result does not depend on the number of threads.
+	/// </summary>
+	void RunParallelTiles(FMazeGrid& Grid);
+
+	/// <summary>
+	/// Backtracker that only carves walls between cells of the tile from TileMin to TileMax (exclusive).
+	/// Reads and writes the cells of the tile only, so tiles can run at the same time.
+	/// </summary>
+	static void CarveTile(FMazeGrid& Grid, FIntPoint TileMin, FIntPoint TileMax, int32 TileSeed, TArray<int32>& CellStack);
+
+	/// <summary>
+	/// Opens walls between open cells that are not connected yet, so every cell outside of a room can be reached.
+	/// </summary>
+	void ConnectRegions(FMazeGrid& Grid);
+
+	/// <summary>
+	/// Collects every cell outside of a room with a single open side.
+	/// </summary>
+	void FindDeadEnds(FMazeLayout& Layout);
+
+	/// <summary>
+	/// True for cells inside the grid that are not part of a room.
+	/// </summary>
+	static bool IsOpenCell(const FMazeGrid& Grid, int32 CellIndex);
+
+	static bool IsInMaze(const FMazeGrid& Grid, int32 CellIndex);
+
+	/// <summary>
+	/// Returns StartIndex, or the first cell outside of a room if StartIndex is inside one.
+	/// </summary>
+	static int32 FindOpenStart(const FMazeGrid& Grid, int32 StartIndex);
+
+	FORCEINLINE void TrackScratchBytes(int64 Bytes) { PeakScratchBytes = FMath::Max(PeakScratchBytes, Bytes); }
+
+	bool IsCancelled() const { return CancelFlag && CancelFlag->load(std::memory_order_relaxed); }
+
+	FMazeGenerationSettings Settings;
+
+	FRandomStream MazeRandomStream;
+
+	FRandomStream RoomRandomStream;
+
+	const std::atomic<bool>* CancelFlag = nullptr;
+
+	/// <summary>
+	/// Fills the cell and wall counts of Stats from a generated layout.
+	/// </summary>
+	void CountLayoutStats(const FMazeLayout& Layout);
+
+	int64 PeakScratchBytes = 0;
+
+	FMazeGenerationStats Stats;
+};
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+/// <summary>
+/// Sections of a merged geometry chunk, one per material.
+/// </summary>
+enum class EMazeMergedSection : uint8
+{
+	EMMS_Floor,
+	EMMS_InnerWall,
+	EMMS_OuterWall,
+	EMMS_Corner,
+
+	EMMS_MAX
+};
+
+/// <summary>
+/// Piece sizes the merged boxes are built from, the same sizes AMazeBase places its pieces with.
+/// </summary>
+struct FMazeMergedGeometrySizes
+{
+	FVector Floor = FVector::ZeroVector;
+	FVector InnerWall = FVector::ZeroVector;
+	FVector OuterWall = FVector::ZeroVector;
+	FVector InnerCorner = FVector::ZeroVector;
+	FVector OuterCorner = FVector::ZeroVector;
+};
+
+/// <summary>
+/// Boxes of one chunk, relative to the center of the maze.
+/// </summary>
+struct FMazeMergedChunk
+{
+	TArray<FBox> Boxes[static_cast<int32>(EMazeMergedSection::EMMS_MAX)];
+
+	int32 NumBoxes() const;
+};
+
+/// <summary>
+/// Turns the walls that are left in a grid into a few long boxes. Collinear walls are merged into one box that also covers
+/// the corners between them, and the floor of a chunk is a single box. The grid is split into square chunks of ChunkSize cells
+/// that can be built on their own, so a change to a few cells only needs the chunks around them.
+/// A wall belongs to the chunk of the cell that owns it, see FMazeGrid.
+/// </summary>
+class MAZEGENERATOR_API FMazeMergedGeometryBuilder
+{
+public:
+	/// <summary>
+	/// OpenOuterEdges lists every outer edge without a wall, entry and exit included.
+	/// </summary>
+	FMazeMergedGeometryBuilder(const FMazeGrid& InGrid, TConstArrayView<int32> OpenOuterEdges, const FMazeMergedGeometrySizes& InSizes, int32 InChunkSize);
+
+	FORCEINLINE int32 NumChunks() const { return NumChunksX * NumChunksY; }
+
+	int32 GetChunkOfCell(int32 CellIndex) const;
+
+	int32 GetChunkOfOuterEdge(int32 OuterEdgeIndex) const;
+
+	void BuildChunk(int32 ChunkIndex, FMazeMergedChunk& OutChunk) const;
+
+	/// <summary>
+	/// Appends the 6 faces of a box with flat normals. UVs are the position in meters, so textures keep their scale on long boxes.
+	/// </summary>
+	static void AppendBox(const FBox& Box, TArray<FVector>& Vertices, TArray<int32>& Triangles, TArray<FVector>& Normals, TArray<FVector2D>& UVs);
+
+	/// <summary>
+	/// Writes the 8 corners of a box, the vertices of a convex collision element.
+	/// </summary>
+	static void GetBoxCorners(const FBox& Box, TArray<FVector>& OutVertices);
+
+private:
+	/// <summary>
+	/// Position of corner (X, Y) relative to the center of the maze.
+	/// </summary>
+	FORCEINLINE double CornerX(int32 X) const { return X * Sizes.Floor.X - Sizes.Floor.X * Grid.Width / 2; }
+
+	FORCEINLINE double CornerY(int32 Y) const { return Y * Sizes.Floor.Y - Sizes.Floor.Y * Grid.Height / 2; }
+
+	/// <summary>
+	/// Box of a wall run on the corner line X from corner (X, FirstY) to corner (X, LastY).
+	/// </summary>
+	FBox MakeRunAlongY(int32 X, int32 FirstY, int32 LastY, const FVector& WallSize, const FVector& CornerSize) const;
+
+	FBox MakeRunAlongX(int32 Y, int32 FirstX, int32 LastX, const FVector& WallSize, const FVector& CornerSize) const;
+
+	FBox MakeCorner(int32 X, int32 Y, const FVector& CornerSize) const;
+
+	bool HasOuterWall(EMazeDirection Side, int32 Position) const;
+
+	const FMazeGrid& Grid;
+
+	FMazeMergedGeometrySizes Sizes;
+
+	int32 ChunkSize = 1;
+
+	int32 NumChunksX = 0;
+
+	int32 NumChunksY = 0;
+
+	/// <summary>
+	/// One bit per outer edge, set when the edge is open.
+	/// </summary>
+	TBitArray<> OpenOuterEdgeBits;
+};
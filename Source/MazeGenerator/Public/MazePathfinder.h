@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+/// <summary>
+/// Buffers of a breadth first search over the cells of a grid, shared by the searches of FMazePathfinder and FMazeCellIndex.
+/// A cell was reached by the current search if its stamp is Stamp, so the buffers never have to be cleared between searches.
+/// </summary>
+struct MAZEGENERATOR_API FMazeSearchBuffers
+{
+	/// <summary>
+	/// Sizes the buffers for NumCells cells, no cell counts as reached afterwards.
+	/// </summary>
+	void Init(int32 NumCells);
+
+	void Reset();
+
+	/// <summary>
+	/// Starts a new search, which forgets every cell reached before.
+	/// </summary>
+	void BeginSearch();
+
+	FORCEINLINE int32 Num() const { return Stamps.Num(); }
+
+	FORCEINLINE bool IsReached(int32 Cell) const { return Stamps[Cell] == Stamp; }
+
+	FORCEINLINE void MarkReached(int32 Cell, int32 Value)
+	{
+		Stamps[Cell] = Stamp;
+		Values[Cell] = Value;
+	}
+
+	FORCEINLINE SIZE_T GetAllocatedSize() const { return Stamps.GetAllocatedSize() + Values.GetAllocatedSize() + Queue.GetAllocatedSize(); }
+
+	TArray<uint32> Stamps;
+
+	/// <summary>
+	/// What the search keeps for every reached cell, the parent for FMazePathfinder and the depth for FMazeCellIndex.
+	/// </summary>
+	TArray<int32> Values;
+
+	TArray<int32> Queue;
+
+	uint32 Stamp = 0;
+};
+
+/// <summary>
+/// Shortest paths between cells of an FMazeGrid, walking through the open edges.
+/// A perfect maze has exactly one path between two cells, so Init roots its spanning tree once and a query only climbs
+/// from both cells to their lowest common ancestor, which costs the length of the path. Other mazes, for example with rooms,
+/// run a breadth first search over buffers allocated by Init.
+/// The most recently used paths are cached until the next Init. Not thread safe, AMazeBase only uses it on the game thread.
+/// </summary>
+class MAZEGENERATOR_API FMazePathfinder
+{
+public:
+	/// <summary>
+	/// Prepares the search buffers for Grid and the spanning tree when Grid is a perfect maze. Drops every cached path.
+	/// </summary>
+	void Init(const FMazeGrid& Grid, int32 InMaxCachedPaths);
+
+	/// <summary>
+	/// Frees everything, the next query needs a new Init.
+	/// </summary>
+	void Reset();
+
+	FORCEINLINE bool IsInitialized() const { return NumCells > 0; }
+
+	/// <summary>
+	/// True if the grid passed to Init is connected and has no loops.
+	/// </summary>
+	FORCEINLINE bool IsPerfect() const { return TreeParents.Num() > 0; }
+
+	/// <summary>
+	/// Writes the cells from FromCell to ToCell, both included. Grid has to be the grid passed to Init.
+	/// Returns false if either cell is outside the grid or there is no path between them.
+	/// </summary>
+	bool FindPath(const FMazeGrid& Grid, int32 FromCell, int32 ToCell, TArray<int32>& OutCells);
+
+	FORCEINLINE int32 GetNumCacheHits() const { return NumCacheHits; }
+
+	FORCEINLINE int32 GetNumCacheMisses() const { return NumCacheMisses; }
+
+	/// <summary>
+	/// Writes the cells next to Cell that are not behind a wall and returns how many there are.
+	/// </summary>
+	static int32 GetOpenNeighbors(const FMazeGrid& Grid, int32 Cell, int32 OutNeighbors[4]);
+
+	/// <summary>
+	/// True if Grid is a perfect maze. NumReachedCells is how many cells a search from any one cell reached,
+	/// the grid is connected if that is every cell, and a connected grid is a tree if it has exactly Grid.Num() - 1 open edges.
+	/// </summary>
+	static bool IsTree(const FMazeGrid& Grid, int32 NumReachedCells);
+
+private:
+	void FindTreePath(int32 FromCell, int32 ToCell, TArray<int32>& OutCells) const;
+
+	bool FindSearchPath(const FMazeGrid& Grid, int32 FromCell, int32 ToCell, TArray<int32>& OutCells);
+
+	void AddCachedPath(uint64 Key, const TArray<int32>& Cells);
+
+	static FORCEINLINE uint64 MakeKey(int32 FromCell, int32 ToCell) { return (static_cast<uint64>(static_cast<uint32>(FromCell)) << 32) | static_cast<uint32>(ToCell); }
+
+	int32 NumCells = 0;
+
+	/// <summary>
+	/// Parent and depth of every cell in the spanning tree rooted at cell 0. Empty when the maze is not perfect.
+	/// </summary>
+	TArray<int32> TreeParents;
+
+	TArray<int32> TreeDepths;
+
+	/// <summary>
+	/// Buffers of the breadth first search, its values are the parents the search came from.
+	/// </summary>
+	FMazeSearchBuffers Search;
+
+	struct FCachedPath
+	{
+		TArray<int32> Cells;
+		uint64 LastUse = 0;
+	};
+
+	TMap<uint64, FCachedPath> CachedPaths;
+
+	int32 MaxCachedPaths = 0;
+
+	uint64 UseCounter = 0;
+
+	int32 NumCacheHits = 0;
+
+	int32 NumCacheMisses = 0;
+};
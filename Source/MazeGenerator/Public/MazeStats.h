@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "MazeStats.generated.h"
+
+DECLARE_STATS_GROUP(TEXT("Maze"), STATGROUP_Maze, STATCAT_Advanced);
+
+/// <summary>
+/// Unreal Insights channel of the maze generation scopes, enabled with -trace=cpu,Maze or Trace.Enable Maze.
+/// </summary>
+UE_TRACE_CHANNEL_EXTERN(MazeChannel, MAZEGENERATOR_API);
+
+/// <summary>
+/// Counts the rest of the scope in a cycle stat of STATGROUP_Maze (stat Maze) and traces it as a CPU event on MazeChannel.
+/// </summary>
+#define MAZE_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR(#Stat, MazeChannel)
+
+/// <summary>
+/// What the last generation of a maze did and how long every stage took.
+/// The layout fields, from RoomsMs to EntryExitMs and from CellsVisited to RoomPlacementRetries, plus ScratchBytes,
+/// are left at 0 when the layout was not solved by this generation, such as a layout from FMazeLayoutCache or a layout file.
+/// </summary>
+USTRUCT(BlueprintType)
+struct MAZEGENERATOR_API FMazeGenerationStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	float RoomsMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	float AlgorithmMs = 0.f;
+
+	/// <summary>
+	/// Carving the entry, exit and additional outer wall openings.
+	/// </summary>
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	float EntryExitMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	float FloorsMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	float CornersMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	float WallsMs = 0.f;
+
+	/// <summary>
+	/// Removing the carved pieces when only the remaining pieces are not spawned.
+	/// </summary>
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	float CarveMs = 0.f;
+
+	/// <summary>
+	/// Building the merged geometry, collision, flow fields and the other data of the finished maze.
+	/// </summary>
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	float FinishMs = 0.f;
+
+	/// <summary>
+	/// From the start of the generation to the finished maze, including the frames a budgeted materialization waited for.
+	/// </summary>
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	float TotalMs = 0.f;
+
+	/// <summary>
+	/// Cells outside of rooms the maze algorithm reached.
+	/// </summary>
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	int32 CellsVisited = 0;
+
+	/// <summary>
+	/// Inner walls opened by the rooms, doors and the maze algorithm, plus the opened outer walls.
+	/// </summary>
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	int32 WallsCarved = 0;
+
+	/// <summary>
+	/// Room positions tried on top of the first one of every room, after a try overlapped an earlier room.
+	/// </summary>
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	int32 RoomPlacementRetries = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	int32 ComponentsCreated = 0;
+
+	/// <summary>
+	/// Components destroyed since the generation started, the ones of the previous maze included.
+	/// </summary>
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	int32 ComponentsDestroyed = 0;
+
+	/// <summary>
+	/// Temporary memory of the maze algorithm on top of the grid.
+	/// </summary>
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	int64 ScratchBytes = 0;
+
+	/// <summary>
+	/// Memory of the grid and the piece tables of the finished maze.
+	/// </summary>
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	int64 BytesUsed = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category="Maze|Stats")
+	bool bFromLayoutCache = false;
+};
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+/// <summary>
+/// Potentially visible set of every cell of an FMazeGrid. A cell only stores the cells in the square of Radius cells around it,
+/// one bit each, so the memory is (2 * Radius + 1)^2 bits per cell and cells further away always count as hidden.
+/// A cell sees another one if a line between sample points of both cells only crosses open edges, which is sampled
+/// and so can miss a view through a sliver, but never sees through a wall.
+/// </summary>
+class MAZEGENERATOR_API FMazeVisibility
+{
+public:
+	/// <summary>
+	/// Largest bit array Build allocates, 80 bytes per cell at a radius of 12 reach it at about 13 million cells.
+	/// </summary>
+	static constexpr int64 MaxAllocatedBytes = 1024ll * 1024 * 1024;
+
+	/// <summary>
+	/// Computes the visible set of every cell. Logs an error and leaves the set empty if the bits would take more than MaxAllocatedBytes. Runs over the cells in parallel and touches no UObjects, so it can run on a worker thread.
+	/// </summary>
+	void Build(const FMazeGrid& Grid, int32 InRadius);
+
+	void Reset();
+
+	FORCEINLINE bool IsBuilt() const { return Bits.Num() > 0; }
+
+	FORCEINLINE int32 GetRadius() const { return Radius; }
+
+	FORCEINLINE int32 Num() const { return Width * Height; }
+
+	bool IsVisible(int32 FromCell, int32 ToCell) const;
+
+	/// <summary>
+	/// Writes every cell FromCell sees, FromCell included.
+	/// </summary>
+	void GetVisibleCells(int32 FromCell, TArray<int32>& OutCells) const;
+
+	FORCEINLINE SIZE_T GetAllocatedSize() const { return Bits.GetAllocatedSize(); }
+
+private:
+	/// <summary>
+	/// Fills the window bits of one cell. Window cells are visited in the order of their distance to the cell,
+	/// so a cell is only traced to when the cell in front of it towards the source is visible and the edge between them is open.
+	/// </summary>
+	void BuildCell(const FMazeGrid& Grid, int32 CellIndex, uint64* CellBits) const;
+
+	/// <summary>
+	/// Walks the line from From to To in cell space edge by edge and marks every cell it reaches, up to the first wall.
+	/// A line through a corner passes if either way around the corner is open.
+	/// </summary>
+	bool TraceLine(const FMazeGrid& Grid, int32 SourceX, int32 SourceY, const FVector2D& From, const FVector2D& To, uint64* CellBits) const;
+
+	/// <summary>
+	/// The offset is taken in int64, the bits of a large maze can pass MAX_int32 bytes before they pass MAX_int32 words.
+	/// </summary>
+	FORCEINLINE uint64* GetCellBits(int32 CellIndex) { return Bits.GetData() + static_cast<int64>(CellIndex) * WordsPerCell; }
+
+	FORCEINLINE const uint64* GetCellBits(int32 CellIndex) const { return Bits.GetData() + static_cast<int64>(CellIndex) * WordsPerCell; }
+
+	FORCEINLINE int32 GetWindowBit(int32 OffsetX, int32 OffsetY) const { return (OffsetY + Radius) * WindowSize + OffsetX + Radius; }
+
+	static FORCEINLINE bool TestBit(const uint64* CellBits, int32 Bit) { return (CellBits[Bit >> 6] >> (Bit & 63)) & 1; }
+
+	static FORCEINLINE void SetBit(uint64* CellBits, int32 Bit) { CellBits[Bit >> 6] |= 1ull << (Bit & 63); }
+
+	/// <summary>
+	/// WordsPerCell words of window bits per cell, bit (OffsetY + Radius) * WindowSize + OffsetX + Radius is the cell at that offset.
+	/// </summary>
+	TArray<uint64> Bits;
+
+	int32 Width = 0;
+
+	int32 Height = 0;
+
+	int32 Radius = 0;
+
+	int32 WindowSize = 0;
+
+	int32 WordsPerCell = 0;
+};
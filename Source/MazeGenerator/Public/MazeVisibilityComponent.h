@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "MazeVisibilityComponent.generated.h"
+
+class AMazeBase;
+
+/// <summary>
+/// Hides the pieces of a maze that the camera of a local player cannot see, using the visible sets of AMazeBase::bBuildVisibility.
+/// Add it to the maze, or to any actor and point Maze at the maze. The pieces are only checked again when the camera enters another cell.
+/// </summary>
+UCLASS(ClassGroup=(Maze), meta=(BlueprintSpawnableComponent))
+class MAZEGENERATOR_API UMazeVisibilityComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this component's properties
+	UMazeVisibilityComponent();
+
+	/// <summary>
+	/// Maze whose pieces are culled. Uses the owner when it is a maze.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Visibility")
+	TObjectPtr<AMazeBase> Maze;
+
+	/// <summary>
+	/// Local player whose camera decides what is visible.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Visibility",
+		meta = (ClampMin="0"))
+	int32 PlayerIndex;
+
+	/// <summary>
+	/// Logs the visible and culled piece counts whenever they change.
+	/// </summary>
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Maze|Visibility")
+	bool bLogPieceCounts;
+
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	int32 GetVisiblePieceCount() const;
+
+	UFUNCTION(BlueprintCallable, Category="Maze|Stats")
+	int32 GetCulledPieceCount() const;
+
+protected:
+	// Called when the game starts
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	int32 LastVisiblePieceCount = INDEX_NONE;
+
+	int32 LastCulledPieceCount = INDEX_NONE;
+
+public:
+	// Called every frame
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+};